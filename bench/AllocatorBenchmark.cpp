@@ -0,0 +1,290 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file AllocatorBenchmark.cpp
+ *
+ * Measures throughput and latency percentiles of the MemoryManager with every allocator and
+ * bounds checking policy against malloc / free and new / delete.
+ *
+ * usage: AllocatorBenchmark [rounds] [max threads]
+ */
+
+// measure the allocators, not the logger
+#define ONDRALUK_TRACKING 0
+
+#include "../includes/MemoryManager.hpp"
+#include "../includes/LinearAllocator.hpp"
+#include "../includes/MallocAllocator.hpp"
+#include "../includes/CycleClock.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace ondraluk;
+
+namespace {
+
+	enum Order { LIFO, FIFO, RANDOM_ORDER };
+	enum Sizes { FIXED, RANDOM_SIZES };
+
+	const char* ORDER_NAMES[] = { "lifo", "fifo", "random" };
+	const char* SIZES_NAMES[] = { "fixed", "random" };
+
+	const size_t FIXED_SIZE = 64;
+	const size_t MIN_RANDOM_SIZE = 16;
+	const size_t MAX_RANDOM_SIZE = 1024;
+
+	/**
+	 * Sizes and free order of one round, shared read only by all threads
+	 */
+	struct Workload {
+		Workload(size_t blocks, Sizes sizes, Order order) : mSizes(blocks), mFreeOrder(blocks), mArenaSize(0) {
+			std::mt19937 random(42);
+			std::uniform_int_distribution<size_t> sizeDistribution(MIN_RANDOM_SIZE, MAX_RANDOM_SIZE);
+
+			for(size_t i = 0; i < blocks; ++i) {
+				mSizes[i] = sizes == FIXED ? FIXED_SIZE : sizeDistribution(random);
+				mFreeOrder[i] = i;
+				// payload plus the MemoryManager header and bounds
+				mArenaSize += mSizes[i] + 64;
+			}
+
+			if(order == LIFO) {
+				std::reverse(mFreeOrder.begin(), mFreeOrder.end());
+			} else if(order == RANDOM_ORDER) {
+				std::shuffle(mFreeOrder.begin(), mFreeOrder.end(), random);
+			}
+		}
+
+		std::vector<size_t> mSizes;
+		std::vector<size_t> mFreeOrder;
+		size_t mArenaSize;
+	};
+
+	/**
+	 * Uniform interface over the measured candidates.
+	 * A candidate is constructed fresh for every round, outside of the measured section.
+	 */
+	struct MallocCandidate {
+		explicit MallocCandidate(size_t) {}
+		static const char* name() { return "malloc/free"; }
+
+		void* allocate(size_t size) { return ::malloc(size); }
+		void free(void* mem) { ::free(mem); }
+	};
+
+	struct NewDeleteCandidate {
+		explicit NewDeleteCandidate(size_t) {}
+		static const char* name() { return "new/delete"; }
+
+		void* allocate(size_t size) { return new unsigned char[size]; }
+		void free(void* mem) { delete[] static_cast<unsigned char*>(mem); }
+	};
+
+	inline MallocAllocator createAllocator(size_t, MallocAllocator*) {
+		return MallocAllocator();
+	}
+
+	inline LinearAllocator createAllocator(size_t arenaSize, LinearAllocator*) {
+		return LinearAllocator(arenaSize);
+	}
+
+	template <class Allocator, class BoundsChecker>
+	struct ManagerCandidate {
+		explicit ManagerCandidate(size_t arenaSize) : mManager(createAllocator(arenaSize, static_cast<Allocator*>(nullptr))) {}
+
+		void* allocate(size_t size) {
+			return mManager.template allocate<unsigned char>(size);
+		}
+
+		void free(void* mem) {
+			mManager.template deallocate<unsigned char, ARRAY::YES>(static_cast<unsigned char*>(mem));
+		}
+
+		MemoryManager<Allocator, BoundsChecker> mManager;
+	};
+
+	struct MallocManager : ManagerCandidate<MallocAllocator, NoBoundsCheckingPolicy> {
+		explicit MallocManager(size_t arenaSize) : ManagerCandidate(arenaSize) {}
+		static const char* name() { return "MM<Malloc,NoBounds>"; }
+	};
+
+	struct MallocBoundsManager : ManagerCandidate<MallocAllocator, BoundsCheckingPolicy<4, 0xEF> > {
+		explicit MallocBoundsManager(size_t arenaSize) : ManagerCandidate(arenaSize) {}
+		static const char* name() { return "MM<Malloc,Bounds4>"; }
+	};
+
+	struct LinearManager : ManagerCandidate<LinearAllocator, NoBoundsCheckingPolicy> {
+		explicit LinearManager(size_t arenaSize) : ManagerCandidate(arenaSize) {}
+		static const char* name() { return "MM<Linear,NoBounds>"; }
+	};
+
+	struct LinearBoundsManager : ManagerCandidate<LinearAllocator, BoundsCheckingPolicy<4, 0xEF> > {
+		explicit LinearBoundsManager(size_t arenaSize) : ManagerCandidate(arenaSize) {}
+		static const char* name() { return "MM<Linear,Bounds4>"; }
+	};
+
+	/**
+	 * Measurements of one thread
+	 */
+	struct ThreadResult {
+		ThreadResult() : mTicks(0) {}
+
+		uint64_t mTicks;
+		std::vector<uint32_t> mAllocTicks;
+		std::vector<uint32_t> mFreeTicks;
+	};
+
+	template <class Candidate>
+	void runThread(const Workload& workload, size_t rounds, size_t latencyRounds, ThreadResult& result) {
+		size_t blocks = workload.mSizes.size();
+		std::vector<void*> blocksInUse(blocks);
+
+		// throughput: the whole round is measured at once
+		for(size_t round = 0; round < rounds; ++round) {
+			Candidate candidate(workload.mArenaSize);
+
+			uint64_t start = debuglib::clock::ticks();
+
+			for(size_t i = 0; i < blocks; ++i) {
+				void* mem = candidate.allocate(workload.mSizes[i]);
+				*static_cast<volatile unsigned char*>(mem) = 1;
+				blocksInUse[i] = mem;
+			}
+
+			for(size_t i = 0; i < blocks; ++i) {
+				candidate.free(blocksInUse[workload.mFreeOrder[i]]);
+			}
+
+			result.mTicks += debuglib::clock::ticksSerialized() - start;
+		}
+
+		// latency: every single operation is measured
+		result.mAllocTicks.reserve(latencyRounds * blocks);
+		result.mFreeTicks.reserve(latencyRounds * blocks);
+
+		for(size_t round = 0; round < latencyRounds; ++round) {
+			Candidate candidate(workload.mArenaSize);
+
+			for(size_t i = 0; i < blocks; ++i) {
+				uint64_t start = debuglib::clock::ticks();
+				void* mem = candidate.allocate(workload.mSizes[i]);
+				uint64_t end = debuglib::clock::ticksSerialized();
+
+				*static_cast<volatile unsigned char*>(mem) = 1;
+				blocksInUse[i] = mem;
+				result.mAllocTicks.push_back(static_cast<uint32_t>(end - start));
+			}
+
+			for(size_t i = 0; i < blocks; ++i) {
+				void* mem = blocksInUse[workload.mFreeOrder[i]];
+
+				uint64_t start = debuglib::clock::ticks();
+				candidate.free(mem);
+				uint64_t end = debuglib::clock::ticksSerialized();
+
+				result.mFreeTicks.push_back(static_cast<uint32_t>(end - start));
+			}
+		}
+	}
+
+	double percentile(std::vector<uint32_t>& samples, double p) {
+		if(samples.empty()) {
+			return 0.0;
+		}
+
+		size_t index = static_cast<size_t>(p * (samples.size() - 1));
+		std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+
+		return static_cast<double>(debuglib::clock::ticksToNanoseconds(samples[index]));
+	}
+
+	template <class Candidate>
+	void run(const Workload& workload, Sizes sizes, Order order, unsigned int threads, size_t rounds) {
+		size_t latencyRounds = rounds / 4 + 1;
+		std::vector<ThreadResult> results(threads);
+		std::vector<std::thread> workers;
+
+		for(unsigned int i = 0; i < threads; ++i) {
+			workers.push_back(std::thread(runThread<Candidate>, std::cref(workload), rounds, latencyRounds, std::ref(results[i])));
+		}
+
+		uint64_t slowest = 0;
+		std::vector<uint32_t> allocTicks;
+		std::vector<uint32_t> freeTicks;
+
+		for(unsigned int i = 0; i < threads; ++i) {
+			workers[i].join();
+
+			slowest = std::max(slowest, results[i].mTicks);
+			allocTicks.insert(allocTicks.end(), results[i].mAllocTicks.begin(), results[i].mAllocTicks.end());
+			freeTicks.insert(freeTicks.end(), results[i].mFreeTicks.begin(), results[i].mFreeTicks.end());
+		}
+
+		// allocations and frees of all threads
+		double operations = 2.0 * threads * rounds * workload.mSizes.size();
+		double seconds = debuglib::clock::ticksToNanoseconds(slowest) / 1e9;
+
+		printf("%-22s %7u %-7s %-7s %10.2f | %8.0f %8.0f %8.0f | %8.0f %8.0f %8.0f\n",
+			Candidate::name(), threads, SIZES_NAMES[sizes], ORDER_NAMES[order],
+			seconds > 0 ? operations / seconds / 1e6 : 0.0,
+			percentile(allocTicks, 0.5), percentile(allocTicks, 0.99), percentile(allocTicks, 0.999),
+			percentile(freeTicks, 0.5), percentile(freeTicks, 0.99), percentile(freeTicks, 0.999));
+	}
+}
+
+int main(int argc, char** argv) {
+	size_t rounds = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 200;
+	unsigned int maxThreads = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : std::thread::hardware_concurrency();
+	const size_t blocks = 4096;
+
+	if(rounds == 0) {
+		rounds = 1;
+	}
+
+	std::vector<unsigned int> threadCounts(1, 1);
+	if(maxThreads > 1) {
+		threadCounts.push_back(maxThreads);
+	}
+
+	// calibrate before the first measurement
+	debuglib::clock::nanosecondsPerTick();
+
+	printf("%u blocks per round, %u rounds, latencies in ns\n", static_cast<unsigned int>(blocks), static_cast<unsigned int>(rounds));
+	printf("%-22s %7s %-7s %-7s %10s | %8s %8s %8s | %8s %8s %8s\n",
+		"candidate", "threads", "sizes", "order", "Mops/s", "alloc50", "alloc99", "alloc999", "free50", "free99", "free999");
+
+	for(size_t t = 0; t < threadCounts.size(); ++t) {
+		for(int sizes = FIXED; sizes <= RANDOM_SIZES; ++sizes) {
+			for(int order = LIFO; order <= RANDOM_ORDER; ++order) {
+				Workload workload(blocks, static_cast<Sizes>(sizes), static_cast<Order>(order));
+				Sizes s = static_cast<Sizes>(sizes);
+				Order o = static_cast<Order>(order);
+
+				run<MallocCandidate>(workload, s, o, threadCounts[t], rounds);
+				run<NewDeleteCandidate>(workload, s, o, threadCounts[t], rounds);
+				run<MallocManager>(workload, s, o, threadCounts[t], rounds);
+				run<MallocBoundsManager>(workload, s, o, threadCounts[t], rounds);
+				run<LinearManager>(workload, s, o, threadCounts[t], rounds);
+				run<LinearBoundsManager>(workload, s, o, threadCounts[t], rounds);
+			}
+		}
+	}
+
+#if DEBUGLIB_INSTRUMENTATION
+	// where the MemoryManager candidates spend their time, over all runs
+	std::ostringstream probes;
+	debuglib::instrument::writeText(probes);
+	printf("\n%s", probes.str().c_str());
+#endif
+
+	return 0;
+}
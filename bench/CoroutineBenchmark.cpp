@@ -0,0 +1,234 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file CoroutineBenchmark.cpp
+ *
+ * Measures requests handled by a chain of nested coroutines with the frames from the global operator new,
+ * the per thread FramePool and a request scoped LinearAllocator.
+ *
+ * usage: CoroutineBenchmark [requests] [max threads]
+ */
+
+// measure the frames, not the logger
+#define ONDRALUK_TRACKING 0
+
+#include "../includes/CoroutineFrames.hpp"
+#include "../includes/LinearAllocator.hpp"
+#include "../includes/CycleClock.h"
+
+#include <algorithm>
+#include <coroutine>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace ondraluk;
+
+namespace {
+
+	// coroutines per request: the handler and the chain below it
+	const int DEPTH = 6;
+
+	const size_t ARENA_SIZE = 64 << 10;
+
+	// promise base of the default candidate, frames from the global operator new
+	struct GlobalFrames {};
+
+	/**
+	 * Lazy task returning an int, the promise inherits the frame allocation from Frames
+	 */
+	template <class Frames>
+	struct Task {
+		struct promise_type : Frames {
+			int mValue = 0;
+			std::coroutine_handle<> mContinuation;
+
+			Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+			std::suspend_always initial_suspend() noexcept { return {}; }
+
+			struct FinalAwaiter {
+				bool await_ready() noexcept { return false; }
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+					std::coroutine_handle<> continuation = handle.promise().mContinuation;
+					return continuation ? continuation : std::noop_coroutine();
+				}
+				void await_resume() noexcept {}
+			};
+
+			FinalAwaiter final_suspend() noexcept { return {}; }
+			void return_value(int value) { mValue = value; }
+			void unhandled_exception() { std::abort(); }
+		};
+
+		explicit Task(std::coroutine_handle<promise_type> handle) : mHandle(handle) {}
+		Task(Task&& other) : mHandle(std::exchange(other.mHandle, nullptr)) {}
+		~Task() {
+			if(mHandle) {
+				mHandle.destroy();
+			}
+		}
+
+		bool await_ready() { return false; }
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) {
+			mHandle.promise().mContinuation = continuation;
+			return mHandle;
+		}
+		int await_resume() { return mHandle.promise().mValue; }
+
+		int run() {
+			mHandle.resume();
+			return mHandle.promise().mValue;
+		}
+
+		std::coroutine_handle<promise_type> mHandle;
+	};
+
+	template <class Frames>
+	Task<Frames> handle(int depth, int request) {
+		if(depth == 0) {
+			co_return request;
+		}
+		int below = co_await handle<Frames>(depth - 1, request);
+		co_return below + 1;
+	}
+
+	struct GlobalCandidate {
+		static const char* name() { return "operator new"; }
+		int run(int request) { return handle<GlobalFrames>(DEPTH, request).run(); }
+	};
+
+	struct PoolCandidate {
+		static const char* name() { return "FramePool"; }
+		int run(int request) { return handle<FramePromise<> >(DEPTH, request).run(); }
+	};
+
+	struct ArenaCandidate {
+		ArenaCandidate() : mArena(ARENA_SIZE) {}
+		static const char* name() { return "LinearAllocator"; }
+
+		int run(int request) {
+			int result;
+			{
+				FrameArenaScope<LinearAllocator> frames(mArena);
+				result = handle<FramePromise<> >(DEPTH, request).run();
+			}
+			// end of the request
+			mArena.free(const_cast<void*>(mArena.data()));
+			return result;
+		}
+
+		LinearAllocator mArena;
+	};
+
+	/**
+	 * Measurements of one thread
+	 */
+	struct ThreadResult {
+		ThreadResult() : mTicks(0) {}
+
+		uint64_t mTicks;
+		std::vector<uint32_t> mRequestTicks;
+	};
+
+	template <class Candidate>
+	void runThread(size_t requests, ThreadResult& result) {
+		Candidate candidate;
+		volatile int sink = 0;
+
+		// warm up, fills the pool of this thread
+		for(size_t i = 0; i < 64; ++i) {
+			sink = candidate.run(static_cast<int>(i));
+		}
+
+		uint64_t start = debuglib::clock::ticks();
+		for(size_t i = 0; i < requests; ++i) {
+			sink = candidate.run(static_cast<int>(i));
+		}
+		result.mTicks = debuglib::clock::ticksSerialized() - start;
+
+		// latency: every request is measured
+		size_t latencyRequests = requests / 4 + 1;
+		result.mRequestTicks.reserve(latencyRequests);
+
+		for(size_t i = 0; i < latencyRequests; ++i) {
+			uint64_t begin = debuglib::clock::ticks();
+			sink = candidate.run(static_cast<int>(i));
+			uint64_t end = debuglib::clock::ticksSerialized();
+
+			result.mRequestTicks.push_back(static_cast<uint32_t>(end - begin));
+		}
+
+		(void)sink;
+	}
+
+	double percentile(std::vector<uint32_t>& samples, double p) {
+		if(samples.empty()) {
+			return 0.0;
+		}
+
+		size_t index = static_cast<size_t>(p * (samples.size() - 1));
+		std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+
+		return static_cast<double>(debuglib::clock::ticksToNanoseconds(samples[index]));
+	}
+
+	template <class Candidate>
+	void run(unsigned int threads, size_t requests) {
+		std::vector<ThreadResult> results(threads);
+		std::vector<std::thread> workers;
+
+		for(unsigned int i = 0; i < threads; ++i) {
+			workers.push_back(std::thread(runThread<Candidate>, requests, std::ref(results[i])));
+		}
+
+		uint64_t slowest = 0;
+		std::vector<uint32_t> requestTicks;
+
+		for(unsigned int i = 0; i < threads; ++i) {
+			workers[i].join();
+
+			slowest = std::max(slowest, results[i].mTicks);
+			requestTicks.insert(requestTicks.end(), results[i].mRequestTicks.begin(), results[i].mRequestTicks.end());
+		}
+
+		double seconds = debuglib::clock::ticksToNanoseconds(slowest) / 1e9;
+		double total = static_cast<double>(threads) * requests;
+
+		printf("%-16s %7u %12.2f %10.1f | %8.0f %8.0f %8.0f\n", Candidate::name(), threads,
+			seconds > 0 ? total / seconds / 1e6 : 0.0, seconds > 0 ? seconds * 1e9 / (total / threads) / (DEPTH + 1) : 0.0,
+			percentile(requestTicks, 0.5), percentile(requestTicks, 0.99), percentile(requestTicks, 0.999));
+	}
+}
+
+int main(int argc, char** argv) {
+	size_t requests = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 1000000;
+	unsigned int maxThreads = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : std::thread::hardware_concurrency();
+
+	if(requests == 0) {
+		requests = 1;
+	}
+
+	std::vector<unsigned int> threadCounts(1, 1);
+	if(maxThreads > 1) {
+		threadCounts.push_back(maxThreads);
+	}
+
+	// calibrate before the first measurement
+	debuglib::clock::nanosecondsPerTick();
+
+	printf("%u requests per thread, %d coroutine frames per request, latencies in ns\n", static_cast<unsigned int>(requests), DEPTH + 1);
+	printf("%-16s %7s %12s %10s | %8s %8s %8s\n", "frames", "threads", "Mrequests/s", "ns/frame", "req50", "req99", "req999");
+
+	for(size_t t = 0; t < threadCounts.size(); ++t) {
+		run<GlobalCandidate>(threadCounts[t], requests);
+		run<PoolCandidate>(threadCounts[t], requests);
+		run<ArenaCandidate>(threadCounts[t], requests);
+	}
+
+	return 0;
+}
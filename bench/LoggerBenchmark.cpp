@@ -0,0 +1,204 @@
+/**
+ *  This file is part of the debuglib project
+ *  Copyright by Christian Ondracek
+ *  Contact: coder[at]paxi.at
+ *
+ *  Measures nanoseconds per LOG call for the LoggerImpl configurations across 1-N producer threads,
+ *  including the tail latency seen by the calling thread.
+ *
+ *  usage: LoggerBenchmark [calls per thread] [max threads] [output directory]
+ *
+ *  Console output goes to /dev/null, the report is written to the original stdout.
+ */
+
+#include "../includes/Logger.h"
+#include "../includes/CycleClock.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace debuglib::logger;
+
+namespace {
+
+	// not registered with the LoggerMgr
+	const int UNREGISTERED_CHANNEL = 42;
+
+	std::FILE* report = nullptr;
+	std::string directory = "/tmp";
+
+	enum Call { PRINTF, EVENT, UNREGISTERED };
+
+	struct ThreadResult {
+		ThreadResult() : mTicks(0) {}
+
+		uint64_t mTicks;
+		std::vector<uint32_t> mCallTicks;
+	};
+
+	void producer(Call call, size_t calls, int thread, ThreadResult& result) {
+		result.mCallTicks.reserve(calls);
+		uint64_t start = debuglib::clock::ticks();
+
+		for(size_t i = 0; i < calls; ++i) {
+			uint64_t before = debuglib::clock::ticks();
+
+			switch(call) {
+			case PRINTF:
+				LOG(1, DEBUG, "allocated %u bytes at %p on thread %d", static_cast<unsigned int>(i), static_cast<void*>(&result), thread);
+				break;
+			case EVENT:
+				LOG_EVENT(1, DEBUG, "alloc", LogField("size", i), LogField("addr", &result), LogField("thread", thread));
+				break;
+			case UNREGISTERED:
+				LOG(UNREGISTERED_CHANNEL, DEBUG, "allocated %u bytes at %p on thread %d", static_cast<unsigned int>(i), static_cast<void*>(&result), thread);
+				break;
+			}
+
+			result.mCallTicks.push_back(static_cast<uint32_t>(debuglib::clock::ticksSerialized() - before));
+		}
+
+		result.mTicks = debuglib::clock::ticks() - start;
+	}
+
+	double percentile(std::vector<uint32_t>& samples, double p) {
+		if(samples.empty()) {
+			return 0.0;
+		}
+
+		size_t index = static_cast<size_t>(p * (samples.size() - 1));
+		std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+
+		return static_cast<double>(debuglib::clock::ticksToNanoseconds(samples[index]));
+	}
+
+	/**
+	 * Runs the producers against the currently registered loggers and prints one line of the report
+	 */
+	void measure(const char* name, Call call, unsigned int threads, size_t calls) {
+		std::vector<ThreadResult> results(threads);
+		std::vector<std::thread> producers;
+
+		for(unsigned int i = 0; i < threads; ++i) {
+			producers.push_back(std::thread(producer, call, calls, static_cast<int>(i), std::ref(results[i])));
+		}
+
+		uint64_t ticks = 0;
+		std::vector<uint32_t> callTicks;
+
+		for(unsigned int i = 0; i < threads; ++i) {
+			producers[i].join();
+
+			ticks += results[i].mTicks;
+			callTicks.insert(callTicks.end(), results[i].mCallTicks.begin(), results[i].mCallTicks.end());
+		}
+
+		// buffered outputters are drained outside of the measurement
+		debuglib::logdispatch::LoggerMgr.flush();
+
+		double perCall = static_cast<double>(debuglib::clock::ticksToNanoseconds(ticks)) / (static_cast<double>(calls) * threads);
+		uint32_t worst = callTicks.empty() ? 0 : *std::max_element(callTicks.begin(), callTicks.end());
+
+		std::fprintf(report, "%-28s %7u %10.1f | %8.0f %8.0f %8.0f %10lld\n", name, threads, perCall,
+			percentile(callTicks, 0.5), percentile(callTicks, 0.99), percentile(callTicks, 0.999),
+			static_cast<long long>(debuglib::clock::ticksToNanoseconds(worst)));
+		std::fflush(report);
+	}
+
+	std::string path(const char* fname) {
+		return directory + "/" + fname;
+	}
+
+	void run(unsigned int threads, size_t calls) {
+		{
+			measure("no logger", PRINTF, threads, calls);
+			measure("unregistered channel", UNREGISTERED, threads, calls);
+		}
+		{
+			SimpleLogLevelConsoleLogger logger((LogLevelFilter(ERR)));
+			measure("filtered out (log level)", PRINTF, threads, calls);
+			measure("filtered out, event", EVENT, threads, calls);
+		}
+		{
+			ConsoleLogger logger;
+			measure("console", PRINTF, threads, calls);
+		}
+		{
+			LoggerImpl<NoFilter, TimeFormatter, ConsoleOutputter> logger;
+			measure("console, time formatter", PRINTF, threads, calls);
+		}
+		// std::fstream is not thread safe
+		if(threads == 1) {
+			FileLogger logger(NoFilter(), SimpleFormatter(), FileOutputter(path("ondraluk_bench_file.log").c_str()));
+			measure("file", PRINTF, threads, calls);
+		}
+		{
+			BufferedFileLogger logger(NoFilter(), SimpleFormatter(), BufferedFileOutputter(path("ondraluk_bench_buffered.log").c_str()));
+			measure("buffered file", PRINTF, threads, calls);
+			measure("buffered file, event", EVENT, threads, calls);
+		}
+		{
+			LoggerImpl<NoFilter, JsonLinesFormatter, BufferedFileOutputter> logger(NoFilter(), JsonLinesFormatter(),
+				BufferedFileOutputter(path("ondraluk_bench_json.log").c_str()));
+			measure("buffered file, json event", EVENT, threads, calls);
+		}
+		{
+			MmapFileLogger logger(NoFilter(), SimpleFormatter(), MmapFileOutputter(path("ondraluk_bench_mmap.log").c_str()));
+			measure("mmap file", PRINTF, threads, calls);
+		}
+		{
+			LoggerImpl<NoFilter, SimpleFormatter, PerThreadOutputter<BufferedFileOutputter> > logger(NoFilter(), SimpleFormatter(),
+				PerThreadOutputter<BufferedFileOutputter>(BufferedFileOutputter(path("ondraluk_bench_perthread.log").c_str())));
+			measure("per thread buffers", PRINTF, threads, calls);
+		}
+		{
+			BufferedFileLogger first(NoFilter(), SimpleFormatter(), BufferedFileOutputter(path("ondraluk_bench_fanout0.log").c_str()));
+			BufferedFileLogger second(NoFilter(), SimpleFormatter(), BufferedFileOutputter(path("ondraluk_bench_fanout1.log").c_str()));
+			MmapFileLogger third(NoFilter(), SimpleFormatter(), MmapFileOutputter(path("ondraluk_bench_fanout2.log").c_str()));
+			SimpleLogLevelConsoleLogger filtered((LogLevelFilter(ERR)));
+			measure("fan-out (3 files, 1 filtered)", PRINTF, threads, calls);
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	size_t calls = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 100000;
+	unsigned int maxThreads = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : std::thread::hardware_concurrency();
+
+	if(argc > 3) {
+		directory = argv[3];
+	}
+
+	if(maxThreads == 0) {
+		maxThreads = 1;
+	}
+
+	// keep the report on the terminal, send the console loggers to /dev/null
+	report = fdopen(dup(fileno(stdout)), "w");
+	if(report == nullptr || std::freopen("/dev/null", "w", stdout) == nullptr) {
+		return 1;
+	}
+
+	debuglib::clock::nanosecondsPerTick();
+
+	std::fprintf(report, "%u calls per thread, latencies in ns\n", static_cast<unsigned int>(calls));
+	std::fprintf(report, "%-28s %7s %10s | %8s %8s %8s %10s\n", "configuration", "threads", "ns/call", "p50", "p99", "p999", "max");
+
+	for(unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+		run(threads, calls);
+
+		if(threads < maxThreads && threads * 2 > maxThreads) {
+			run(maxThreads, calls);
+		}
+	}
+
+	std::fclose(report);
+
+	return 0;
+}
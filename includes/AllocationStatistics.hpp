@@ -0,0 +1,83 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file AllocationStatistics.hpp
+ */
+
+#ifndef ALLOCATIONSTATISTICS_HPP
+#define ALLOCATIONSTATISTICS_HPP
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <utility>
+
+namespace ondraluk {
+
+	/**
+	 * AllocationStatistics
+	 *
+	 * Counters of a MemoryManager, updated with relaxed atomics so they can be read from another thread
+	 */
+	struct AllocationStatistics {
+		AllocationStatistics() : mAllocations(0), mDeallocations(0), mBytes(0), mPeakLive(0) {}
+
+		/**
+		 * @return size_t allocations not yet deallocated
+		 */
+		size_t live() const {
+			return mAllocations.load(std::memory_order_relaxed) - mDeallocations.load(std::memory_order_relaxed);
+		}
+
+		std::atomic<size_t> mAllocations;
+		std::atomic<size_t> mDeallocations;
+		// requested bytes of all allocations so far, the deallocation does not know the size
+		std::atomic<size_t> mBytes;
+		std::atomic<size_t> mPeakLive;
+	};
+
+	/**
+	 * StatisticsTrackingPolicy
+	 *
+	 * Tracker for the MemoryManager counting into a shared AllocationStatistics, f.e:
+	 * 	std::shared_ptr<AllocationStatistics> stats = std::make_shared<AllocationStatistics>();
+	 * 	MemoryManager<MallocAllocator, NoBoundsCheckingPolicy, StatisticsTrackingPolicy> manager(MallocAllocator(),
+	 * 		NoBoundsCheckingPolicy(), StatisticsTrackingPolicy(stats));
+	 */
+	class StatisticsTrackingPolicy {
+	public:
+		StatisticsTrackingPolicy() {}
+
+		explicit StatisticsTrackingPolicy(std::shared_ptr<AllocationStatistics> statistics) : mStatistics(std::move(statistics)) {}
+
+		void onAllocate(const void*, size_t size, size_t) const {
+			if(!mStatistics) {
+				return;
+			}
+
+			size_t allocations = mStatistics->mAllocations.fetch_add(1, std::memory_order_relaxed) + 1;
+			mStatistics->mBytes.fetch_add(size, std::memory_order_relaxed);
+
+			size_t live = allocations - mStatistics->mDeallocations.load(std::memory_order_relaxed);
+			size_t peak = mStatistics->mPeakLive.load(std::memory_order_relaxed);
+
+			while(live > peak && !mStatistics->mPeakLive.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+		}
+
+		void onDeallocate(const void*) const {
+			if(mStatistics) {
+				mStatistics->mDeallocations.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		const std::shared_ptr<AllocationStatistics>& statistics() const { return mStatistics; }
+	private:
+		std::shared_ptr<AllocationStatistics> mStatistics;
+	};
+
+}
+
+#endif
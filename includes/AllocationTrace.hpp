@@ -0,0 +1,190 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file AllocationTrace.hpp
+ */
+
+#ifndef ALLOCATIONTRACE_HPP
+#define ALLOCATIONTRACE_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <chrono>
+
+namespace ondraluk {
+
+	/**
+	 * AllocationEvent
+	 *
+	 * One decoded entry of an allocation trace
+	 */
+	struct AllocationEvent {
+		enum TYPE { ALLOCATE = 'A', FREE = 'F' };
+
+		AllocationEvent() : mType(ALLOCATE), mTimestamp(0), mThread(0), mId(0), mSize(0), mAlignment(0) {}
+
+		TYPE mType;
+		// nanoseconds since the recording started
+		uint64_t mTimestamp;
+		// dense index of the recording thread, in order of appearance
+		uint32_t mThread;
+		// dense index of the allocation, starts at 1; a free refers to the id of its allocation
+		uint64_t mId;
+		// requested size in bytes, 0 for frees
+		uint64_t mSize;
+		// alignment in bytes, 0 for frees
+		uint64_t mAlignment;
+	};
+
+	/**
+	 * AllocationTraceWriter
+	 *
+	 * Writes a compact binary allocation trace.
+	 *
+	 * Layout: the magic "OTRC", a little endian uint32 version, followed by the events.
+	 * Every event is its type byte followed by LEB128 varints:
+	 * 	ALLOCATE: timestamp delta, thread, id, size, log2(alignment)
+	 * 	FREE:     timestamp delta, thread, id
+	 * A typical event takes 6-10 bytes.
+	 *
+	 * @remark Thread safe, all recording threads share one writer.
+	 */
+	class AllocationTraceWriter {
+	public:
+		/**
+		 * Constructor
+		 *
+		 * @param fname The trace file, truncated if it exists
+		 */
+		explicit AllocationTraceWriter(const char* fname);
+
+		/**
+		 * Destructor
+		 *
+		 * Flushes and closes the file
+		 */
+		~AllocationTraceWriter();
+
+		/**
+		 * @return bool true if the file could be opened
+		 */
+		bool isOpen() const;
+
+		/**
+		 * allocate
+		 *
+		 * Records an allocation, addr gets a new id
+		 *
+		 * @return void
+		 */
+		void allocate(const void* addr, size_t size, size_t alignment);
+
+		/**
+		 * free
+		 *
+		 * Records the free of a recorded allocation, unknown addresses are ignored
+		 *
+		 * @return void
+		 */
+		void free(const void* addr);
+
+	private:
+		AllocationTraceWriter(const AllocationTraceWriter&);
+		AllocationTraceWriter& operator=(const AllocationTraceWriter&);
+
+		void writeHeader(char type, uint64_t& timestampDelta, uint32_t& thread);
+		void writeVarint(uint64_t value);
+
+		typedef std::chrono::steady_clock Clock;
+
+		std::FILE* mFile;
+		std::mutex mMutex;
+
+		Clock::time_point mStart;
+		uint64_t mLastTimestamp;
+		uint64_t mNextId;
+
+		std::unordered_map<const void*, uint64_t> mLiveIds;
+		std::unordered_map<std::thread::id, uint32_t> mThreads;
+	};
+
+	/**
+	 * AllocationTraceReader
+	 *
+	 * Decodes a trace written by the AllocationTraceWriter
+	 */
+	class AllocationTraceReader {
+	public:
+		/**
+		 * Constructor
+		 *
+		 * @param fname The trace file
+		 */
+		explicit AllocationTraceReader(const char* fname);
+
+		~AllocationTraceReader();
+
+		/**
+		 * @return bool true if the file could be opened and carries a supported header
+		 */
+		bool isOpen() const;
+
+		/**
+		 * next
+		 *
+		 * @param AllocationEvent& event Receives the next event
+		 *
+		 * @return bool false at the end of the trace or on a truncated event
+		 */
+		bool next(AllocationEvent& event);
+
+	private:
+		AllocationTraceReader(const AllocationTraceReader&);
+		AllocationTraceReader& operator=(const AllocationTraceReader&);
+
+		bool readVarint(uint64_t& value);
+
+		std::FILE* mFile;
+		uint64_t mTimestamp;
+	};
+
+	/**
+	 * TraceRecordingPolicy
+	 *
+	 * Tracker for the MemoryManager which records every allocation and deallocation into a trace, f.e:
+	 * 	MemoryManager<LinearAllocator, NoBoundsCheckingPolicy, TraceRecordingPolicy> manager(LinearAllocator(2000),
+	 * 		NoBoundsCheckingPolicy(), TraceRecordingPolicy(std::make_shared<AllocationTraceWriter>("app.trace")));
+	 */
+	class TraceRecordingPolicy {
+	public:
+		TraceRecordingPolicy() {}
+
+		explicit TraceRecordingPolicy(std::shared_ptr<AllocationTraceWriter> writer) : mWriter(std::move(writer)) {}
+
+		void onAllocate(const void* addr, size_t size, size_t alignment) const {
+			if(mWriter) {
+				mWriter->allocate(addr, size, alignment);
+			}
+		}
+
+		void onDeallocate(const void* addr) const {
+			if(mWriter) {
+				mWriter->free(addr);
+			}
+		}
+
+	private:
+		std::shared_ptr<AllocationTraceWriter> mWriter;
+	};
+
+}
+
+#endif
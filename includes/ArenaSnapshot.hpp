@@ -0,0 +1,145 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file ArenaSnapshot.hpp
+ */
+
+#ifndef ARENASNAPSHOT_HPP
+#define ARENASNAPSHOT_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "LinearAllocator.hpp"
+
+namespace ondraluk {
+
+	/**
+	 * RelocationTable
+	 *
+	 * Locations of the pointers inside an arena which point into the same arena and have to be fixed up
+	 * when the snapshot is loaded at another address. OffsetPtr links need no entry.
+	 */
+	class RelocationTable {
+	public:
+		/**
+		 * add
+		 *
+		 * @param T* const& field The pointer member / variable inside the arena, not the pointer value
+		 *
+		 * @return void
+		 */
+		template <typename T>
+		void add(T* const& field) {
+			mFields.push_back(&field);
+		}
+
+		size_t size() const { return mFields.size(); }
+
+		const std::vector<const void*>& fields() const { return mFields; }
+	private:
+		std::vector<const void*> mFields;
+	};
+
+	/**
+	 * ArenaSnapshot
+	 *
+	 * Saves the used part of a LinearAllocator together with a relocation table to a file, and maps such a file
+	 * back in. The region is mapped copy-on-write (MAP_PRIVATE); only the pages holding relocated pointers are
+	 * copied. If the original address is free the region is mapped there and no pointer has to be touched.
+	 *
+	 * The snapshot is only valid for the same binary: the objects are not serialized, vtable pointers and pointers
+	 * outside of the arena are not relocated.
+	 *
+	 * @remark Only available on POSIX systems
+	 */
+	class ArenaSnapshot {
+	public:
+		/**
+		 * save
+		 *
+		 * @param const char* fname
+		 * @param const LinearAllocator& arena
+		 * @param const void* root Entry point of the object graph, inside the arena
+		 * @param const RelocationTable& relocations
+		 *
+		 * @return bool false if the file could not be written or a relocation / the root is outside of the arena
+		 */
+		static bool save(const char* fname, const LinearAllocator& arena, const void* root, const RelocationTable& relocations);
+
+		/**
+		 * Constructor
+		 *
+		 * Maps the snapshot and fixes up the pointers
+		 *
+		 * @param const char* fname
+		 */
+		explicit ArenaSnapshot(const char* fname);
+
+		/**
+		 * Move constructor
+		 * @param
+		 */
+		ArenaSnapshot(ArenaSnapshot&&);
+
+		/**
+		 * Destructor
+		 *
+		 * Unmaps the snapshot, every object in it is gone
+		 */
+		~ArenaSnapshot();
+
+		/**
+		 * @return bool false if the file could not be mapped or is no snapshot
+		 */
+		bool isOpen() const;
+
+		/**
+		 * @return T* the root passed to save, in this mapping
+		 */
+		template <typename T>
+		T* root() const {
+			return static_cast<T*>(mRoot);
+		}
+
+		/**
+		 * @return void* start of the region
+		 */
+		void* data() const;
+
+		/**
+		 * @return size_t size of the region
+		 */
+		size_t size() const;
+
+		/**
+		 * @return bool true if the region was mapped at another address than it was saved from
+		 */
+		bool relocated() const;
+	private:
+		/**
+		 * Private copy constructor
+		 * @param
+		 */
+		ArenaSnapshot(const ArenaSnapshot&);
+
+		/**
+		 * Variables
+		 */
+
+		unsigned char* mRegion;
+
+		size_t mSize;
+
+		void* mRoot;
+
+		bool mRelocated;
+	};
+
+}
+
+#endif
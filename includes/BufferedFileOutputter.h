@@ -0,0 +1,79 @@
+/**
+ *  This file is part of the debuglib project
+ *  Copyright by Christian Ondracek
+ *  Contact: coder[at]paxi.at
+ *
+ *  Buffered file output policy with size/time based rotation
+ */
+
+#ifndef BUFFEREDFILEOUTPUTTER_H
+#define BUFFEREDFILEOUTPUTTER_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace debuglib
+{
+	namespace logger
+	{
+		/**
+		 * Called with the path of a rotated log file on the background worker thread.
+		 * Typically used to compress or ship the file.
+		 */
+		typedef std::function<void(const char* rotatedFile)> CompressionHook;
+
+		/**
+		 * Tuning knobs of the BufferedFileOutputter.
+		 * A value of 0 disables the corresponding flush / rotation trigger.
+		 */
+		struct BufferedFileOutputterConfig {
+			BufferedFileOutputterConfig() : mBufferSize(1 << 20), mFlushIntervalMs(1000), mRotateSize(0), mRotateIntervalSec(0) {}
+
+			// size of the userspace buffer; flushed when full
+			size_t mBufferSize;
+			// maximum age of buffered data before the worker flushes it
+			unsigned int mFlushIntervalMs;
+			// rotate once the current file would grow beyond this many bytes
+			size_t mRotateSize;
+			// rotate once the current file is older than this
+			unsigned int mRotateIntervalSec;
+			// optional, invoked on the worker thread for every rotated file
+			CompressionHook mCompressionHook;
+		};
+
+		// implementation detail, see BufferedFileOutputter.cpp
+		class BufferedFile;
+
+		/**
+		 * Outputting to a file through a large userspace buffer.
+		 *
+		 * @remark Messages are copied into the buffer and written with write/writev once the buffer is full,
+		 *		   the flush interval elapsed or flush() is called. Rotated files are renamed to <fname>.<n>.
+		 *		   Only available on POSIX systems.
+		 */
+		struct BufferedFileOutputter {
+			// c_tor
+			BufferedFileOutputter() {}
+
+			// move constructor
+			BufferedFileOutputter(BufferedFileOutputter&& other) {
+				std::swap(other.mFile, mFile);
+			}
+
+			// c_tor
+			explicit BufferedFileOutputter(const char* fname, const BufferedFileOutputterConfig& config = BufferedFileOutputterConfig());
+
+			void out(const char* msg) const;
+			void flush() const;
+
+			mutable std::shared_ptr<BufferedFile> mFile;
+
+		private:
+			BufferedFileOutputter(const BufferedFileOutputter&);
+			BufferedFileOutputter& operator=(const BufferedFileOutputter& other);
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,191 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file ComposableAllocators.hpp
+ *
+ * Building blocks combining allocators at compile time. Every block is an allocator itself
+ * (allocate(size_t) / free(void*) / owns(const void*)), so they nest and plug into the MemoryManager:
+ *
+ *	typedef FallbackAllocator<
+ *				Segregator<256, Bucketizer<SizedPool<4096>, 0, 256, 32>, LinearAllocator>,
+ *				MallocAllocator> SubsystemAllocator;
+ *
+ * free only gets the pointer, the blocks route it with owns() of the allocator tried first.
+ * Allocators used in that position need an owns() query.
+ */
+
+#ifndef COMPOSABLEALLOCATORS_HPP
+#define COMPOSABLEALLOCATORS_HPP
+
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "PageSource.hpp"
+#include "PoolAllocator.hpp"
+
+namespace ondraluk {
+
+	/**
+	 * FallbackAllocator
+	 *
+	 * Tries Primary first and uses Secondary if Primary returns nullptr.
+	 * Memory owned by Primary is freed there, everything else goes to Secondary.
+	 */
+	template <class Primary, class Secondary>
+	class FallbackAllocator {
+	public:
+		FallbackAllocator(Primary primary = Primary(), Secondary secondary = Secondary()) : mPrimary(std::move(primary)), mSecondary(std::move(secondary)) {}
+
+		void* allocate(size_t size) {
+			void* mem = mPrimary.allocate(size);
+
+			return mem != nullptr ? mem : mSecondary.allocate(size);
+		}
+
+		void free(void* mem) {
+			if(mPrimary.owns(mem)) {
+				mPrimary.free(mem);
+			} else {
+				mSecondary.free(mem);
+			}
+		}
+
+		bool owns(const void* mem) const {
+			return mPrimary.owns(mem) || mSecondary.owns(mem);
+		}
+
+		Primary& primary() { return mPrimary; }
+		Secondary& secondary() { return mSecondary; }
+	private:
+		Primary mPrimary;
+		Secondary mSecondary;
+	};
+
+	/**
+	 * Segregator
+	 *
+	 * Requests of up to Threshold bytes go to Small, larger ones to Large. There is no fallback between them,
+	 * combine with a FallbackAllocator for that.
+	 */
+	template <size_t Threshold, class Small, class Large>
+	class Segregator {
+	public:
+		Segregator(Small small = Small(), Large large = Large()) : mSmall(std::move(small)), mLarge(std::move(large)) {}
+
+		void* allocate(size_t size) {
+			return size <= Threshold ? mSmall.allocate(size) : mLarge.allocate(size);
+		}
+
+		void free(void* mem) {
+			if(mSmall.owns(mem)) {
+				mSmall.free(mem);
+			} else {
+				mLarge.free(mem);
+			}
+		}
+
+		bool owns(const void* mem) const {
+			return mSmall.owns(mem) || mLarge.owns(mem);
+		}
+
+		Small& small() { return mSmall; }
+		Large& large() { return mLarge; }
+	private:
+		Small mSmall;
+		Large mLarge;
+	};
+
+	/**
+	 * Bucketizer
+	 *
+	 * One Alloc per size class: bucket i serves requests in (Min + i * Step, Min + (i + 1) * Step].
+	 * Requests outside of (Min, Max] return nullptr. free looks the owner up through owns() of every bucket.
+	 *
+	 * The buckets are constructed with their maximum request size, either directly (Alloc(size_t)) or through a factory.
+	 */
+	template <class Alloc, size_t Min, size_t Max, size_t Step>
+	class Bucketizer {
+		static_assert(Step > 0, "Step == 0");
+		static_assert(Max > Min, "Max <= Min");
+		static_assert((Max - Min) % Step == 0, "Max - Min is not a multiple of Step");
+
+	public:
+		static const size_t BUCKETS = (Max - Min) / Step;
+
+		Bucketizer() {
+			mBuckets.reserve(BUCKETS);
+
+			for(size_t i = 0; i < BUCKETS; ++i) {
+				mBuckets.push_back(Alloc(bucketSize(i)));
+			}
+		}
+
+		/**
+		 * @param factory - called with the maximum request size of every bucket, returns the Alloc
+		 */
+		template <class Factory>
+		explicit Bucketizer(Factory factory) {
+			mBuckets.reserve(BUCKETS);
+
+			for(size_t i = 0; i < BUCKETS; ++i) {
+				mBuckets.push_back(factory(bucketSize(i)));
+			}
+		}
+
+		void* allocate(size_t size) {
+			if(size <= Min || size > Max) {
+				return nullptr;
+			}
+
+			return mBuckets[(size - Min - 1) / Step].allocate(size);
+		}
+
+		void free(void* mem) {
+			for(size_t i = 0; i < BUCKETS; ++i) {
+				if(mBuckets[i].owns(mem)) {
+					mBuckets[i].free(mem);
+					return;
+				}
+			}
+		}
+
+		bool owns(const void* mem) const {
+			for(size_t i = 0; i < BUCKETS; ++i) {
+				if(mBuckets[i].owns(mem)) {
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		Alloc& bucket(size_t i) { return mBuckets[i]; }
+
+		static size_t bucketSize(size_t i) { return Min + (i + 1) * Step; }
+	private:
+		std::vector<Alloc> mBuckets;
+	};
+
+	template <class Alloc, size_t Min, size_t Max, size_t Step>
+	const size_t Bucketizer<Alloc, Min, Max, Step>::BUCKETS;
+
+	/**
+	 * SizedPool
+	 *
+	 * PoolAllocator with the block count fixed at compile time, so a Bucketizer can construct it from the block size alone
+	 */
+	template <size_t BlockCount, PAGEBACKEND::ENUM Backend = PAGEBACKEND::MALLOC>
+	class SizedPool : public PoolAllocator {
+	public:
+		explicit SizedPool(size_t blockSize) : PoolAllocator(blockSize, BlockCount, Backend) {}
+
+		SizedPool(SizedPool&& other) : PoolAllocator(std::move(other)) {}
+	};
+
+}
+
+#endif
@@ -0,0 +1,272 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file CoroutineFrames.hpp
+ */
+
+#ifndef COROUTINEFRAMES_HPP
+#define COROUTINEFRAMES_HPP
+
+#if !defined(__cpp_impl_coroutine)
+#error "CoroutineFrames.hpp needs C++20 coroutines"
+#endif
+
+#include "MallocAllocator.hpp"
+#include "MemoryManager.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace ondraluk {
+
+	/**
+	 * FramePool
+	 *
+	 * Size bucketed cache of coroutine frames in front of a MemoryManager, meant to be used by one thread.
+	 * Frames up to BUCKETS * GRANULARITY bytes are rounded up to their bucket and kept on a free list of the
+	 * bucket when freed, at most maxCached per bucket. Larger frames and the overflow go back to the manager.
+	 *
+	 * @remark A frame may be freed by another thread's pool (a coroutine resumed elsewhere), so the allocator
+	 *		   of the manager has to be thread safe.
+	 */
+	template <class Manager>
+	class FramePool {
+	public:
+		static const size_t GRANULARITY = 64;
+		static const size_t BUCKETS = 64;
+
+		/**
+		 * Constructor
+		 *
+		 * @param Manager& manager - shared by the pools of all threads
+		 * @param size_t maxCached - frames kept per bucket
+		 */
+		explicit FramePool(Manager& manager, size_t maxCached = 64) : mManager(manager), mMaxCached(maxCached), mHits(0), mMisses(0) {
+			for(size_t i = 0; i < BUCKETS; ++i) {
+				mFree[i] = nullptr;
+				mCached[i] = 0;
+			}
+		}
+
+		/**
+		 * Destructor
+		 *
+		 * Returns the cached frames to the manager
+		 */
+		~FramePool() {
+			for(size_t i = 0; i < BUCKETS; ++i) {
+				while(mFree[i] != nullptr) {
+					FreeFrame* frame = mFree[i];
+					mFree[i] = frame->mNext;
+					mManager.template deallocate<unsigned char, ARRAY::YES>(reinterpret_cast<unsigned char*>(frame));
+				}
+			}
+		}
+
+		/**
+		 * allocate
+		 *
+		 * @param size_t size
+		 *
+		 * @return void* nullptr if the manager is out of memory
+		 */
+		void* allocate(size_t size) {
+			size_t bucket = bucketOf(size);
+
+			if(bucket < BUCKETS && mFree[bucket] != nullptr) {
+				FreeFrame* frame = mFree[bucket];
+				mFree[bucket] = frame->mNext;
+				--mCached[bucket];
+				++mHits;
+
+				return frame;
+			}
+
+			++mMisses;
+
+			return mManager.template allocate<unsigned char>(bucket < BUCKETS ? (bucket + 1) * GRANULARITY : size);
+		}
+
+		/**
+		 * deallocate
+		 *
+		 * @param void* frame
+		 * @param size_t size - as passed to allocate
+		 *
+		 * @return void
+		 */
+		void deallocate(void* frame, size_t size) {
+			size_t bucket = bucketOf(size);
+
+			if(bucket < BUCKETS && mCached[bucket] < mMaxCached) {
+				FreeFrame* free = static_cast<FreeFrame*>(frame);
+				free->mNext = mFree[bucket];
+				mFree[bucket] = free;
+				++mCached[bucket];
+				return;
+			}
+
+			mManager.template deallocate<unsigned char, ARRAY::YES>(static_cast<unsigned char*>(frame));
+		}
+
+		// allocations served from the cache / by the manager
+		size_t hits() const { return mHits; }
+		size_t misses() const { return mMisses; }
+	private:
+		FramePool(const FramePool&);
+		FramePool& operator=(const FramePool&);
+
+		struct FreeFrame {
+			FreeFrame* mNext;
+		};
+
+		static size_t bucketOf(size_t size) {
+			return size > 0 ? (size - 1) / GRANULARITY : 0;
+		}
+
+		Manager& mManager;
+
+		size_t mMaxCached;
+
+		FreeFrame* mFree[BUCKETS];
+		size_t mCached[BUCKETS];
+
+		size_t mHits;
+		size_t mMisses;
+	};
+
+	/**
+	 * Pool source of the FramePromise: one FramePool per thread in front of one process wide malloc backed
+	 * MemoryManager. Other sources implement the same static local().
+	 */
+	struct ThreadFramePool {
+		typedef MemoryManager<MallocAllocator, NoBoundsCheckingPolicy> Manager;
+
+		static FramePool<Manager>& local() {
+			// constructed before the first pool, so it outlives the pools of all threads
+			static Manager manager;
+			thread_local FramePool<Manager> pool(manager);
+
+			return pool;
+		}
+	};
+
+	/**
+	 * Arena the frames of the calling thread come from, see FrameArenaScope
+	 */
+	struct FrameArenaBinding {
+		void* mArena;
+		void* (*mAllocate)(void* arena, size_t size);
+	};
+
+	inline FrameArenaBinding& frameArena() {
+		thread_local FrameArenaBinding binding = { nullptr, nullptr };
+
+		return binding;
+	}
+
+	/**
+	 * FrameArenaScope
+	 *
+	 * While the scope lives, coroutines with a FramePromise created by this thread get their frame from the arena
+	 * (anything with allocate(size), f.e. a request scoped LinearAllocator) instead of the FramePool:
+	 * 	{
+	 * 		FrameArenaScope<LinearAllocator> frames(arena);
+	 * 		handle(request).run();
+	 * 	}
+	 * 	arena.free(arena.data());
+	 *
+	 * Arena frames are never freed one by one, the arena has to outlive the coroutines and is reset as a whole.
+	 * Coroutines created by a lazy coroutine resumed after the scope ended, or on another thread, use the pool.
+	 * Scopes nest, the innermost wins.
+	 */
+	template <class Arena>
+	class FrameArenaScope {
+	public:
+		explicit FrameArenaScope(Arena& arena) : mPrevious(frameArena()) {
+			frameArena().mArena = &arena;
+			frameArena().mAllocate = &allocateFrom;
+		}
+
+		~FrameArenaScope() {
+			frameArena() = mPrevious;
+		}
+	private:
+		FrameArenaScope(const FrameArenaScope&);
+		FrameArenaScope& operator=(const FrameArenaScope&);
+
+		static void* allocateFrom(void* arena, size_t size) {
+			return static_cast<Arena*>(arena)->allocate(size);
+		}
+
+		FrameArenaBinding mPrevious;
+	};
+
+	/**
+	 * FramePromise
+	 *
+	 * Mixin for promise types routing the frame allocation of the coroutine away from the global operator new:
+	 * 	struct promise_type : ondraluk::FramePromise<> { ... };
+	 *
+	 * Frames come from the FramePool of the calling thread, or from the arena of an active FrameArenaScope.
+	 * Throws std::bad_alloc if out of memory.
+	 *
+	 * @remark The arena is bound by a scope rather than a std::allocator_arg parameter: that needs a function
+	 *		   template operator new, and gcc 12 reports every frame delete after it as -Wmismatched-new-delete.
+	 */
+	template <class Pool = ThreadFramePool>
+	struct FramePromise {
+		// alignment of the frames, like the global operator new
+		static const size_t FRAME_ALIGNMENT = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+		static void* operator new(size_t size) {
+			const FrameArenaBinding& arena = frameArena();
+
+			if(arena.mArena != nullptr) {
+				return place(arena.mAllocate(arena.mArena, size + OVERHEAD), false);
+			}
+
+			return place(Pool::local().allocate(size + OVERHEAD), true);
+		}
+
+		static void operator delete(void* frame, size_t size) {
+			const FramePrefix* prefix = static_cast<const FramePrefix*>(frame) - 1;
+
+			if(prefix->mPooled) {
+				Pool::local().deallocate(prefix->mBlock, size + OVERHEAD);
+			}
+		}
+	private:
+		/**
+		 * Stored right in front of every frame, the block of the pool / arena holding it
+		 */
+		struct FramePrefix {
+			void* mBlock;
+			size_t mPooled;
+		};
+
+		// the prefix plus the worst case alignment of the block
+		static const size_t OVERHEAD = sizeof(FramePrefix) + FRAME_ALIGNMENT;
+
+		static void* place(void* block, bool pooled) {
+			if(block == nullptr) {
+				throw std::bad_alloc();
+			}
+
+			uintptr_t frame = (reinterpret_cast<uintptr_t>(block) + sizeof(FramePrefix) + FRAME_ALIGNMENT - 1) & ~(FRAME_ALIGNMENT - 1);
+			FramePrefix* prefix = reinterpret_cast<FramePrefix*>(frame) - 1;
+
+			prefix->mBlock = block;
+			prefix->mPooled = pooled;
+
+			return reinterpret_cast<void*>(frame);
+		}
+	};
+
+}
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ *  This file is part of the debuglib project
+ *  Copyright by Christian Ondracek
+ *  Contact: coder[at]paxi.at
+ *
+ *  Cheap timestamp sources for hot paths
+ */
+
+#ifndef CYCLECLOCK_H
+#define CYCLECLOCK_H
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h>
+#endif
+
+#ifndef _WIN32
+	#include <time.h>
+#endif
+
+namespace debuglib
+{
+	namespace clock
+	{
+		/**
+		 * Reads the time stamp counter.
+		 * Falls back to the steady clock in nanoseconds on architectures without a TSC.
+		 */
+		inline uint64_t ticks() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+			return __rdtsc();
+#else
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+		}
+
+		/**
+		 * Reads the time stamp counter after all previous instructions retired (rdtscp).
+		 * Used to close a measured interval.
+		 */
+		inline uint64_t ticksSerialized() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+			unsigned int aux;
+			return __rdtscp(&aux);
+#else
+			return ticks();
+#endif
+		}
+
+		/**
+		 * Monotonic nanoseconds from the cheapest clock of the platform.
+		 *
+		 * @remark On Linux this is CLOCK_MONOTONIC_COARSE which is served from the vDSO without reading
+		 *		   any hardware counter; its resolution is one scheduler tick (1-4 ms).
+		 */
+		inline int64_t coarseNanoseconds() {
+#if defined(CLOCK_MONOTONIC_COARSE)
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+			return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+		}
+
+		/**
+		 * Conversion factor from ticks() to nanoseconds.
+		 *
+		 * @remark Calibrated once against the steady clock on first use (busy waits ~5 ms).
+		 *		   Assumes an invariant TSC, which is the case on every x86 cpu of the last decade.
+		 */
+		inline double nanosecondsPerTick() {
+			struct Calibration {
+				Calibration() : mNsPerTick(1.0) {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+					typedef std::chrono::steady_clock Clock;
+
+					Clock::time_point start = Clock::now();
+					uint64_t startTicks = ticks();
+					Clock::time_point now;
+
+					do {
+						now = Clock::now();
+					} while(now - start < std::chrono::milliseconds(5));
+
+					uint64_t elapsedTicks = ticks() - startTicks;
+					double elapsedNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count());
+
+					if(elapsedTicks > 0) {
+						mNsPerTick = elapsedNs / static_cast<double>(elapsedTicks);
+					}
+#endif
+				}
+
+				double mNsPerTick;
+			};
+
+			static const Calibration calibration;
+			return calibration.mNsPerTick;
+		}
+
+		/**
+		 * Converts a tick delta into nanoseconds.
+		 */
+		inline int64_t ticksToNanoseconds(uint64_t ticks) {
+			return static_cast<int64_t>(static_cast<double>(ticks) * nanosecondsPerTick());
+		}
+	}
+}
+
+#endif
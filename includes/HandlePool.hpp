@@ -0,0 +1,440 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file HandlePool.hpp
+ */
+
+#ifndef HANDLEPOOL_HPP
+#define HANDLEPOOL_HPP
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "MemoryManager.hpp"
+
+namespace ondraluk {
+
+	/**
+	 * Handle
+	 *
+	 * Slot index and generation packed into one integer. 32 bit handles address 2^20 objects with 12 bits of generation,
+	 * 64 bit handles 2^32 objects with 32 bits of generation. The generation starts at 1, a value of 0 is the null handle.
+	 */
+	template <typename Int>
+	struct Handle {
+		static const unsigned int INDEX_BITS = sizeof(Int) == 4 ? 20 : 32;
+		static const unsigned int GENERATION_BITS = sizeof(Int) * 8 - INDEX_BITS;
+		static const Int INDEX_MASK = (static_cast<Int>(1) << INDEX_BITS) - 1;
+		static const Int GENERATION_MASK = (static_cast<Int>(1) << GENERATION_BITS) - 1;
+
+		Handle() : mValue(0) {}
+
+		static Handle make(Int index, Int generation) {
+			Handle handle;
+			handle.mValue = (generation << INDEX_BITS) | (index & INDEX_MASK);
+			return handle;
+		}
+
+		Int index() const { return mValue & INDEX_MASK; }
+		Int generation() const { return mValue >> INDEX_BITS; }
+		bool isNull() const { return mValue == 0; }
+
+		bool operator==(const Handle& other) const { return mValue == other.mValue; }
+		bool operator!=(const Handle& other) const { return mValue != other.mValue; }
+
+		Int mValue;
+	};
+
+	template <typename Int> const unsigned int Handle<Int>::INDEX_BITS;
+	template <typename Int> const unsigned int Handle<Int>::GENERATION_BITS;
+	template <typename Int> const Int Handle<Int>::INDEX_MASK;
+	template <typename Int> const Int Handle<Int>::GENERATION_MASK;
+
+	typedef Handle<uint32_t> Handle32;
+	typedef Handle<uint64_t> Handle64;
+
+	/**
+	 * HandlePool
+	 *
+	 * Object pool handing out generational handles instead of T*. A handle of a destroyed object never resolves again
+	 * (until its generation wraps), so use-after-free is caught with one compare.
+	 *
+	 * The objects live densely in one array, the slot table (handle -> dense position), the back references
+	 * (dense position -> slot) and the liveness flags are kept in separate arrays, so iterating the objects only
+	 * touches the object array. Destroying leaves a hole which is refilled by the next create; compact() closes
+	 * holes incrementally by moving the last live objects down.
+	 *
+	 * All storage is allocated once through the given MemoryManager. If the manager can not provide it the pool
+	 * is invalid: capacity() is 0 and create() returns null handles.
+	 *
+	 * @remark Pointers returned by get() are invalidated by compact(), keep the handles
+	 */
+	template <typename T, class Manager, typename Int = uint32_t>
+	class HandlePool {
+	public:
+		typedef ondraluk::Handle<Int> Handle;
+
+		/**
+		 * Constructor
+		 *
+		 * @param manager - provides the storage, must outlive the pool
+		 * @param capacity - maximum number of live objects, at most 2^INDEX_BITS
+		 */
+		HandlePool(Manager& manager, size_t capacity);
+
+		/**
+		 * Destructor
+		 *
+		 * Destroys the remaining objects
+		 */
+		~HandlePool();
+
+		/**
+		 * create
+		 *
+		 * Constructs a T from args at the lowest free position
+		 *
+		 * @return Handle null handle if the pool is full
+		 */
+		template <typename... Args>
+		Handle create(Args&&... args);
+
+		/**
+		 * destroy
+		 *
+		 * @param Handle handle
+		 *
+		 * @return bool false for stale or null handles
+		 */
+		bool destroy(Handle handle);
+
+		/**
+		 * get
+		 *
+		 * @param Handle handle
+		 *
+		 * @return T* nullptr for stale or null handles
+		 */
+		T* get(Handle handle) const;
+
+		/**
+		 * compact
+		 *
+		 * Moves up to maxMoves live objects from the end of the dense array into holes
+		 *
+		 * @param size_t maxMoves
+		 *
+		 * @return size_t number of objects moved
+		 */
+		size_t compact(size_t maxMoves);
+
+		/**
+		 * forEach
+		 *
+		 * Calls f(T&) for every live object in dense order
+		 */
+		template <typename F>
+		void forEach(F f);
+
+		/**
+		 * @return size_t number of live objects
+		 */
+		size_t size() const { return mEnd - mHoles; }
+
+		/**
+		 * @return size_t number of holes below the end of the dense array
+		 */
+		size_t holes() const { return mHoles; }
+
+		/**
+		 * @return size_t end of the dense array, size() + holes()
+		 */
+		size_t extent() const { return mEnd; }
+
+		size_t capacity() const { return mCapacity; }
+
+		/**
+		 * @return bool false if the storage could not be allocated
+		 */
+		bool isValid() const { return mCapacity > 0; }
+	private:
+		HandlePool(const HandlePool&);
+		HandlePool& operator=(const HandlePool&);
+
+		struct Slot {
+			// dense position while the slot is used, next free slot otherwise
+			uint32_t mDense;
+			Int mGeneration;
+		};
+
+		static const uint32_t NONE = 0xFFFFFFFF;
+
+		// nullptr if the manager is exhausted
+		template <typename U>
+		U* allocateArray(size_t n, unsigned char*& raw);
+
+		void deallocateArrays();
+
+		void release(size_t dense);
+
+		size_t lowestHole();
+
+		// moves the object at src to the raw memory at dest and ends the lifetime of src
+		static void relocate(std::true_type /* trivially copyable */, T* dest, T* src);
+		static void relocate(std::false_type, T* dest, T* src);
+
+		/**
+		 * Variables
+		 */
+
+		Manager& mManager;
+
+		size_t mCapacity;
+
+		T* mObjects;
+		uint32_t* mDenseToSlot;
+		bool* mAlive;
+		Slot* mSlots;
+
+		unsigned char* mObjectsRaw;
+		unsigned char* mDenseToSlotRaw;
+		unsigned char* mAliveRaw;
+		unsigned char* mSlotsRaw;
+
+		size_t mEnd;
+		size_t mHoles;
+		// no hole below this position
+		size_t mHoleHint;
+
+		uint32_t mFreeSlot;
+	};
+
+	template <typename T, class Manager, typename Int>
+	const uint32_t HandlePool<T, Manager, Int>::NONE;
+
+	template <typename T, class Manager, typename Int>
+	HandlePool<T, Manager, Int>::HandlePool(Manager& manager, size_t capacity) : mManager(manager), mCapacity(capacity), mEnd(0), mHoles(0), mHoleHint(0),
+																				  mFreeSlot(NONE) {
+		assert(capacity > 0 && capacity <= static_cast<size_t>(Handle::INDEX_MASK) + 1 && capacity < NONE);
+
+		mObjects = allocateArray<T>(capacity, mObjectsRaw);
+		mDenseToSlot = allocateArray<uint32_t>(capacity, mDenseToSlotRaw);
+		mAlive = allocateArray<bool>(capacity, mAliveRaw);
+		mSlots = allocateArray<Slot>(capacity, mSlotsRaw);
+
+		if(mObjects == nullptr || mDenseToSlot == nullptr || mAlive == nullptr || mSlots == nullptr) {
+			deallocateArrays();
+
+			mObjects = nullptr;
+			mDenseToSlot = nullptr;
+			mAlive = nullptr;
+			mSlots = nullptr;
+			mCapacity = 0;
+			return;
+		}
+
+		// chain all slots into the free list, lowest first
+		for(size_t i = 0; i < capacity; ++i) {
+			mSlots[i].mDense = i + 1 < capacity ? static_cast<uint32_t>(i + 1) : NONE;
+			mSlots[i].mGeneration = 1;
+		}
+		mFreeSlot = 0;
+	}
+
+	template <typename T, class Manager, typename Int>
+	HandlePool<T, Manager, Int>::~HandlePool() {
+		for(size_t i = 0; i < mEnd; ++i) {
+			if(mAlive[i]) {
+				mObjects[i].~T();
+			}
+		}
+
+		deallocateArrays();
+	}
+
+	template <typename T, class Manager, typename Int>
+	void HandlePool<T, Manager, Int>::deallocateArrays() {
+		// null for arrays which could not be allocated, the manager ignores them
+		mManager.template deallocate<unsigned char, ARRAY::YES>(mSlotsRaw);
+		mManager.template deallocate<unsigned char, ARRAY::YES>(mAliveRaw);
+		mManager.template deallocate<unsigned char, ARRAY::YES>(mDenseToSlotRaw);
+		mManager.template deallocate<unsigned char, ARRAY::YES>(mObjectsRaw);
+
+		mSlotsRaw = nullptr;
+		mAliveRaw = nullptr;
+		mDenseToSlotRaw = nullptr;
+		mObjectsRaw = nullptr;
+	}
+
+	template <typename T, class Manager, typename Int>
+	template <typename U>
+	U* HandlePool<T, Manager, Int>::allocateArray(size_t n, unsigned char*& raw) {
+		// the MemoryManager header does not keep the alignment of the allocator
+		raw = mManager.template allocate<unsigned char>(n * sizeof(U) + alignof(U));
+
+		if(raw == nullptr) {
+			return nullptr;
+		}
+
+		uintptr_t address = reinterpret_cast<uintptr_t>(raw);
+		address = (address + alignof(U) - 1) & ~(static_cast<uintptr_t>(alignof(U)) - 1);
+
+		return reinterpret_cast<U*>(address);
+	}
+
+	template <typename T, class Manager, typename Int>
+	template <typename... Args>
+	typename HandlePool<T, Manager, Int>::Handle HandlePool<T, Manager, Int>::create(Args&&... args) {
+		if(mFreeSlot == NONE) {
+			return Handle();
+		}
+
+		size_t dense = mHoles > 0 ? lowestHole() : mEnd;
+
+		new (&mObjects[dense]) T(std::forward<Args>(args)...);
+
+		uint32_t slot = mFreeSlot;
+		mFreeSlot = mSlots[slot].mDense;
+
+		mSlots[slot].mDense = static_cast<uint32_t>(dense);
+		mDenseToSlot[dense] = slot;
+		mAlive[dense] = true;
+
+		if(dense == mEnd) {
+			++mEnd;
+		} else {
+			--mHoles;
+			mHoleHint = dense + 1;
+		}
+
+		return Handle::make(slot, mSlots[slot].mGeneration);
+	}
+
+	template <typename T, class Manager, typename Int>
+	bool HandlePool<T, Manager, Int>::destroy(Handle handle) {
+		if(get(handle) == nullptr) {
+			return false;
+		}
+
+		Slot& slot = mSlots[handle.index()];
+		size_t dense = slot.mDense;
+
+		mObjects[dense].~T();
+		release(dense);
+
+		// skip 0 on wrap around, the null handle must never resolve
+		slot.mGeneration = (slot.mGeneration + 1) & Handle::GENERATION_MASK;
+		if(slot.mGeneration == 0) {
+			slot.mGeneration = 1;
+		}
+
+		slot.mDense = mFreeSlot;
+		mFreeSlot = static_cast<uint32_t>(handle.index());
+
+		return true;
+	}
+
+	template <typename T, class Manager, typename Int>
+	T* HandlePool<T, Manager, Int>::get(Handle handle) const {
+		Int index = handle.index();
+
+		if(handle.isNull() || index >= mCapacity || mSlots[index].mGeneration != handle.generation()) {
+			return nullptr;
+		}
+
+		size_t dense = mSlots[index].mDense;
+
+		return dense < mEnd && mAlive[dense] && mDenseToSlot[dense] == index ? &mObjects[dense] : nullptr;
+	}
+
+	template <typename T, class Manager, typename Int>
+	void HandlePool<T, Manager, Int>::release(size_t dense) {
+		mAlive[dense] = false;
+
+		if(dense + 1 == mEnd) {
+			--mEnd;
+
+			// trailing holes are not holes
+			while(mEnd > 0 && !mAlive[mEnd - 1]) {
+				--mEnd;
+				--mHoles;
+			}
+		} else {
+			++mHoles;
+
+			if(dense < mHoleHint) {
+				mHoleHint = dense;
+			}
+		}
+
+		if(mHoleHint > mEnd) {
+			mHoleHint = mEnd;
+		}
+	}
+
+	template <typename T, class Manager, typename Int>
+	size_t HandlePool<T, Manager, Int>::lowestHole() {
+		while(mAlive[mHoleHint]) {
+			++mHoleHint;
+		}
+
+		return mHoleHint;
+	}
+
+	template <typename T, class Manager, typename Int>
+	size_t HandlePool<T, Manager, Int>::compact(size_t maxMoves) {
+		size_t moves = 0;
+
+		while(moves < maxMoves && mHoles > 0) {
+			size_t hole = lowestHole();
+			size_t last = mEnd - 1;
+			uint32_t slot = mDenseToSlot[last];
+
+			relocate(std::integral_constant<bool, std::is_trivially_copyable<T>::value>(), &mObjects[hole], &mObjects[last]);
+
+			mSlots[slot].mDense = static_cast<uint32_t>(hole);
+			mDenseToSlot[hole] = slot;
+			mAlive[hole] = true;
+
+			--mHoles;
+			mHoleHint = hole + 1;
+			release(last);
+
+			++moves;
+		}
+
+		return moves;
+	}
+
+	template <typename T, class Manager, typename Int>
+	void HandlePool<T, Manager, Int>::relocate(std::true_type, T* dest, T* src) {
+		memcpy(static_cast<void*>(dest), src, sizeof(T));
+	}
+
+	template <typename T, class Manager, typename Int>
+	void HandlePool<T, Manager, Int>::relocate(std::false_type, T* dest, T* src) {
+		new (dest) T(std::move(*src));
+		src->~T();
+	}
+
+	template <typename T, class Manager, typename Int>
+	template <typename F>
+	void HandlePool<T, Manager, Int>::forEach(F f) {
+		for(size_t i = 0; i < mEnd; ++i) {
+			if(mAlive[i]) {
+				f(mObjects[i]);
+			}
+		}
+	}
+
+}
+
+#endif
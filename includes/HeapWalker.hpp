@@ -0,0 +1,376 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file HeapWalker.hpp
+ */
+
+#ifndef HEAPWALKER_HPP
+#define HEAPWALKER_HPP
+
+#include "PoolAllocator.hpp"
+#include "SharedMemoryAllocator.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ondraluk {
+
+	class LinearAllocator;
+	class VirtualArenaAllocator;
+
+	/**
+	 * One used or free region of an allocator, offset from the start of its memory
+	 */
+	struct HeapBlock {
+		HeapBlock() : mOffset(0), mSize(0), mUsed(false) {}
+		HeapBlock(size_t offset, size_t size, bool used) : mOffset(offset), mSize(size), mUsed(used) {}
+
+		size_t mOffset;
+		size_t mSize;
+		bool mUsed;
+	};
+
+	/**
+	 * FragmentationReport
+	 *
+	 * Fragmentation metrics over the blocks of one walk. Adjacent free blocks should be added as one.
+	 */
+	class FragmentationReport {
+	public:
+		// bucket i counts free blocks of [2^i, 2^(i+1)) bytes
+		static const unsigned int BUCKETS = 64;
+
+		FragmentationReport();
+
+		void add(const HeapBlock& block);
+
+		void clear();
+
+		size_t usedBytes() const { return mUsedBytes; }
+		size_t freeBytes() const { return mFreeBytes; }
+		size_t usedBlocks() const { return mUsedBlocks; }
+		size_t freeBlocks() const { return mFreeBlocks; }
+		size_t largestFree() const { return mLargestFree; }
+		size_t freeHistogram(unsigned int bucket) const { return mFreeHistogram[bucket]; }
+
+		/**
+		 * @return double 1 - largestFree / freeBytes: 0 if all free memory is one block, towards 1 the more it is split
+		 */
+		double externalFragmentation() const;
+
+		/**
+		 * Writes the totals and the non-empty buckets of the free block histogram
+		 */
+		void write(std::ostream& out) const;
+	private:
+		size_t mUsedBytes;
+		size_t mFreeBytes;
+		size_t mUsedBlocks;
+		size_t mFreeBlocks;
+		size_t mLargestFree;
+		size_t mFreeHistogram[BUCKETS];
+	};
+
+	/**
+	 * HeapMap
+	 *
+	 * Compact map of a heap: the heap is split into cells of equal size, each counting its used bytes
+	 */
+	class HeapMap {
+	public:
+		/**
+		 * Constructor
+		 *
+		 * @param size_t heapSize
+		 * @param size_t cells - fewer if the heap is smaller
+		 */
+		explicit HeapMap(size_t heapSize = 0, size_t cells = 64);
+
+		void add(const HeapBlock& block);
+
+		void clear();
+
+		size_t heapSize() const { return mHeapSize; }
+		size_t cellSize() const { return mCellSize; }
+		const std::vector<size_t>& cells() const { return mCells; }
+
+		/**
+		 * @return std::string one character per cell: '.' free, '1' - '9' tenths used, '#' full
+		 */
+		std::string str() const;
+
+		/**
+		 * Writes {"heapSize": .., "cellSize": .., "used": [bytes per cell]}
+		 */
+		void writeJson(std::ostream& out) const;
+	private:
+		size_t mHeapSize;
+		size_t mCellSize;
+		std::vector<size_t> mCells;
+	};
+
+	/**
+	 * Result of one step of a walk
+	 */
+	struct WALKSTEP {
+		enum ENUM {
+			MORE,
+			DONE,
+			// the allocator changed since the last step, the blocks seen so far are stale
+			RESTARTED,
+			// RESTARTED, and the new walk completed within the step
+			RESTARTED_DONE
+		};
+	};
+
+	/**
+	 * HeapLayout
+	 *
+	 * Specialized for every allocator that can be walked:
+	 * 	struct State;	 								position of a walk, default constructed for a new one
+	 * 	static size_t size(const Alloc&);				bytes covered by the blocks
+	 * 	static WALKSTEP::ENUM step(const Alloc&, State&, std::vector<HeapBlock>& blocks, size_t budget);
+	 *
+	 * step appends the next blocks in address order to blocks, doing about budget units of work (blocks, slots,
+	 * free list links) so a walk can be spread over frames. With a budget of SIZE_MAX a step must not stop
+	 * inside a part of the walk that can start over, so repeating it always reaches DONE.
+	 */
+	template <class Alloc>
+	struct HeapLayout;
+
+	template <>
+	struct HeapLayout<LinearAllocator> {
+		struct State {
+			State() : mDone(false) {}
+
+			bool mDone;
+		};
+
+		static size_t size(const LinearAllocator& allocator);
+		static WALKSTEP::ENUM step(const LinearAllocator& allocator, State& state, std::vector<HeapBlock>& blocks, size_t budget);
+	};
+
+	/**
+	 * Marks the free slots first (incremental PoolAllocator::markFree, starts over if the pool changes), then
+	 * emits runs of used and free slots. The untouched tail is one free block.
+	 */
+	template <>
+	struct HeapLayout<PoolAllocator> {
+		struct State {
+			State() : mMarked(false), mSlot(0), mDone(false) {}
+
+			PoolAllocator::FreeListCursor mCursor;
+			std::vector<bool> mUsed;
+			bool mMarked;
+			size_t mSlot;
+			bool mDone;
+		};
+
+		static size_t size(const PoolAllocator& allocator);
+		static WALKSTEP::ENUM step(const PoolAllocator& allocator, State& state, std::vector<HeapBlock>& blocks, size_t budget);
+	};
+
+	/**
+	 * Used part and committed free part, the reserved address space beyond is not memory
+	 */
+	template <>
+	struct HeapLayout<VirtualArenaAllocator> {
+		struct State {
+			State() : mDone(false) {}
+
+			bool mDone;
+		};
+
+		static size_t size(const VirtualArenaAllocator& allocator);
+		static WALKSTEP::ENUM step(const VirtualArenaAllocator& allocator, State& state, std::vector<HeapBlock>& blocks, size_t budget);
+	};
+
+	/**
+	 * Every block of the segment including the block headers, the segment header counts as used
+	 */
+	template <>
+	struct HeapLayout<SharedMemoryAllocator> {
+		typedef SharedHeapCursor State;
+
+		static size_t size(const SharedMemoryAllocator& allocator);
+		static WALKSTEP::ENUM step(const SharedMemoryAllocator& allocator, State& state, std::vector<HeapBlock>& blocks, size_t budget);
+	};
+
+	/**
+	 * HeapWalker
+	 *
+	 * Walks the layout of an allocator step by step into a FragmentationReport and a HeapMap, f.e. a few hundred
+	 * blocks per frame:
+	 * 	HeapWalker<PoolAllocator> walker(pool);
+	 * 	...
+	 * 	if(walker.step(256)) { walker.report().write(std::cout); walker.restart(); }
+	 *
+	 * Adjacent free blocks are merged before they are counted. If the allocator changes while a walk is
+	 * spread over steps the layout either starts over (pool free list, shared memory) or the blocks are a
+	 * mix of both states (linear, virtual arena: single step, so never).
+	 * A walk starts over at most maxRestarts times: after that the next step walks the rest in one go (the whole
+	 * pool free list at once, the shared segment under one lock), so a walk of a busy allocator completes after
+	 * at most maxRestarts + 1 steps more than an undisturbed one.
+	 *
+	 * @remark Walking is not synchronized with the owner of the allocator, except SharedMemoryAllocator
+	 */
+	template <class Alloc>
+	class HeapWalker {
+	public:
+		typedef HeapLayout<Alloc> Layout;
+
+		explicit HeapWalker(const Alloc& allocator, size_t mapCells = 64, size_t maxRestarts = 4)
+			: mAllocator(allocator), mMapCells(mapCells), mMaxRestarts(maxRestarts), mDone(false), mRestarts(0), mWalkRestarts(0) {
+			restart();
+		}
+
+		/**
+		 * step
+		 *
+		 * @param size_t budget - units of work, see HeapLayout
+		 *
+		 * @return bool true once the walk is complete
+		 */
+		bool step(size_t budget) {
+			if(mDone) {
+				return true;
+			}
+
+			if(mWalkRestarts < mMaxRestarts) {
+				stepLayout(budget);
+				return mDone;
+			}
+
+			// started over too often, the allocator changes between every two steps
+			while(!mDone) {
+				stepLayout(SIZE_MAX);
+			}
+
+			return true;
+		}
+
+		/**
+		 * Walks the rest in one go
+		 */
+		void finish() {
+			while(!step(SIZE_MAX)) {}
+		}
+
+		/**
+		 * Forgets the current walk, the next step starts a new one
+		 */
+		void restart() {
+			mState = typename Layout::State();
+			mDone = false;
+			mWalkRestarts = 0;
+			clearResults();
+		}
+
+		bool done() const { return mDone; }
+
+		// walks that started over because the allocator changed
+		size_t restarts() const { return mRestarts; }
+
+		const FragmentationReport& report() const { return mReport; }
+		const HeapMap& map() const { return mMap; }
+	private:
+		void stepLayout(size_t budget) {
+			mBlocks.clear();
+			WALKSTEP::ENUM result = Layout::step(mAllocator, mState, mBlocks, budget);
+
+			if(result == WALKSTEP::RESTARTED || result == WALKSTEP::RESTARTED_DONE) {
+				// the layout already started over, only the blocks of this step are current
+				++mRestarts;
+				++mWalkRestarts;
+				clearResults();
+			}
+
+			for(size_t i = 0; i < mBlocks.size(); ++i) {
+				add(mBlocks[i]);
+			}
+
+			if(result == WALKSTEP::DONE || result == WALKSTEP::RESTARTED_DONE) {
+				flushFree();
+				mDone = true;
+			}
+		}
+
+		void clearResults() {
+			mReport.clear();
+			mMap = HeapMap(Layout::size(mAllocator), mMapCells);
+			mPendingFree = HeapBlock();
+		}
+
+		void add(const HeapBlock& block) {
+			if(block.mSize == 0) {
+				return;
+			}
+
+			mMap.add(block);
+
+			if(!block.mUsed) {
+				if(mPendingFree.mSize > 0 && mPendingFree.mOffset + mPendingFree.mSize == block.mOffset) {
+					mPendingFree.mSize += block.mSize;
+				} else {
+					flushFree();
+					mPendingFree = block;
+				}
+				return;
+			}
+
+			flushFree();
+			mReport.add(block);
+		}
+
+		void flushFree() {
+			if(mPendingFree.mSize > 0) {
+				mReport.add(mPendingFree);
+				mPendingFree = HeapBlock();
+			}
+		}
+
+		const Alloc& mAllocator;
+
+		size_t mMapCells;
+
+		size_t mMaxRestarts;
+
+		typename Layout::State mState;
+
+		bool mDone;
+
+		size_t mRestarts;
+
+		// restarts of the current walk
+		size_t mWalkRestarts;
+
+		std::vector<HeapBlock> mBlocks;
+
+		// free blocks are merged with their free neighbours before they are counted
+		HeapBlock mPendingFree;
+
+		FragmentationReport mReport;
+
+		HeapMap mMap;
+	};
+
+	/**
+	 * Walks the whole allocator at once
+	 */
+	template <class Alloc>
+	FragmentationReport analyze(const Alloc& allocator) {
+		HeapWalker<Alloc> walker(allocator);
+		walker.finish();
+
+		return walker.report();
+	}
+
+}
+
+#endif
@@ -0,0 +1,225 @@
+/**
+ *  This file is part of the debuglib project
+ *  Copyright by Christian Ondracek
+ *  Contact: coder[at]paxi.at
+ *
+ *  Cycle level instrumentation of hot paths: scoped timers feeding per thread latency histograms
+ */
+
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iosfwd>
+
+#include "CycleClock.h"
+
+// instruments the MemoryManager and the LoggerManager, off by default (cmake -DONDRALUK_INSTRUMENTATION=ON)
+#ifndef DEBUGLIB_INSTRUMENTATION
+#define DEBUGLIB_INSTRUMENTATION 0
+#endif
+
+#define INSTRUMENT_CONCAT_IMPL(a, b) a##b
+#define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT_IMPL(a, b)
+
+#if DEBUGLIB_INSTRUMENTATION
+/**
+ * Times the rest of the enclosing scope, f.e:
+ *	INSTRUMENT_SCOPE("MemoryManager::allocate");
+ */
+#define INSTRUMENT_SCOPE(name) \
+	static const unsigned int INSTRUMENT_CONCAT(instrument_probe_, __LINE__) = debuglib::instrument::probe(name); \
+	debuglib::instrument::ScopedTimer INSTRUMENT_CONCAT(instrument_timer_, __LINE__)(INSTRUMENT_CONCAT(instrument_probe_, __LINE__));
+#else
+#define INSTRUMENT_SCOPE(name)
+#endif
+
+namespace debuglib
+{
+	namespace instrument
+	{
+		// probes beyond this are ignored
+		static const unsigned int MAX_PROBES = 64;
+
+		/**
+		 * Latency histogram with logarithmic buckets split linearly (like HdrHistogram).
+		 *
+		 * Values below 2^SUB_BITS get a bucket each, above that every power of two is split into 2^SUB_BITS
+		 * buckets, so every value is known within 1/32 (~3%). Values are in ticks of debuglib::clock.
+		 *
+		 * @remark Written by one thread with relaxed stores only, may be read by any other thread at the same time.
+		 */
+		class LatencyHistogram {
+		public:
+			static const unsigned int SUB_BITS = 5;
+			static const unsigned int SUB_BUCKETS = 1 << SUB_BITS;
+			// larger values are counted as 2^MAX_BITS - 1
+			static const unsigned int MAX_BITS = 44;
+			static const unsigned int BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+			LatencyHistogram();
+
+			/**
+			 * Records a value, only to be called by the owning thread.
+			 */
+			void record(uint64_t value) {
+				if(value >= (static_cast<uint64_t>(1) << MAX_BITS)) {
+					value = (static_cast<uint64_t>(1) << MAX_BITS) - 1;
+				}
+
+				add(mBuckets[bucket(value)], 1);
+				add(mCount, 1);
+				add(mSum, value);
+
+				if(value < mMin.load(std::memory_order_relaxed)) {
+					mMin.store(value, std::memory_order_relaxed);
+				}
+				if(value > mMax.load(std::memory_order_relaxed)) {
+					mMax.store(value, std::memory_order_relaxed);
+				}
+			}
+
+			/**
+			 * Adds the counts of other, only to be called by the owning thread.
+			 */
+			void merge(const LatencyHistogram& other);
+
+			void clear();
+
+			uint64_t count() const { return mCount.load(std::memory_order_relaxed); }
+			uint64_t sum() const { return mSum.load(std::memory_order_relaxed); }
+			uint64_t min() const { return count() > 0 ? mMin.load(std::memory_order_relaxed) : 0; }
+			uint64_t max() const { return mMax.load(std::memory_order_relaxed); }
+
+			/**
+			 * @param double percentile 0 - 100
+			 *
+			 * @return uint64_t the middle of the bucket holding the percentile, clamped to min() and max()
+			 */
+			uint64_t valueAtPercentile(double percentile) const;
+
+			static unsigned int bucket(uint64_t value) {
+				if(value < SUB_BUCKETS) {
+					return static_cast<unsigned int>(value);
+				}
+
+				unsigned int msb = 63 - leadingZeros(value);
+				unsigned int shift = msb - SUB_BITS;
+
+				return (shift + 1) * SUB_BUCKETS + static_cast<unsigned int>((value >> shift) & (SUB_BUCKETS - 1));
+			}
+
+			/**
+			 * @return uint64_t smallest value counted in the bucket
+			 */
+			static uint64_t bucketStart(unsigned int index) {
+				if(index < SUB_BUCKETS) {
+					return index;
+				}
+
+				unsigned int shift = index / SUB_BUCKETS - 1;
+
+				return (static_cast<uint64_t>(SUB_BUCKETS + index % SUB_BUCKETS)) << shift;
+			}
+
+			static uint64_t bucketWidth(unsigned int index) {
+				return index < SUB_BUCKETS ? 1 : static_cast<uint64_t>(1) << (index / SUB_BUCKETS - 1);
+			}
+		private:
+			LatencyHistogram(const LatencyHistogram&);
+			LatencyHistogram& operator=(const LatencyHistogram&);
+
+			// single writer, a plain load / store pair instead of a locked add
+			static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+				counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+			}
+
+			static unsigned int leadingZeros(uint64_t value) {
+#if defined(_MSC_VER)
+				unsigned long index;
+				_BitScanReverse64(&index, value);
+				return 63 - index;
+#else
+				return __builtin_clzll(value);
+#endif
+			}
+
+			std::atomic<uint64_t> mCount;
+			std::atomic<uint64_t> mSum;
+			std::atomic<uint64_t> mMin;
+			std::atomic<uint64_t> mMax;
+			std::atomic<uint64_t> mBuckets[BUCKETS];
+		};
+
+		/**
+		 * Registers a probe, calling it again with the same name returns the same id.
+		 *
+		 * @return unsigned int id of the probe, MAX_PROBES if all probes are taken
+		 */
+		unsigned int probe(const char* name);
+
+		/**
+		 * Records one interval of the probe into the histogram of the calling thread.
+		 */
+		void record(unsigned int probe, uint64_t start, uint64_t end);
+
+		/**
+		 * RAII timer, reads the time stamp counter on construction and with rdtscp on destruction
+		 */
+		class ScopedTimer {
+		public:
+			explicit ScopedTimer(unsigned int probe) : mProbe(probe), mStart(debuglib::clock::ticks()) {}
+
+			~ScopedTimer() {
+				record(mProbe, mStart, debuglib::clock::ticksSerialized());
+			}
+		private:
+			ScopedTimer(const ScopedTimer&);
+			ScopedTimer& operator=(const ScopedTimer&);
+
+			unsigned int mProbe;
+			uint64_t mStart;
+		};
+
+		/**
+		 * Besides the histograms every thread keeps its last intervals for the Chrome trace export.
+		 *
+		 * @param bool enabled
+		 * @param size_t eventsPerThread - capacity of the ring buffer of every thread, applies to threads timing their first
+		 *		  interval after the call
+		 */
+		void setTracing(bool enabled, size_t eventsPerThread = 1 << 16);
+		bool isTracing();
+
+		/**
+		 * Clears the histograms and trace events of all threads.
+		 *
+		 * @remark Threads timing at the same time may keep single samples.
+		 */
+		void reset();
+
+		/**
+		 * Merges the histograms of all threads for one probe.
+		 *
+		 * @param const char* name
+		 * @param[out] LatencyHistogram& merged - cleared first
+		 *
+		 * @return bool false if the probe is unknown
+		 */
+		bool histogram(const char* name, LatencyHistogram& merged);
+
+		/**
+		 * Writes count, min, percentiles, max and mean in nanoseconds of every probe, merged over all threads.
+		 */
+		void writeText(std::ostream& out);
+
+		/**
+		 * Writes the trace events of all threads as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+		 */
+		void writeChromeTrace(std::ostream& out);
+	}
+}
+
+#endif
@@ -0,0 +1,191 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file IntrospectionServer.hpp
+ */
+
+#ifndef INTROSPECTIONSERVER_HPP
+#define INTROSPECTIONSERVER_HPP
+
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+namespace ondraluk {
+
+	class LinearAllocator;
+	class PoolAllocator;
+	class VirtualArenaAllocator;
+	class ThreadOwnedAllocator;
+	class MemoryBudget;
+	struct AllocationStatistics;
+
+	/**
+	 * Writes the current state of a component as text, called on the server thread
+	 */
+	typedef std::function<void(std::ostream&)> IntrospectionProvider;
+
+	/**
+	 * IntrospectionServer
+	 *
+	 * Background thread answering text commands on a Unix domain socket, one command per line, f.e. with
+	 * 	socat - UNIX-CONNECT:/tmp/app.sock
+	 *
+	 * Commands:
+	 * 	providers							names of the registered providers
+	 * 	show [name]							output of one or all providers
+	 * 	loggers								number of loggers and the bytes pending in their outputters
+	 * 	log									current level, enabled channels and sampling of the LoggerManager
+	 * 	log level <level>					drop messages below level
+	 * 	log channel <channel> on|off
+	 * 	log sample <level> <every>			dispatch every n-th message of the level
+	 * 	help
+	 *
+	 * Every answer ends with an empty line, errors start with "error:".
+	 * The logger settings are atomics of the LoggerManager, changing them never blocks logging threads.
+	 *
+	 * @remark Providers run on the server thread. They may describe thread safe components directly, single
+	 *		   threaded allocators are described by their owner into a PublishedText the provider writes.
+	 */
+	class IntrospectionServer {
+	public:
+		IntrospectionServer();
+
+		/**
+		 * Destructor
+		 *
+		 * Stops the server
+		 */
+		~IntrospectionServer();
+
+		/**
+		 * start
+		 *
+		 * Binds the socket, replacing a stale socket file, and starts the server thread
+		 *
+		 * @param const std::string& path
+		 *
+		 * @return bool false if the socket could not be bound or the server already runs
+		 */
+		bool start(const std::string& path);
+
+		/**
+		 * stop
+		 *
+		 * Wakes and joins the server thread and removes the socket file
+		 *
+		 * @return void
+		 */
+		void stop();
+
+		bool isRunning() const { return mRunning.load(); }
+
+		const std::string& path() const { return mPath; }
+
+		/**
+		 * addProvider
+		 *
+		 * @param const std::string& name - replaces a provider of the same name
+		 * @param IntrospectionProvider provider
+		 *
+		 * @return void
+		 */
+		void addProvider(const std::string& name, IntrospectionProvider provider);
+
+		void removeProvider(const std::string& name);
+
+		/**
+		 * execute
+		 *
+		 * Runs one command line, what the server does for every line it receives
+		 *
+		 * @param const std::string& command
+		 * @param std::ostream& out
+		 *
+		 * @return void
+		 */
+		void execute(const std::string& command, std::ostream& out);
+	private:
+		IntrospectionServer(const IntrospectionServer&);
+		IntrospectionServer& operator=(const IntrospectionServer&);
+
+		void run();
+
+		void serve(int connection);
+
+		void executeLog(std::istream& arguments, std::ostream& out);
+
+		/**
+		 * Variables
+		 */
+
+		std::string mPath;
+
+		int mListener;
+
+		// written by stop() to wake the poll of the server thread
+		int mWake[2];
+
+		std::atomic<bool> mRunning;
+
+		std::thread mThread;
+
+		std::mutex mProvidersLock;
+		std::map<std::string, IntrospectionProvider> mProviders;
+	};
+
+	/**
+	 * PublishedText
+	 *
+	 * Text the owner of a single threaded component writes for a provider, f.e. a pool:
+	 * 	owner, now and then:	poolText.publish([&pool](std::ostream& out) { describe(out, pool); describeMap(out, pool); });
+	 * 	setup:					server.addProvider("pool", [&poolText](std::ostream& out) { poolText.write(out); });
+	 */
+	class PublishedText {
+	public:
+		/**
+		 * publish
+		 *
+		 * Runs the writer on the calling thread and replaces the published text with its output
+		 *
+		 * @param const IntrospectionProvider& writer
+		 *
+		 * @return void
+		 */
+		void publish(const IntrospectionProvider& writer);
+
+		// the last published text, nothing before the first publish
+		void write(std::ostream& out) const;
+	private:
+		mutable std::mutex mLock;
+		std::string mText;
+	};
+
+	/**
+	 * Text descriptions of single threaded allocators, to be called by the owner, see PublishedText
+	 */
+	void describe(std::ostream& out, const LinearAllocator& allocator);
+	void describe(std::ostream& out, const PoolAllocator& allocator);
+	// map of the touched blocks: '#' all used, '+' partly used, '.' all free
+	void describeMap(std::ostream& out, const PoolAllocator& allocator);
+	void describe(std::ostream& out, const VirtualArenaAllocator& allocator);
+
+	/**
+	 * Text descriptions of thread safe components, providers may call them, f.e:
+	 * 	server.addProvider("budget", [&budget](std::ostream& out) { describe(out, budget); });
+	 */
+	void describe(std::ostream& out, const ThreadOwnedAllocator& allocator);
+	void describe(std::ostream& out, const MemoryBudget& budget);
+	void describe(std::ostream& out, const AllocationStatistics& statistics);
+
+}
+
+#endif
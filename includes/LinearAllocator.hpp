@@ -12,6 +12,8 @@
 
 #include <cstdlib>
 
+#include "PageSource.hpp"
+
 typedef unsigned char byte;
 
 namespace ondraluk {
@@ -21,6 +23,8 @@ namespace ondraluk {
 	 *
 	 * Allocator which allocates an initial linear area of memory and
 	 * parts the init-memory into smaller pieces
+	 *
+	 * The area comes from the PageSource, large arenas should prefer one of the huge page backends
 	 */
 	class LinearAllocator {
 	public:
@@ -29,8 +33,9 @@ namespace ondraluk {
 		 *
 		 * @see LinearAllocator::init()
 		 * @param size - initial size in bytes
+		 * @param backend - preferred PageSource backend, falls back to cheaper ones if not available
 		 */
-		explicit LinearAllocator(size_t size);
+		explicit LinearAllocator(size_t size, PAGEBACKEND::ENUM backend = PAGEBACKEND::MALLOC);
 
 		/**
 		 * Move constructor
@@ -73,6 +78,35 @@ namespace ondraluk {
 		 * @return void
 		 */
 		void free(void* mem);
+
+		/**
+		 * owns
+		 *
+		 * @param const void* mem
+		 *
+		 * @return bool true if mem lies within the area of this allocator
+		 */
+		bool owns(const void* mem) const;
+
+		/**
+		 * @return PAGEBACKEND::ENUM the backend which actually provided the area
+		 */
+		PAGEBACKEND::ENUM backend() const;
+
+		/**
+		 * @return const void* start of the area
+		 */
+		const void* data() const;
+
+		/**
+		 * @return size_t bytes handed out from the start of the area
+		 */
+		size_t used() const;
+
+		/**
+		 * @return size_t size of the area
+		 */
+		size_t size() const;
 	private:
 		/**
 		 * Private copy constructor
@@ -94,6 +128,10 @@ namespace ondraluk {
 		byte* mEnd;
 
 		size_t mSize;
+
+		PAGEBACKEND::ENUM mPreferred;
+
+		PageRegion mRegion;
 	};
 
 }
@@ -0,0 +1,218 @@
+/**
+ *  This file is part of the debuglib project
+ *  Copyright by Christian Ondracek
+ *  Contact: coder[at]paxi.at
+ *
+ *  Structured log events: typed key/value fields and a reusable output buffer
+ */
+
+#ifndef LOGEVENT_H
+#define LOGEVENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace debuglib
+{
+	namespace logger
+	{
+		/**
+		 * A single typed key/value pair of a LogEvent.
+		 *
+		 * @remark Neither key nor string values are copied; the field only lives as long as the LOG_EVENT statement.
+		 */
+		struct LogField {
+			enum Type { INT, UINT, DOUBLE, BOOL, STRING, POINTER };
+
+			LogField(const char* key, int value) : mKey(key), mType(INT) { mInt = value; }
+			LogField(const char* key, long value) : mKey(key), mType(INT) { mInt = value; }
+			LogField(const char* key, long long value) : mKey(key), mType(INT) { mInt = value; }
+			LogField(const char* key, unsigned int value) : mKey(key), mType(UINT) { mUInt = value; }
+			LogField(const char* key, unsigned long value) : mKey(key), mType(UINT) { mUInt = value; }
+			LogField(const char* key, unsigned long long value) : mKey(key), mType(UINT) { mUInt = value; }
+			LogField(const char* key, double value) : mKey(key), mType(DOUBLE) { mDouble = value; }
+			LogField(const char* key, bool value) : mKey(key), mType(BOOL) { mBool = value; }
+			LogField(const char* key, const char* value) : mKey(key), mType(STRING), mLength(value ? strlen(value) : 0) { mString = value ? value : ""; }
+			LogField(const char* key, const char* value, size_t length) : mKey(key), mType(STRING), mLength(length) { mString = value; }
+
+			template <typename T>
+			LogField(const char* key, const T* value) : mKey(key), mType(POINTER) { mPointer = value; }
+
+			const char* mKey;
+			Type mType;
+
+			union {
+				int64_t mInt;
+				uint64_t mUInt;
+				double mDouble;
+				bool mBool;
+				const char* mString;
+				const void* mPointer;
+			};
+
+			size_t mLength;
+		};
+
+		/**
+		 * A named event with its fields, created by the LOG_EVENT macro.
+		 */
+		struct LogEvent {
+			LogEvent(const char* name, const LogField* fields, size_t count) : mName(name), mFields(fields), mCount(count) {}
+
+			const char* mName;
+			const LogField* mFields;
+			size_t mCount;
+		};
+
+		/**
+		 * Growable character buffer the formatters serialize into.
+		 *
+		 * @remark One buffer per thread is reused for every event (see threadLocal()),
+		 *		   so after warm up no memory is allocated on the logging path.
+		 */
+		class LogBuffer {
+		public:
+			LogBuffer() : mData(nullptr), mSize(0), mCapacity(0) {
+				reserve(256);
+			}
+
+			~LogBuffer() {
+				::free(mData);
+			}
+
+			static LogBuffer& threadLocal() {
+				static thread_local LogBuffer buffer;
+				return buffer;
+			}
+
+			void clear() {
+				mSize = 0;
+				mData[0] = '\0';
+			}
+
+			const char* c_str() const {
+				return mData;
+			}
+
+			size_t size() const {
+				return mSize;
+			}
+
+			void append(char c) {
+				reserve(mSize + 1);
+				mData[mSize++] = c;
+				mData[mSize] = '\0';
+			}
+
+			void append(const char* str, size_t length) {
+				reserve(mSize + length);
+				memcpy(mData + mSize, str, length);
+				mSize += length;
+				mData[mSize] = '\0';
+			}
+
+			void append(const char* str) {
+				append(str, strlen(str));
+			}
+
+			void appendUnsigned(uint64_t value) {
+				char digits[20];
+				int count = 0;
+
+				do {
+					digits[count++] = static_cast<char>('0' + value % 10);
+					value /= 10;
+				} while(value != 0);
+
+				reserve(mSize + count);
+				while(count > 0) {
+					mData[mSize++] = digits[--count];
+				}
+				mData[mSize] = '\0';
+			}
+
+			void appendSigned(int64_t value) {
+				if(value < 0) {
+					append('-');
+					// negate in unsigned arithmetic, INT64_MIN has no positive counterpart
+					appendUnsigned(0 - static_cast<uint64_t>(value));
+				} else {
+					appendUnsigned(static_cast<uint64_t>(value));
+				}
+			}
+
+			void appendDouble(double value) {
+				char digits[32];
+				int length = snprintf(digits, sizeof(digits), "%.17g", value);
+				append(digits, static_cast<size_t>(length));
+			}
+
+			void appendPointer(const void* value) {
+				static const char hex[] = "0123456789abcdef";
+				uintptr_t address = reinterpret_cast<uintptr_t>(value);
+				char digits[2 + 2 * sizeof(uintptr_t)];
+				int count = sizeof(digits);
+
+				do {
+					digits[--count] = hex[address & 0xF];
+					address >>= 4;
+				} while(address != 0);
+
+				digits[--count] = 'x';
+				digits[--count] = '0';
+
+				append(digits + count, sizeof(digits) - count);
+			}
+
+		private:
+			LogBuffer(const LogBuffer&);
+			LogBuffer& operator=(const LogBuffer&);
+
+			// makes room for size characters plus the terminating \0
+			void reserve(size_t size) {
+				if(size + 1 > mCapacity) {
+					size_t capacity = mCapacity ? mCapacity : 1;
+					while(capacity < size + 1) {
+						capacity *= 2;
+					}
+
+					mData = static_cast<char*>(::realloc(mData, capacity));
+					mCapacity = capacity;
+				}
+			}
+
+			char* mData;
+			size_t mSize;
+			size_t mCapacity;
+		};
+
+		/**
+		 * Writes the event as: name key=value key=value ...
+		 */
+		inline void appendPlainEvent(const LogEvent& event, LogBuffer& dest) {
+			dest.append(event.mName);
+
+			for(size_t i = 0; i < event.mCount; ++i) {
+				const LogField& field = event.mFields[i];
+
+				dest.append(' ');
+				dest.append(field.mKey);
+				dest.append('=');
+
+				switch(field.mType) {
+				case LogField::INT:		dest.appendSigned(field.mInt); break;
+				case LogField::UINT:	dest.appendUnsigned(field.mUInt); break;
+				case LogField::DOUBLE:	dest.appendDouble(field.mDouble); break;
+				case LogField::BOOL:	dest.append(field.mBool ? "true" : "false"); break;
+				case LogField::STRING:	dest.append(field.mString, field.mLength); break;
+				case LogField::POINTER:	dest.appendPointer(field.mPointer); break;
+				}
+			}
+		}
+	}
+}
+
+#endif
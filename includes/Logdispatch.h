@@ -7,13 +7,17 @@
 #ifndef LOGDISPATCH_H
 #define LOGDISPATCH_H
 
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
 #include <vector>
-#include <set>
 
 // forward declarations
 namespace debuglib {
 	namespace logger {
 		class LoggerBase;
+		struct LogEvent;
 		
 		template <class Filter, class Formatter, class Outputter>
 		class LoggerImpl;
@@ -24,25 +28,106 @@ namespace debuglib
 {
 	namespace logdispatch 
 	{
+		/**
+		 * Dispatches every message to all loggers.
+		 *
+		 * Channels, the minimum level and the sampling rates are atomics read with relaxed loads, so they can be
+		 * changed at runtime (f.e. through the IntrospectionServer) while other threads log, without a lock.
+		 * The loggers are read from an immutable list without a lock as well. Registering a logger copies the
+		 * list under mLoggersLock and publishes the copy; unregistering waits until no dispatch reads the old list
+		 * anymore, so a logger is never used after its destructor returned. Hence a logger must not be created
+		 * or destroyed from within a log call.
+		 */
 		class LoggerManager {
 			// declaring LoggerImpl as friend
 			template <class Filter, class Formatter, class Outputter>
 			friend class debuglib::logger::LoggerImpl;
 		
 		public:
+			// channels are 0 .. MAX_CHANNELS - 1
+			static const int MAX_CHANNELS = 256;
+			// log levels UNDEFINED .. FATAL_ERR
+			static const int LEVELS = 6;
+
 			LoggerManager();
 			~LoggerManager();
 
 			void log(int channel, int loglevel, const char* formated_message, ...);
+			void logEvent(int channel, int loglevel, const debuglib::logger::LogEvent& event);
 			void registerChannel(int channel);
+			void flush();
 			int size();
 
+			/**
+			 * Enables or disables a channel; unlike registerChannel enabling twice is no error.
+			 */
+			void enableChannel(int channel, bool enabled = true);
+			bool isChannelEnabled(int channel) const;
+
+			/**
+			 * Messages below the level are dropped before they reach the loggers, UNDEFINED lets everything pass.
+			 */
+			void setLevel(int loglevel);
+			int level() const;
+
+			/**
+			 * Only every n-th message of the level is dispatched (counted per thread), 1 dispatches all.
+			 */
+			void setSampling(int loglevel, unsigned int every);
+			unsigned int sampling(int loglevel) const;
+
+			/**
+			 * @return size_t bytes waiting in the outputter of the logger, 0 if it does not buffer or is gone
+			 */
+			size_t pending(int logger);
+
 		private:
 			void addLogger(debuglib::logger::LoggerBase*);
 			void removeLogger(debuglib::logger::LoggerBase*);
 
-			std::set<int> mChannels;
-			std::vector<debuglib::logger::LoggerBase*> mLoggers;
+			// channel, level and sampling check in front of every message
+			bool accepts(int channel, int loglevel);
+
+			/**
+			 * One of the two logger lists, the current one or the spare the next list is built in
+			 */
+			struct LoggerList {
+				LoggerList() : mReaders(0) {}
+
+				std::vector<debuglib::logger::LoggerBase*> mLoggers;
+				// dispatches registered on the list, see ListReader
+				std::atomic<unsigned int> mReaders;
+			};
+
+			/**
+			 * Registers on the current list for the lifetime of the reader
+			 */
+			class ListReader {
+			public:
+				explicit ListReader(LoggerManager& manager);
+				~ListReader();
+
+				const std::vector<debuglib::logger::LoggerBase*>& loggers() const { return mList->mLoggers; }
+			private:
+				ListReader(const ListReader&);
+				ListReader& operator=(const ListReader&);
+
+				LoggerList* mList;
+			};
+
+			// copies the current list into the spare, changes and publishes it; needs mLoggersLock
+			void publish(debuglib::logger::LoggerBase* added, debuglib::logger::LoggerBase* removed);
+
+			static void waitForReaders(const LoggerList& list);
+
+			std::atomic<uint64_t> mChannels[MAX_CHANNELS / 64];
+			std::atomic<int> mLevel;
+			std::atomic<unsigned int> mSampling[LEVELS];
+
+			LoggerList mLists[2];
+			std::atomic<LoggerList*> mCurrent;
+			// serializes registering
+			std::mutex mLoggersLock;
 		};
 
 		extern debuglib::logdispatch::LoggerManager LoggerMgr;
@@ -30,14 +30,28 @@
 	#include <cstdarg>
 #endif
 
+#ifdef USE_TIME_FORMATTER
+	#include <chrono>
+	#include <cstring>
+	#include <ctime>
+	#include "CycleClock.h"
+#endif
+
 #ifdef USE_FILE_LOGGER
 	#include <fstream>
 	#include <memory>
 	#include <utility>
 	#include <cstdio>
+
+	#ifndef _WIN32
+		#include "BufferedFileOutputter.h"
+		#include "MmapFileOutputter.h"
+	#endif
 #endif
 
 #include "Logdispatch.h"
+#include "LogEvent.h"
+#include "PerThreadOutputter.h"
 
 #ifdef _DEBUG
 
@@ -54,6 +68,17 @@ extern debuglib::logdispatch::LoggerManager LoggerMgr;
 #endif
 
 
+/**
+ * Logs a structured event, f.e:
+ *	LOG_EVENT(1, debuglib::logger::DEBUG, "alloc", debuglib::logger::LogField("size", n), debuglib::logger::LogField("addr", p))
+ */
+#define LOG_EVENT(channel, loglevel, name, ...) \
+	{ \
+		const debuglib::logger::LogField log_event_fields[] = { __VA_ARGS__ }; \
+		debuglib::logdispatch::LoggerMgr.logEvent(channel, loglevel, \
+			debuglib::logger::LogEvent(name, log_event_fields, sizeof(log_event_fields) / sizeof(log_event_fields[0]))); \
+	}
+
 #define REGISTER_LOG_CHANNEL(channel) \
 	debuglib::logdispatch::LoggerMgr.registerChannel(channel);
 
@@ -63,6 +88,11 @@ extern debuglib::logdispatch::LoggerManager LoggerMgr;
 		(void) loglevel; \
 		(void) formated_message;
 
+	#define LOG_EVENT(channel, loglevel, name, ...) \
+		(void) channel; \
+		(void) loglevel; \
+		(void) name;
+
 	#define REGISTER_LOG_CHANNEL(channel) \
 		(void) channel;
 #endif
@@ -154,22 +184,324 @@ namespace debuglib
 			 * Simple formatter.
 			 */
 			struct SimpleFormatter {
+				// nothing is added to the message
+				size_t reserve(size_t) const {
+					return 0;
+				}
+
 				void format(const char* formatted_message, char* dest, va_list args, size_t size) const {
-					int bytes_written = vsnprintf(dest, (size-2), formatted_message, args);
+					int bytes_written = vsnprintf(dest, (size-1), formatted_message, args);
+					if(bytes_written < 0) {
+						bytes_written = 0;
+					} else if(static_cast<size_t>(bytes_written) > size-2) {
+						bytes_written = static_cast<int>(size-2);
+					}
 					dest[bytes_written] = '\n';
 					dest[bytes_written+1] = '\0';
 				}
+
+				void formatEvent(const FilterAttributes&, const LogEvent& event, LogBuffer& dest) const {
+					appendPlainEvent(event, dest);
+				}
 			};
 
 #ifdef USE_TIME_FORMATTER
 			/**
 			 * Time formatter.
+			 *
+			 * Prefixes every message with the wall clock time, f.e: 2014-05-21 13:37:00.042 message
+			 *
+			 * @remark The calendar part is produced by strftime only when the second changes and is cached per thread,
+			 *		   in CALENDAR_SLOTS slots keyed by format and source, so loggers with different formats can
+			 *		   alternate without evicting each other.
+			 *		   The sub-second part is derived from a cheap monotonic source anchored to the wall clock:
+			 *		   - COARSE: CLOCK_MONOTONIC_COARSE, served from the vDSO, resolution of one scheduler tick
+			 *		   - TSC: the time stamp counter, calibrated once (see CycleClock.h)
+			 *		   The anchor is refreshed with the second, so clock adjustments are picked up within a second.
 			 */
 			struct TimeFormatter {
+				enum Precision { SECONDS = 0, MILLISECONDS = 3, MICROSECONDS = 6, NANOSECONDS = 9 };
+				enum Source { COARSE, TSC };
+
+				static const size_t CALENDAR_MAX_SIZE = 64;
+				static const size_t CALENDAR_SLOTS = 4;
+
+				explicit TimeFormatter(const char* calendarFormat = "%Y-%m-%d %H:%M:%S", Precision precision = MILLISECONDS, Source source = COARSE) :
+					mCalendarFormat(calendarFormat), mPrecision(precision), mSource(source) {}
+
+				// calendar, '.', fraction and the separating blank
+				size_t reserve(size_t) const {
+					return CALENDAR_MAX_SIZE + 1 + mPrecision + 1;
+				}
+
 				void format(const char* formatted_message, char* dest, va_list args, size_t size) const {
+					size_t prefix = writeTimestamp(dest);
+					dest[prefix++] = ' ';
+
+					SimpleFormatter().format(formatted_message, dest + prefix, args, size - prefix);
+				}
+
+				void formatEvent(const FilterAttributes&, const LogEvent& event, LogBuffer& dest) const {
+					char timestamp[CALENDAR_MAX_SIZE + 1 + NANOSECONDS];
+					dest.append(timestamp, writeTimestamp(timestamp));
+					dest.append(' ');
+					appendPlainEvent(event, dest);
+				}
+
+				/**
+				 * Writes the current timestamp (without terminating \0) to dest.
+				 *
+				 * @param[out] dest At least CALENDAR_MAX_SIZE + 1 + mPrecision bytes, what reserve() adds without the blank.
+				 *
+				 * @return The number of bytes written.
+				 */
+				size_t writeTimestamp(char* dest) const {
+					CalendarCache& cache = calendarCache();
+
+					int64_t now = cache.mWallBase + (monotonicNanoseconds() - cache.mMonotonicBase);
+
+					if(now / 1000000000 != cache.mSecond) {
+						anchor(cache);
+						now = cache.mWallBase + (monotonicNanoseconds() - cache.mMonotonicBase);
+						refreshCalendar(cache, now / 1000000000);
+					}
+
+					// re-anchoring must never let the time step backwards
+					if(now < cache.mLast) {
+						now = cache.mLast;
+					}
+					cache.mLast = now;
+
+					memcpy(dest, cache.mCalendar, cache.mCalendarLength);
+					size_t written = cache.mCalendarLength;
+
+					if(mPrecision > SECONDS) {
+						dest[written++] = '.';
+
+						// keep the leading mPrecision digits of the nanoseconds
+						uint32_t fraction = static_cast<uint32_t>(now % 1000000000);
+						for(int i = 9; i > mPrecision; --i) {
+							fraction /= 10;
+						}
+						for(int i = mPrecision - 1; i >= 0; --i) {
+							dest[written + i] = static_cast<char>('0' + fraction % 10);
+							fraction /= 10;
+						}
+						written += mPrecision;
+					}
+
+					return written;
+				}
+
+				/**
+				 * Calendar strings formatted by the calling thread so far, each one a strftime call.
+				 */
+				static size_t calendarRefreshes() {
+					return calendarCaches().mRefreshes;
+				}
+
+				const char* mCalendarFormat;
+				int mPrecision;
+				Source mSource;
+
+			private:
+				struct CalendarCache {
+					CalendarCache() : mFormat(nullptr), mSource(COARSE), mSecond(-1), mWallBase(0), mMonotonicBase(0), mLast(0), mCalendarLength(0) {}
+
+					const char* mFormat;
+					Source mSource;
+					int64_t mSecond;
+					int64_t mWallBase;
+					int64_t mMonotonicBase;
+					int64_t mLast;
+					size_t mCalendarLength;
+					char mCalendar[CALENDAR_MAX_SIZE];
+				};
+
+				struct CalendarCaches {
+					CalendarCaches() : mNext(0), mRefreshes(0) {}
+
+					CalendarCache mSlots[CALENDAR_SLOTS];
+					// slot replaced next
+					size_t mNext;
+					size_t mRefreshes;
+				};
+
+				static CalendarCaches& calendarCaches() {
+					static thread_local CalendarCaches caches;
+					return caches;
+				}
+
+				CalendarCache& calendarCache() const {
+					CalendarCaches& caches = calendarCaches();
+
+					for(size_t i = 0; i < CALENDAR_SLOTS; ++i) {
+						if(caches.mSlots[i].mFormat == mCalendarFormat && caches.mSlots[i].mSource == mSource) {
+							return caches.mSlots[i];
+						}
+					}
+
+					CalendarCache& cache = caches.mSlots[caches.mNext];
+					caches.mNext = (caches.mNext + 1) % CALENDAR_SLOTS;
+
+					// anchored and formatted by the first timestamp
+					cache.mFormat = mCalendarFormat;
+					cache.mSource = mSource;
+					cache.mSecond = -1;
+					cache.mLast = 0;
+
+					return cache;
+				}
+
+				int64_t monotonicNanoseconds() const {
+					if(mSource == TSC) {
+						return debuglib::clock::ticksToNanoseconds(debuglib::clock::ticks());
+					}
+					return debuglib::clock::coarseNanoseconds();
+				}
+
+				void anchor(CalendarCache& cache) const {
+					cache.mMonotonicBase = monotonicNanoseconds();
+					cache.mWallBase = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+				}
+
+				void refreshCalendar(CalendarCache& cache, int64_t second) const {
+					time_t t = static_cast<time_t>(second);
+					tm calendar;
+#ifdef _WIN32
+					localtime_s(&calendar, &t);
+#else
+					localtime_r(&t, &calendar);
+#endif
+					cache.mCalendarLength = strftime(cache.mCalendar, CALENDAR_MAX_SIZE, mCalendarFormat, &calendar);
+					cache.mSecond = second;
+					++calendarCaches().mRefreshes;
 				}
 			};
 #endif
+
+			/**
+			 * JSON lines formatter.
+			 *
+			 * Writes one JSON object per line:
+			 *	{"ts":1400671020042000000,"level":1,"channel":1,"event":"alloc","addr":"0x7f..","size":16}
+			 * printf style messages end up as {"ts":..,"msg":"..."}.
+			 *
+			 * @remark Field values are serialized straight into the reusable LogBuffer, no std::string is created.
+			 *		   "ts" is nanoseconds since epoch from the system clock.
+			 */
+			struct JsonLinesFormatter {
+				// worst case every character is escaped as \u00XX, plus the surrounding object
+				size_t reserve(size_t messageLength) const {
+					return 5 * messageLength + 64;
+				}
+
+				void format(const char* formatted_message, char* dest, va_list args, size_t size) const {
+					// print to the back of dest, escape into the line buffer and copy the line to the front
+					va_list measure;
+					va_copy(measure, args);
+					int printed = vsnprintf(nullptr, 0, formatted_message, measure);
+					va_end(measure);
+
+					if(printed < 0) {
+						printed = 0;
+					}
+
+					char* raw = dest + size - (printed + 1);
+					vsnprintf(raw, printed + 1, formatted_message, args);
+
+					LogBuffer& line = LogBuffer::threadLocal();
+					line.clear();
+					appendHead(line);
+					line.append(",\"msg\":", 7);
+					appendString(line, raw, printed);
+					line.append("}\n", 2);
+
+					memcpy(dest, line.c_str(), line.size() + 1);
+				}
+
+				void formatEvent(const FilterAttributes& attrs, const LogEvent& event, LogBuffer& dest) const {
+					appendHead(dest);
+					dest.append(",\"level\":", 9);
+					dest.appendSigned(attrs.mLoglevel);
+					dest.append(",\"channel\":", 11);
+					dest.appendSigned(attrs.mChannel);
+					dest.append(",\"event\":", 9);
+					appendString(dest, event.mName, strlen(event.mName));
+
+					for(size_t i = 0; i < event.mCount; ++i) {
+						const LogField& field = event.mFields[i];
+
+						dest.append(',');
+						appendString(dest, field.mKey, strlen(field.mKey));
+						dest.append(':');
+
+						switch(field.mType) {
+						case LogField::INT:		dest.appendSigned(field.mInt); break;
+						case LogField::UINT:	dest.appendUnsigned(field.mUInt); break;
+						case LogField::DOUBLE:
+							// JSON knows no nan / inf
+							if(field.mDouble == field.mDouble && field.mDouble - field.mDouble == 0) {
+								dest.appendDouble(field.mDouble);
+							} else {
+								dest.append("null", 4);
+							}
+							break;
+						case LogField::BOOL:	dest.append(field.mBool ? "true" : "false"); break;
+						case LogField::STRING:	appendString(dest, field.mString, field.mLength); break;
+						case LogField::POINTER:
+							dest.append('"');
+							dest.appendPointer(field.mPointer);
+							dest.append('"');
+							break;
+						}
+					}
+
+					dest.append('}');
+				}
+
+			private:
+				static void appendHead(LogBuffer& dest) {
+					dest.append("{\"ts\":", 6);
+					dest.appendSigned(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+				}
+
+				static void appendString(LogBuffer& dest, const char* str, size_t length) {
+					static const char hex[] = "0123456789abcdef";
+
+					dest.append('"');
+
+					const char* begin = str;
+					const char* end = str + length;
+
+					for(const char* it = str; it != end; ++it) {
+						unsigned char c = static_cast<unsigned char>(*it);
+
+						if(c >= 0x20 && c != '"' && c != '\\') {
+							continue;
+						}
+
+						// flush the unescaped run before the special character
+						dest.append(begin, it - begin);
+						begin = it + 1;
+
+						switch(c) {
+						case '"':	dest.append("\\\"", 2); break;
+						case '\\':	dest.append("\\\\", 2); break;
+						case '\n':	dest.append("\\n", 2); break;
+						case '\r':	dest.append("\\r", 2); break;
+						case '\t':	dest.append("\\t", 2); break;
+						default: {
+							char escaped[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+							dest.append(escaped, 6);
+						}
+						}
+					}
+
+					dest.append(begin, end - begin);
+					dest.append('"');
+				}
+			};
 		#pragma endregion FormatPolicies
 
 
@@ -185,6 +517,8 @@ namespace debuglib
 					void out(const char* msg) const {
 						OutputDebugStringA(msg);
 					}
+
+					void flush() const {}
 				};
 			#endif
 			
@@ -198,6 +532,10 @@ namespace debuglib
 					printf("%s", msg);
 					fflush(stdout);
 				}
+
+				void flush() const {
+					fflush(stdout);
+				}
 			};
 
 			/**
@@ -228,6 +566,10 @@ namespace debuglib
 					*mStream << msg;
 				}
 
+				void flush() const {
+					mStream->flush();
+				}
+
 				mutable std::shared_ptr<std::fstream> mStream;
 
 			private:
@@ -248,6 +590,10 @@ namespace debuglib
 		public:
 			// see comments in LoggerImpl
 			virtual void log(int channel, int loglevel, const char* formated_message, va_list list) const = 0;
+			virtual void logEvent(int channel, int loglevel, const LogEvent& event) const = 0;
+			virtual void flush() const = 0;
+			// bytes buffered by the outputter and not yet written
+			virtual size_t pending() const { return 0; }
 			virtual ~LoggerBase(void) { }
 		};
 
@@ -294,7 +640,44 @@ namespace debuglib
 			 * @return void
 			 */
 			void log(int channel, int loglevel, const char* formated_message, va_list list) const;
+
+			/**
+			 * Output a structured event on this logger.
+			 *
+			 * @remark The event is serialized by the formatter into a reusable per thread buffer and appended by a \n
+			 *
+			 * @param[in] channel The channel for the event.
+			 * @param[in] loglevel The log level.
+			 * @param[in] event Name and typed fields of the event.
+			 *
+			 * @return void
+			 */
+			void logEvent(int channel, int loglevel, const LogEvent& event) const;
+
+			/**
+			 * Hands all messages buffered by the outputter to their destination.
+			 *
+			 * @return void
+			 */
+			void flush() const;
+
+			/**
+			 * Bytes the outputter holds back, for outputters with a pending() query (f.e. PerThreadOutputter).
+			 *
+			 * @return size_t
+			 */
+			size_t pending() const;
 		private:
+			template <class O>
+			static auto outputterPending(const O& outputter, int) -> decltype(outputter.pending()) {
+				return outputter.pending();
+			}
+
+			template <class O>
+			static size_t outputterPending(const O&, long) {
+				return 0;
+			}
+
 			Filter mFilter;
 			Formatter mFormatter;
 			Outputter mOutputter;
@@ -321,24 +704,69 @@ namespace debuglib
 
 			if(mFilter.filter(attrsFilter)) {
 
+				// measuring consumes the list, the formatter gets a fresh copy
+				va_list measure;
+				va_copy(measure, list);
+
 #ifdef _WIN32
-				s = _vscprintf(formated_message, list) + 2;
+				s = _vscprintf(formated_message, measure);
+				s += 2 + mFormatter.reserve(s);
 				char* tmp = static_cast<char*>(_malloca(s));
 #else
-				s = vsnprintf(NULL, 0, formated_message, list) + 2;
+				s = vsnprintf(NULL, 0, formated_message, measure);
+				s += 2 + mFormatter.reserve(s);
 				char* tmp = static_cast<char*>(__builtin_alloca(s));
 #endif
+				va_end(measure);
+
+				va_list args;
+				va_copy(args, list);
+				mFormatter.format(formated_message, tmp, args, s);
+				va_end(args);
 
-				mFormatter.format(formated_message, tmp, list, s);
 				mOutputter.out(tmp);
 			}
 		}
 
+		template <class Filter, class Formatter, class Outputter>
+		void LoggerImpl<Filter, Formatter, Outputter>::logEvent(int channel, int loglevel, const LogEvent& event) const {
+
+			FilterAttributes attrsFilter(channel, loglevel);
+
+			if(mFilter.filter(attrsFilter)) {
+				LogBuffer& buffer = LogBuffer::threadLocal();
+
+				buffer.clear();
+				mFormatter.formatEvent(attrsFilter, event, buffer);
+				buffer.append('\n');
+
+				mOutputter.out(buffer.c_str());
+			}
+		}
+
+		template <class Filter, class Formatter, class Outputter>
+		void LoggerImpl<Filter, Formatter, Outputter>::flush() const {
+			mOutputter.flush();
+		}
+
+		template <class Filter, class Formatter, class Outputter>
+		size_t LoggerImpl<Filter, Formatter, Outputter>::pending() const {
+			return outputterPending(mOutputter, 0);
+		}
+
 		typedef LoggerImpl<ChannelFilter, SimpleFormatter, ConsoleOutputter> SimpleChannelConsoleLogger;
 		typedef LoggerImpl<LogLevelFilter, SimpleFormatter, ConsoleOutputter> SimpleLogLevelConsoleLogger;
 		typedef LoggerImpl<NoFilter, SimpleFormatter, ConsoleOutputter> ConsoleLogger;
 		typedef LoggerImpl<NoFilter, SimpleFormatter, FileOutputter> FileLogger;
 		typedef LoggerImpl<NoFilter, TimeFormatter, FileOutputter> TimeFormattedFileLogger;
+		typedef LoggerImpl<NoFilter, JsonLinesFormatter, ConsoleOutputter> JsonConsoleLogger;
+		typedef LoggerImpl<NoFilter, JsonLinesFormatter, FileOutputter> JsonFileLogger;
+		typedef LoggerImpl<NoFilter, SimpleFormatter, PerThreadOutputter<FileOutputter> > PerThreadFileLogger;
+
+#ifndef _WIN32
+		typedef LoggerImpl<NoFilter, SimpleFormatter, BufferedFileOutputter> BufferedFileLogger;
+		typedef LoggerImpl<NoFilter, SimpleFormatter, MmapFileOutputter> MmapFileLogger;
+#endif
 
 #ifdef _WIN32
 		typedef LoggerImpl<ChannelFilter, SimpleFormatter, VSOutputter> SimpleChannelVSLogger;
@@ -0,0 +1,63 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file MallocAllocator.hpp
+ */
+
+#ifndef MALLOCALLOCATOR_HPP
+#define MALLOCALLOCATOR_HPP
+
+#include <cstdlib>
+
+namespace ondraluk {
+
+	/**
+	 * MallocAllocator
+	 *
+	 * Allocator which forwards every request to the system malloc / free.
+	 * Used as reference in benchmarks and as last resort behind other allocators.
+	 */
+	class MallocAllocator {
+	public:
+		/**
+		 * allocate
+		 *
+		 * @param size_t size
+		 *
+		 * @return void* pointer to memory, nullptr if the system is out of memory
+		 */
+		void* allocate(size_t size) {
+			return ::malloc(size);
+		}
+
+		/**
+		 * allocateZeroed
+		 *
+		 * @param size_t size
+		 *
+		 * Used by the MemoryManager for INIT::ZERO; calloc gets fresh pages zeroed by the OS without touching them
+		 *
+		 * @return void* pointer to zeroed memory, nullptr if the system is out of memory
+		 */
+		void* allocateZeroed(size_t size) {
+			return ::calloc(1, size);
+		}
+
+		/**
+		 * free
+		 *
+		 * @param void* mem
+		 *
+		 * @return void
+		 */
+		void free(void* mem) {
+			::free(mem);
+		}
+	};
+
+}
+
+#endif
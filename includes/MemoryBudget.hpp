@@ -0,0 +1,227 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file MemoryBudget.hpp
+ */
+
+#ifndef MEMORYBUDGET_HPP
+#define MEMORYBUDGET_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MemoryManager.hpp"
+
+namespace ondraluk {
+
+	/**
+	 * What to do with an allocation exceeding a budget
+	 */
+	struct BUDGETACTION {
+		enum ENUM {
+			// fail the allocation
+			REJECT,
+			// let it through, the budget is over its limit afterwards
+			ALLOW,
+			// the callback freed memory (f.e. trimmed a cache), check the budget once more
+			RETRY
+		};
+	};
+
+	class MemoryBudget;
+
+	/**
+	 * Called with the budget whose limit would be exceeded (the allocating budget or one of its parents)
+	 * and the requested size. Runs on the allocating thread.
+	 */
+	typedef std::function<BUDGETACTION::ENUM(MemoryBudget& budget, size_t requested)> BudgetExceededCallback;
+
+	/**
+	 * MemoryBudget
+	 *
+	 * Named memory limit of one subsystem. Budgets form a tree, usage of a budget is accounted to all its parents,
+	 * an allocation has to fit every budget up to the root. Accounting is lock free.
+	 *
+	 * If an allocation does not fit, an event "budget_exceeded" is logged and the callback of the exceeded budget
+	 * decides; without a callback the allocation is rejected.
+	 *
+	 * @remark Children must be destroyed before their parent
+	 */
+	class MemoryBudget {
+	public:
+		static const size_t UNLIMITED = SIZE_MAX;
+
+		/**
+		 * The state of a budget and its children
+		 */
+		struct Snapshot {
+			Snapshot() : mUsed(0), mLimit(0), mPeak(0), mRejected(0) {}
+
+			std::string mName;
+			size_t mUsed;
+			size_t mLimit;
+			size_t mPeak;
+			size_t mRejected;
+			std::vector<Snapshot> mChildren;
+		};
+
+		/**
+		 * Constructor
+		 *
+		 * @param name
+		 * @param limit - maximum bytes, UNLIMITED for a budget which only accounts
+		 * @param parent - nullptr for a root budget
+		 * @param callback - decides about allocations exceeding this budget, rejects if empty
+		 */
+		MemoryBudget(const char* name, size_t limit, MemoryBudget* parent = nullptr, BudgetExceededCallback callback = BudgetExceededCallback());
+
+		/**
+		 * Destructor
+		 *
+		 * Unregisters from the parent, remaining usage is returned to the parents
+		 */
+		~MemoryBudget();
+
+		/**
+		 * reserve
+		 *
+		 * Accounts size bytes to this budget and all parents
+		 *
+		 * @param size_t size
+		 *
+		 * @return bool false if the allocation was rejected, nothing is accounted then
+		 */
+		bool reserve(size_t size);
+
+		/**
+		 * release
+		 *
+		 * @param size_t size Bytes accounted with reserve
+		 *
+		 * @return void
+		 */
+		void release(size_t size);
+
+		/**
+		 * setLimit
+		 *
+		 * @param size_t limit Does not affect memory already accounted
+		 *
+		 * @return void
+		 */
+		void setLimit(size_t limit);
+
+		const std::string& name() const { return mName; }
+		MemoryBudget* parent() const { return mParent; }
+		size_t used() const { return mUsed.load(std::memory_order_relaxed); }
+		size_t limit() const { return mLimit.load(std::memory_order_relaxed); }
+		size_t peak() const { return mPeak.load(std::memory_order_relaxed); }
+		size_t rejected() const { return mRejected.load(std::memory_order_relaxed); }
+
+		/**
+		 * snapshot
+		 *
+		 * @return Snapshot of this budget and the whole subtree; the values are read one by one, not atomically as a whole
+		 */
+		Snapshot snapshot() const;
+	private:
+		MemoryBudget(const MemoryBudget&);
+		MemoryBudget& operator=(const MemoryBudget&);
+
+		bool tryReserve(size_t size);
+
+		void account(size_t size);
+
+		/**
+		 * Variables
+		 */
+
+		std::string mName;
+
+		MemoryBudget* mParent;
+
+		BudgetExceededCallback mCallback;
+
+		std::atomic<size_t> mUsed;
+		std::atomic<size_t> mLimit;
+		std::atomic<size_t> mPeak;
+		std::atomic<size_t> mRejected;
+
+		mutable std::mutex mChildrenLock;
+		std::vector<MemoryBudget*> mChildren;
+	};
+
+	/**
+	 * BudgetedAllocator
+	 *
+	 * Accounts every allocation of Alloc to a MemoryBudget. The size is stored in front of the memory, so free
+	 * releases the right amount.
+	 */
+	template <class Alloc>
+	class BudgetedAllocator {
+	public:
+		static const size_t HEADER = sizeof(size_t);
+
+		BudgetedAllocator(MemoryBudget& budget, Alloc allocator = Alloc()) : mBudget(&budget), mAllocator(std::move(allocator)) {}
+
+		void* allocate(size_t size) {
+			size_t total = size + HEADER;
+
+			if(!mBudget->reserve(total)) {
+				return nullptr;
+			}
+
+			unsigned char* mem = static_cast<unsigned char*>(mAllocator.allocate(total));
+
+			if(mem == nullptr) {
+				mBudget->release(total);
+				return nullptr;
+			}
+
+			*reinterpret_cast<size_t*>(mem) = total;
+
+			return mem + HEADER;
+		}
+
+		void free(void* mem) {
+			if(mem == nullptr) {
+				return;
+			}
+
+			unsigned char* header = static_cast<unsigned char*>(mem) - HEADER;
+
+			mBudget->release(*reinterpret_cast<size_t*>(header));
+			mAllocator.free(header);
+		}
+
+		bool owns(const void* mem) const {
+			return mAllocator.owns(mem);
+		}
+
+		MemoryBudget& budget() const { return *mBudget; }
+	private:
+		MemoryBudget* mBudget;
+		Alloc mAllocator;
+	};
+
+	template <class Alloc>
+	const size_t BudgetedAllocator<Alloc>::HEADER;
+
+	/**
+	 * MemoryManager tagged with a budget
+	 */
+	template <class Alloc, class BoundsChecker = NoBoundsCheckingPolicy, class Tracker = NoTrackingPolicy>
+	using BudgetedMemoryManager = MemoryManager<BudgetedAllocator<Alloc>, BoundsChecker, Tracker>;
+
+}
+
+#endif
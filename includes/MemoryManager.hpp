@@ -11,22 +11,27 @@
 #define MEMORYMANAGER_HPP
 
 #include <cstdlib>
+#include <cstring>
 #include <new>
 #include <type_traits>
 #include <utility>
 #include <cassert>
 
+// logs every allocation / deallocation, define as 0 before including to disable
+#ifndef ONDRALUK_TRACKING
 #define ONDRALUK_TRACKING 1
+#endif
 
-#ifdef ONDRALUK_TRACKING
+#if ONDRALUK_TRACKING
 #include "Logger.h"
 #endif
 
-template <bool> struct podness {};
-template <bool> struct arrayness { static const bool value = false; };
-template <> struct arrayness<true> { static const bool value = true; };
+// scoped timers around the allocator and bounds checker calls when DEBUGLIB_INSTRUMENTATION is set
+#include "Instrumentation.h"
 
-template <bool> struct arrayallocation {};
+// tags selecting the construction / destruction loops at compile time
+template <bool> struct trivialconstruction {};
+template <bool> struct trivialdestruction {};
 
 template <size_t n>
 struct wasarrayallocation {
@@ -92,7 +97,7 @@ struct BoundsCheckingPolicy {
 
 		asByte -= BOUNDSIZE;
 
-		int tmp[N];
+		unsigned char tmp[N];
 		memset(tmp, SYMBOL, N);
 
 		if (memcmp(asVoid, tmp, N) == 0) {
@@ -124,25 +129,90 @@ struct BoundsCheckingPolicy<0, 0> {
 
 typedef BoundsCheckingPolicy<0, 0> NoBoundsCheckingPolicy;
 
+/**
+* NoTrackingPolicy
+*
+* Default tracker of the MemoryManager; gets told about every allocation and deallocation.
+* A tracker implements the same two functions, see AllocationTrace.hpp for a recording tracker.
+*/
+struct NoTrackingPolicy {
+
+	/**
+	* onAllocate
+	*
+	* @param const void* addr address handed out to the user
+	* @param size_t size requested size in bytes
+	* @param size_t alignment alignment requirement of the allocated type
+	*
+	* @return void
+	*/
+	void onAllocate(const void*, size_t, size_t) const {}
+
+	/**
+	* onDeallocate
+	*
+	* @param const void* addr address handed back by the user
+	*
+	* @return void
+	*/
+	void onDeallocate(const void*) const {}
+};
+
 namespace ondraluk {
 
 	struct ARRAY {
 		enum ENUM { NO , YES};
 	};
+
+	/**
+	 * Initialization of newly allocated memory
+	 */
+	struct INIT {
+		enum ENUM {
+			// default-initialization like new T / new T[n]: trivial types stay uninitialized
+			DEFAULT,
+			// the memory is zeroed before the elements are default-constructed
+			ZERO
+		};
+	};
+
+	/**
+	 * has_allocate_zeroed
+	 *
+	 * true if the Allocator hands out zeroed memory through allocateZeroed(size_t) (f.e. calloc or fresh pages),
+	 * the MemoryManager then does not clear INIT::ZERO allocations itself
+	 */
+	template <class Allocator>
+	struct has_allocate_zeroed {
+	private:
+		template <class A>
+		static auto test(int) -> decltype(std::declval<A&>().allocateZeroed(size_t()), std::true_type());
+
+		template <class>
+		static std::false_type test(...);
+	public:
+		static const bool value = decltype(test<Allocator>(0))::value;
+	};
+
 	/**
 	 * MemoryManager
 	 *
 	 * Policy-based memory manager class
 	 * 	Allocator
 	 * 	BoundsChecker
+	 * 	Tracker
 	 *
 	 * Interoperates with the given policies to
 	 * 	-allocate / deallocate memory
 	 * 	-bounds checking
+	 * 	-tracking / recording of allocations
+	 *
+	 * Elements are constructed in order and destroyed in reverse order; types which are trivially default
+	 * constructible / destructible skip the loops entirely.
 	 *
 	 * Tested with gcc4.8, clang3.5, msvc2013
 	 */
-	template <class Allocator, class BoundsChecker>
+	template <class Allocator, class BoundsChecker, class Tracker = NoTrackingPolicy>
 	class MemoryManager {
 	public:
 
@@ -151,9 +221,11 @@ namespace ondraluk {
 		 *
 		 * @param allocator The used allocator
 		 * @param boundsChecker The used boundschecker
+		 * @param tracker The used tracker
 		 */
 		MemoryManager(Allocator allocator = Allocator(),
-					  BoundsChecker boundsChecker = BoundsChecker());
+					  BoundsChecker boundsChecker = BoundsChecker(),
+					  Tracker tracker = Tracker());
 
 		/**
 		 * Destructor
@@ -165,10 +237,9 @@ namespace ondraluk {
 		 *
 		 * Allocates memory for one instance of T
 		 *
-		 * @remark Internally uses compile time function lookup for differentiating between array, pods etc.
-		 *		   May reserve more memory than actually requested because of boundschecking, tracking ..
+		 * @remark May reserve more memory than actually requested because of boundschecking, tracking ..
 		 *
-		 * @return T*
+		 * @return T* nullptr if the allocator is out of memory
 		 */
 		template <typename T>
 		T* allocate();
@@ -176,39 +247,46 @@ namespace ondraluk {
 		 * Allocate
 		 *
 		 * @param size_t n
+		 * @param INIT::ENUM init
 		 *
 		 * Allocates memory for n * T
 		 *
-		 * @remark Internally uses compile time function lookup for differentiating between array, pods etc.
-		 *		   May reserve more memory than actually requested because of boundschecking, tracking ..
+		 * @remark May reserve more memory than actually requested because of boundschecking, tracking ..
+		 *		   If a constructor throws, the constructed elements are destroyed in reverse order,
+		 *		   the memory is freed and the exception is rethrown.
 		 *
-		 * @return T*
+		 * @return T* nullptr if the allocator is out of memory
 		 */
 		template <typename T>
-		T* allocate(size_t n);
+		T* allocate(size_t n, INIT::ENUM init = INIT::DEFAULT);
 
 		/**
 		 * Deallocate
 		 *
 		 * @param T* addr
 		 *
-		 * Deallocates the memory at given addr
+		 * Destroys the elements in reverse order and deallocates the memory at given addr
 		 *
-		 * @remark Internally uses compile time function lookup for differentiating between array, pods etc.
+		 * @remark The element count is read from the allocation header, E only documents the intent
 		 *
 		 * @return void
 		 */
 		template <typename T, ARRAY::ENUM E>
 		void deallocate(T* addr);
 
+		/**
+		 * @return const Allocator& the allocator policy, f.e. to ask which arena owns an allocation
+		 */
+		const Allocator& allocator() const;
+
 	private:
 
 		// Encapsulates some information about an allocation
 		// Mainly used for tracking
 		template <typename T>
 		struct Allocation {
-			Allocation() : mInternalSize(0), mSize(0) {}
-			Allocation(size_t internalsize) : mInternalSize(internalsize), mSize(0) {}
+			Allocation() : mVoid(nullptr), mInternalSize(0), mSize(0) {}
+			Allocation(size_t internalsize) : mVoid(nullptr), mInternalSize(internalsize), mSize(0) {}
 
 			union {
 				unsigned char* mByte;
@@ -219,41 +297,26 @@ namespace ondraluk {
 			size_t mSize;
 		};
 
+		/**
+		 * Gets the memory for n * T from the allocator and writes the header and the bounds
+		 */
 		template <typename T>
-#ifdef _WIN32
-		typename Allocation<T> allocate(podness<true>, arrayallocation<true>, size_t n);
-#else
-		Allocation<T> allocate(podness<true>, arrayallocation<true>, size_t n);
-#endif
-		template <typename T>
-#ifdef _WIN32
-		typename Allocation<T> allocate(podness<false>, arrayallocation<true>, size_t n);
-#else
-		Allocation<T> allocate(podness<false>, arrayallocation<true>, size_t n);
-#endif
-		template <typename T>
-#ifdef _WIN32
-		typename Allocation<T> allocate(podness<true>, arrayallocation<false>, size_t n);
-#else
-		Allocation<T> allocate(podness<true>, arrayallocation<false>, size_t n);
-#endif
-		template <typename T>
-#ifdef _WIN32
-		typename Allocation<T> allocate(podness<false>, arrayallocation<false>, size_t n);
-#else
-		Allocation<T> allocate(podness<false>, arrayallocation<false>, size_t n);
-#endif
+		Allocation<T> allocateBlock(size_t n, INIT::ENUM init);
+
+		void* allocateRaw(size_t size, std::true_type /* zeroed by allocator */, INIT::ENUM init);
+		void* allocateRaw(size_t size, std::false_type, INIT::ENUM init);
+
 		template <typename T>
-		void deallocate(podness<true>, T*& addr, arrayness<true>, size_t size);
+		void construct(trivialconstruction<true>, T* first, size_t n);
 
 		template <typename T>
-		void deallocate(podness<false>, T*& addr, arrayness<true>, size_t size);
+		void construct(trivialconstruction<false>, T* first, size_t n);
 
 		template <typename T>
-		void deallocate(podness<true>, T*& addr, arrayness<false>, size_t size);
+		void destroy(trivialdestruction<true>, T* first, size_t n);
 
 		template <typename T>
-		void deallocate(podness<false>, T*& addr, arrayness<false>, size_t size);
+		void destroy(trivialdestruction<false>, T* first, size_t n);
 
 		/**
 		 * Variables
@@ -261,216 +324,174 @@ namespace ondraluk {
 
 		Allocator mAllocator;
 		BoundsChecker mBoundsChecker;
+		Tracker mTracker;
 	};
 
-	template <class Allocator, class BoundsChecker>
-	MemoryManager<Allocator, BoundsChecker>::MemoryManager(Allocator allocator, BoundsChecker boundsChecker) :
+	template <class Allocator, class BoundsChecker, class Tracker>
+	MemoryManager<Allocator, BoundsChecker, Tracker>::MemoryManager(Allocator allocator, BoundsChecker boundsChecker, Tracker tracker) :
 													mAllocator(std::move(allocator)),
-													mBoundsChecker(std::move(boundsChecker)) {
+													mBoundsChecker(std::move(boundsChecker)),
+													mTracker(std::move(tracker)) {
 
 	}
 
-	template <class Allocator, class BoundsChecker>
-	MemoryManager<Allocator, BoundsChecker>::~MemoryManager() {
+	template <class Allocator, class BoundsChecker, class Tracker>
+	MemoryManager<Allocator, BoundsChecker, Tracker>::~MemoryManager() {
 	}
 
-	template <class Allocator, class BoundsChecker>
-	template <typename T>
-	T* MemoryManager<Allocator, BoundsChecker>::allocate() {
-		Allocation<T> alloc = allocate<T>(podness<std::is_pod<T>::value >(), arrayallocation<false>(), 1);
-
-		alloc.mSize = sizeof(T);
-
-#ifdef ONDRALUK_TRACKING
-		LOG(1, debuglib::logger::DEBUG, "\nMemory allocated:\n"
-				"\tstartaddress: %#08x\n"
-				"\tnumInstances: %u \n"
-				"\trequested size: %u byte(s) \n"
-				"\tinternal size: %u byte(s) \n"
-				"\tline: %u\n", alloc.mByte, 1, alloc.mSize, alloc.mInternalSize, __LINE__);
-#endif
+	template <class Allocator, class BoundsChecker, class Tracker>
+	const Allocator& MemoryManager<Allocator, BoundsChecker, Tracker>::allocator() const {
+		return mAllocator;
+	}
 
-		return alloc.mT;
+	template <class Allocator, class BoundsChecker, class Tracker>
+	template <typename T>
+	T* MemoryManager<Allocator, BoundsChecker, Tracker>::allocate() {
+		return allocate<T>(1);
 	}
 
-	template <class Allocator, class BoundsChecker>
+	template <class Allocator, class BoundsChecker, class Tracker>
 	template <typename T>
-	T* MemoryManager<Allocator, BoundsChecker>::allocate(size_t n) {
-		Allocation<T> alloc = allocate<T>(podness<std::is_pod<T>::value >(), arrayallocation<true>(), n);
+	T* MemoryManager<Allocator, BoundsChecker, Tracker>::allocate(size_t n, INIT::ENUM init) {
+		INSTRUMENT_SCOPE("MemoryManager::allocate");
+
+		Allocation<T> alloc = allocateBlock<T>(n, init);
+
+		if(alloc.mVoid == nullptr) {
+			return nullptr;
+		}
+
+		try {
+			construct(trivialconstruction<std::is_trivially_default_constructible<T>::value>(), alloc.mT, n);
+		} catch(...) {
+			mAllocator.free(alloc.mByte - (mBoundsChecker.BOUNDSIZE + sizeof(size_t)));
+			throw;
+		}
 
 		alloc.mSize = n * sizeof(T);
 
-#ifdef ONDRALUK_TRACKING
-		LOG(1, debuglib::logger::DEBUG, "\nMemory allocated:\n"
-				"\tstartaddress: %#08x\n"
-				"\tnumInstances: %u \n"
-				"\trequested size: %u byte(s) \n"
-				"\tinternal size: %u byte(s) \n"
-				"\tline: %u\n", alloc.mByte, n, alloc.mSize, alloc.mInternalSize, __LINE__);
+		mTracker.onAllocate(alloc.mVoid, alloc.mSize, std::alignment_of<T>::value);
+
+#if ONDRALUK_TRACKING
+		LOG_EVENT(1, debuglib::logger::DEBUG, "alloc",
+				debuglib::logger::LogField("addr", alloc.mVoid),
+				debuglib::logger::LogField("count", n),
+				debuglib::logger::LogField("size", alloc.mSize),
+				debuglib::logger::LogField("internal_size", alloc.mInternalSize));
 #endif
 
 		return alloc.mT;
 	}
 
-	template <class Allocator, class BoundsChecker>
+	template <class Allocator, class BoundsChecker, class Tracker>
 	template <typename T>
 #ifdef _WIN32
-	typename MemoryManager<Allocator, BoundsChecker>::Allocation<T> MemoryManager<Allocator, BoundsChecker>::allocate(podness<true>, arrayallocation<true>, size_t n) {
+	typename MemoryManager<Allocator, BoundsChecker, Tracker>::Allocation<T> MemoryManager<Allocator, BoundsChecker, Tracker>::allocateBlock(size_t n, INIT::ENUM init) {
 #else
-	MemoryManager<Allocator, BoundsChecker>::Allocation<T> MemoryManager<Allocator, BoundsChecker>::allocate(podness<true>, arrayallocation<true>, size_t n) {
+	MemoryManager<Allocator, BoundsChecker, Tracker>::Allocation<T> MemoryManager<Allocator, BoundsChecker, Tracker>::allocateBlock(size_t n, INIT::ENUM init) {
 #endif
-
 		Allocation<T> allocation;
 
 		union
-	    {
+		{
 			void* asVoid;
 			size_t* asSizeT;
-			T* asT;
 			unsigned char* asByte;
-	     };
+		};
 
 		size_t size = sizeof(T) * n + sizeof(size_t) + 2 * mBoundsChecker.BOUNDSIZE;
 
-		asVoid = mAllocator.allocate(size);
+		// need to allocate + sizeof(size_t) to be able to store the size in front of the elements
+		{
+			INSTRUMENT_SCOPE("Allocator::allocate");
+			asVoid = allocateRaw(size, std::integral_constant<bool, has_allocate_zeroed<Allocator>::value>(), init);
+		}
+
+		if(asVoid == nullptr) {
+			return allocation;
+		}
 
 		*asSizeT = sizeof(T) * n;
 
 		asByte += sizeof(size_t);
 
-		mBoundsChecker.fill(asVoid, size);
+		{
+			INSTRUMENT_SCOPE("BoundsChecker::fill");
+			mBoundsChecker.fill(asVoid, size);
+		}
 
 		asByte += mBoundsChecker.BOUNDSIZE;
 
-
 		allocation.mVoid = asVoid;
 		allocation.mInternalSize = size;
 
 		return allocation;
 	}
 
-	template <class Allocator, class BoundsChecker>
-	template <typename T>
-#ifdef _WIN32
-	typename MemoryManager<Allocator, BoundsChecker>::Allocation<T> MemoryManager<Allocator, BoundsChecker>::allocate(podness<false>, arrayallocation<true>, size_t n) {
-#else
-	MemoryManager<Allocator, BoundsChecker>::Allocation<T> MemoryManager<Allocator, BoundsChecker>::allocate(podness<false>, arrayallocation<true>, size_t n) {
-#endif
-		Allocation<T> allocation;
-
-		union
-		  {
-		    void* asVoid;
-		    size_t* asSizeT;
-		    T* asT;
-		    unsigned char* asByte;
-		  };
-
-		size_t size = sizeof(T) * n + sizeof(size_t) + 2 * mBoundsChecker.BOUNDSIZE;
-
-		// need to allocate + sizeof(size_t) to be able to store n in the four bytes before
-		asVoid = mAllocator.allocate(size);
-
-
-		*asSizeT = sizeof(T) * n;
-
-		asByte += sizeof(size_t);
-
-		mBoundsChecker.fill(asVoid, size);
-
-		asByte += mBoundsChecker.BOUNDSIZE;
+	template <class Allocator, class BoundsChecker, class Tracker>
+	void* MemoryManager<Allocator, BoundsChecker, Tracker>::allocateRaw(size_t size, std::true_type, INIT::ENUM init) {
+		return init == INIT::ZERO ? mAllocator.allocateZeroed(size) : mAllocator.allocate(size);
+	}
 
-		allocation.mVoid = asVoid;
-		allocation.mInternalSize = size;
+	template <class Allocator, class BoundsChecker, class Tracker>
+	void* MemoryManager<Allocator, BoundsChecker, Tracker>::allocateRaw(size_t size, std::false_type, INIT::ENUM init) {
+		void* mem = mAllocator.allocate(size);
 
-		const T* const beforeLast = asT + n;
-		while(asT < beforeLast) {
-			new (asT)T;
-			asT++;
+		if(mem != nullptr && init == INIT::ZERO) {
+			memset(mem, 0, size);
 		}
 
-		// return pointer to the first instance
-		return allocation;
+		return mem;
 	}
 
-	template <class Allocator, class BoundsChecker>
+	template <class Allocator, class BoundsChecker, class Tracker>
 	template <typename T>
-#ifdef _WIN32
-	typename MemoryManager<Allocator, BoundsChecker>::Allocation<T> MemoryManager<Allocator, BoundsChecker>::allocate(podness<false>, arrayallocation<false>, size_t n) {
-#else
-	MemoryManager<Allocator, BoundsChecker>::Allocation<T> MemoryManager<Allocator, BoundsChecker>::allocate(podness<false>, arrayallocation<false>, size_t n) {
-#endif
-		Allocation<T> allocation;
-
-		size_t size = sizeof(T) + 2 * mBoundsChecker.BOUNDSIZE + sizeof(size_t);
-
-		void* addr = mAllocator.allocate(size);
-
-		union {
-			void* asVoid;
-		    size_t* asSizeT;
-			unsigned char* asByte;
-		};
-
-		asVoid = addr;
-
-		*asSizeT = sizeof(T) * n;
-
-		asByte += sizeof(size_t);
-
-		mBoundsChecker.fill(asVoid, size);
-
-		asByte += (mBoundsChecker.BOUNDSIZE );
-
-		allocation.mVoid = asVoid;
-		allocation.mInternalSize = size;
-
-		new (asVoid) T;
-
-		return allocation;
+	void MemoryManager<Allocator, BoundsChecker, Tracker>::construct(trivialconstruction<true>, T*, size_t) {
 	}
 
-	template <class Allocator, class BoundsChecker>
+	template <class Allocator, class BoundsChecker, class Tracker>
 	template <typename T>
-#ifdef _WIN32
-	typename MemoryManager<Allocator, BoundsChecker>::Allocation<T> MemoryManager<Allocator, BoundsChecker>::allocate(podness<true>, arrayallocation<false>, size_t n) {
-#else
-	MemoryManager<Allocator, BoundsChecker>::Allocation<T> MemoryManager<Allocator, BoundsChecker>::allocate(podness<true>, arrayallocation<false>, size_t n) {
-#endif
-		Allocation<T> allocation;
-
-		size_t size = sizeof(T) + 2 * mBoundsChecker.BOUNDSIZE + sizeof(size_t);
-
-		void* addr = mAllocator.allocate(size);
-
-		union {
-			void* asVoid;
-		    size_t* asSizeT;
-			unsigned char* asByte;
-			T* asT;
-		};
-
-		asVoid = addr;
-
-		*asSizeT = sizeof(T);
-		asByte += sizeof(size_t);
-
-		mBoundsChecker.fill(asVoid, size);
+	void MemoryManager<Allocator, BoundsChecker, Tracker>::construct(trivialconstruction<false>, T* first, size_t n) {
+		size_t constructed = 0;
 
-		asByte += mBoundsChecker.BOUNDSIZE;
-
-		allocation.mVoid = asVoid;
-		allocation.mInternalSize = size;
+		try {
+			for(; constructed < n; ++constructed) {
+				new (first + constructed) T;
+			}
+		} catch(...) {
+			// unwind the elements constructed so far, like new T[n] does
+			destroy(trivialdestruction<std::is_trivially_destructible<T>::value>(), first, constructed);
+			throw;
+		}
+	}
 
-		return allocation;
+	template <class Allocator, class BoundsChecker, class Tracker>
+	template <typename T>
+	void MemoryManager<Allocator, BoundsChecker, Tracker>::destroy(trivialdestruction<true>, T*, size_t) {
 	}
 
+	template <class Allocator, class BoundsChecker, class Tracker>
+	template <typename T>
+	void MemoryManager<Allocator, BoundsChecker, Tracker>::destroy(trivialdestruction<false>, T* first, size_t n) {
+		// destruct from top
+		for(size_t i = n; i > 0; --i) {
+			first[i - 1].~T();
+		}
+	}
 
-	template <class Allocator, class BoundsChecker>
+	template <class Allocator, class BoundsChecker, class Tracker>
 	template <typename T, ARRAY::ENUM E>
-	void MemoryManager<Allocator, BoundsChecker>::deallocate(T* addr) {
+	void MemoryManager<Allocator, BoundsChecker, Tracker>::deallocate(T* addr) {
+		if(addr == nullptr) {
+			return;
+		}
+
+		INSTRUMENT_SCOPE("MemoryManager::deallocate");
+
 		Allocation<T> allocation;
 
+		mTracker.onDeallocate(addr);
+
 		union {
 			void* asVoid;
 		    size_t* asSizeT;
@@ -485,65 +506,26 @@ namespace ondraluk {
 		allocation.mSize = size;
 		allocation.mInternalSize = size + (sizeof(size_t) + 2 * mBoundsChecker.BOUNDSIZE);
 
-		mBoundsChecker.check(addr, size);
-
-		deallocate<T>(podness<std::is_pod<T>::value >(), addr, arrayness<E>(), size);
+		{
+			INSTRUMENT_SCOPE("BoundsChecker::check");
+			mBoundsChecker.check(addr, size);
+		}
 
-		asVoid = addr;
+		destroy(trivialdestruction<std::is_trivially_destructible<T>::value>(), addr, size / sizeof(T));
 
-		allocation.mVoid = asVoid;
+		allocation.mVoid = addr;
 
-#ifdef ONDRALUK_TRACKING
-		LOG(1, debuglib::logger::DEBUG, "\nMemory deallocated:\n"
-				"\tstartaddress: %#08x\n"
-				"\tnumInstances: %u \n"
-				"\trequested size: %u byte(s) \n"
-				"\tinternal size: %u byte(s) \n"
-				"\tline: %u\n", allocation.mByte, allocation.mSize / sizeof(T), allocation.mSize, allocation.mInternalSize, __LINE__);
+#if ONDRALUK_TRACKING
+		LOG_EVENT(1, debuglib::logger::DEBUG, "free",
+				debuglib::logger::LogField("addr", allocation.mVoid),
+				debuglib::logger::LogField("count", allocation.mSize / sizeof(T)),
+				debuglib::logger::LogField("size", allocation.mSize),
+				debuglib::logger::LogField("internal_size", allocation.mInternalSize));
 #endif
 
-		asByte -= (mBoundsChecker.BOUNDSIZE);
-
+		INSTRUMENT_SCOPE("Allocator::free");
 		mAllocator.free(asVoid);
 	}
-
-	template <class Allocator, class BoundsChecker>
-	template <typename T>
-	void MemoryManager<Allocator, BoundsChecker>::deallocate(podness<true>, T*& addr, arrayness<true>, size_t size) {
-	}
-
-	template <class Allocator, class BoundsChecker>
-	template <typename T>
-	void MemoryManager<Allocator, BoundsChecker>::deallocate(podness<false>, T*& addr, arrayness<true>, size_t size) {
-
-		union
-		{
-			size_t* asSizeT;
-			T* asT;
-			unsigned char* asByte;
-			void* asVoid;
-		};
-
-		asT = addr;
-
-		int numInstances = size / sizeof(T);
-
-		// destruct from top
-		for (size_t i = numInstances - 1; i > 0; --i) {
-			asT[i].~T();
-		}
-	}
-
-	template <class Allocator, class BoundsChecker>
-	template <typename T>
-	void MemoryManager<Allocator, BoundsChecker>::deallocate(podness<true>, T*& addr, arrayness<false>, size_t size) {
-	}
-
-	template <class Allocator, class BoundsChecker>
-	template <typename T>
-	void MemoryManager<Allocator, BoundsChecker>::deallocate(podness<false>, T*& addr, arrayness<false>, size_t size) {
-		addr->~T();
-	}
 }
 
 #endif
@@ -0,0 +1,64 @@
+/**
+ *  This file is part of the debuglib project
+ *  Copyright by Christian Ondracek
+ *  Contact: coder[at]paxi.at
+ *
+ *  Memory mapped file output policy
+ */
+
+#ifndef MMAPFILEOUTPUTTER_H
+#define MMAPFILEOUTPUTTER_H
+
+#include <cstddef>
+#include <memory>
+
+namespace debuglib
+{
+	namespace logger
+	{
+		// implementation detail, see MmapFileOutputter.cpp
+		class MappedLogFile;
+
+		/**
+		 * Outputting to a preallocated, memory mapped file.
+		 *
+		 * @remark Every message is appended by bumping an atomic offset into the mapping and copying the bytes,
+		 *		   so no syscall is issued on the logging path. Once a segment is full the next segment of the
+		 *		   file is preallocated and mapped. Since the mapping is shared, everything logged before a
+		 *		   crash survives in the page cache.
+		 *		   A message which does not fit into the rest of a segment is written into the next one, the
+		 *		   gap is left NUL-padded. On destruction the file is truncated to the logged size.
+		 *		   If the next segment can not be preallocated (disk full) later messages are dropped, what was
+		 *		   logged so far is kept.
+		 *		   Only available on POSIX systems.
+		 */
+		struct MmapFileOutputter {
+			// c_tor
+			MmapFileOutputter() {}
+
+			// move constructor
+			MmapFileOutputter(MmapFileOutputter&& other) {
+				std::swap(other.mFile, mFile);
+			}
+
+			// c_tor
+			explicit MmapFileOutputter(const char* fname, size_t segmentSize = 64 * 1024 * 1024);
+
+			void out(const char* msg) const;
+
+			/**
+			 * Schedules write back of the current segment (msync MS_ASYNC).
+			 * Not needed for surviving a process crash, only for surviving a machine crash.
+			 */
+			void flush() const;
+
+			mutable std::shared_ptr<MappedLogFile> mFile;
+
+		private:
+			MmapFileOutputter(const MmapFileOutputter&);
+			MmapFileOutputter& operator=(const MmapFileOutputter& other);
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,251 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file NumaAllocator.hpp
+ */
+
+#ifndef NUMAALLOCATOR_HPP
+#define NUMAALLOCATOR_HPP
+
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "MemoryManager.hpp"
+#include "NumaTopology.hpp"
+#include "PageSource.hpp"
+
+namespace ondraluk {
+
+	/**
+	 * How the memory of a NumaArena ended up on its node
+	 */
+	struct NUMABINDING {
+		enum ENUM {
+			// not bound, simulated topology or no NUMA support
+			NONE,
+			// bound with the mbind syscall (MPOL_BIND)
+			MBIND,
+			// every page was touched by a thread pinned to the cpus of the node
+			FIRST_TOUCH
+		};
+	};
+
+	/**
+	 * NumaArena
+	 *
+	 * Allocator whose region is placed on one NUMA node. The region is bound with mbind, if that is not possible
+	 * (no permission, kernel without NUMA) the pages are faulted in by a thread pinned to the node.
+	 *
+	 * Blocks are bumped off the region with a header holding their size and may be freed in any order: a freed
+	 * block goes to the free list of its power of two size class and is reused first fit, before the region
+	 * grows. Blocks are neither split nor merged.
+	 */
+	class NumaArena {
+	public:
+		// bytes of the block header, keeps the blocks 16 byte aligned
+		static const size_t OVERHEAD = 16;
+
+		// power of two size classes of the free lists
+		static const unsigned int CLASSES = 64;
+
+		/**
+		 * Constructor
+		 *
+		 * @param size - size in bytes
+		 * @param node - node the memory is placed on
+		 * @param topology
+		 * @param backend - preferred PageSource backend, malloc is replaced by mmap because mbind needs whole pages
+		 */
+		NumaArena(size_t size, unsigned int node, const NumaTopology& topology, PAGEBACKEND::ENUM backend = PAGEBACKEND::MMAP);
+
+		/**
+		 * Move constructor
+		 * @param
+		 */
+		NumaArena(NumaArena&&);
+
+		/**
+		 * Destructor
+		 */
+		~NumaArena();
+
+		/**
+		 * allocate
+		 *
+		 * @param size_t size
+		 *
+		 * @return void* pointer to memory, nullptr if the arena is exhausted
+		 */
+		void* allocate(size_t size);
+
+		/**
+		 * free
+		 *
+		 * @param void* mem
+		 *
+		 * Puts the block on the free list of its size class
+		 *
+		 * @return void
+		 */
+		void free(void* mem);
+
+		/**
+		 * @return bool true if mem lies within the region of this arena
+		 */
+		bool owns(const void* mem) const;
+
+		/**
+		 * @return unsigned int the node of the arena
+		 */
+		unsigned int node() const;
+
+		/**
+		 * @return NUMABINDING::ENUM how the region was placed
+		 */
+		NUMABINDING::ENUM binding() const;
+
+		/**
+		 * @return PAGEBACKEND::ENUM the backend which actually provided the region
+		 */
+		PAGEBACKEND::ENUM backend() const;
+	private:
+		/**
+		 * Private copy constructor
+		 * @param
+		 */
+		NumaArena(const NumaArena&);
+
+		struct BlockHeader {
+			// of the whole block, header included
+			size_t mSize;
+			unsigned char mPadding[OVERHEAD - sizeof(size_t)];
+		};
+
+		struct FreeBlock {
+			FreeBlock* mNext;
+		};
+
+		static BlockHeader* headerOf(void* mem);
+
+		static unsigned int classOf(size_t size);
+
+		/**
+		 * Variables
+		 */
+
+		PageRegion mRegion;
+
+		FreeBlock* mFree[CLASSES];
+
+		unsigned char* mCurrent;
+
+		unsigned char* mEnd;
+
+		unsigned int mNode;
+
+		NUMABINDING::ENUM mBinding;
+	};
+
+	/**
+	 * Returns the cpu the calling thread currently runs on
+	 */
+	typedef std::function<unsigned int()> CpuSource;
+
+	/**
+	 * @return unsigned int the cpu of the calling thread (sched_getcpu), 0 if unknown
+	 */
+	unsigned int currentCpu();
+
+	/**
+	 * NumaAllocator
+	 *
+	 * Allocator policy with one NumaArena per node. allocate uses the arena of the node the calling thread runs on,
+	 * free returns the memory to the arena owning it. Arenas are locked individually, threads on different
+	 * nodes never contend.
+	 *
+	 * @remark The cpu source can be replaced to pin the node selection in tests
+	 */
+	class NumaAllocator {
+	public:
+		/**
+		 * Constructor
+		 *
+		 * @param arenaSize - size of every node arena in bytes
+		 * @param topology
+		 * @param cpuSource
+		 * @param backend - preferred PageSource backend of the arenas
+		 */
+		NumaAllocator(size_t arenaSize, const NumaTopology& topology = NumaTopology::detect(), CpuSource cpuSource = currentCpu,
+			PAGEBACKEND::ENUM backend = PAGEBACKEND::MMAP);
+
+		/**
+		 * allocate
+		 *
+		 * @param size_t size
+		 *
+		 * @return void* pointer to memory on the node of the calling thread, nullptr if its arena is exhausted
+		 */
+		void* allocate(size_t size);
+
+		/**
+		 * free
+		 *
+		 * @param void* mem
+		 *
+		 * @return void
+		 */
+		void free(void* mem);
+
+		/**
+		 * @return bool true if one of the arenas owns mem
+		 */
+		bool owns(const void* mem) const;
+
+		/**
+		 * @return unsigned int node the calling thread allocates from
+		 */
+		unsigned int currentNode() const;
+
+		/**
+		 * @return const NumaArena& arena of the node
+		 */
+		const NumaArena& arena(unsigned int node) const;
+
+		/**
+		 * @return const NumaTopology&
+		 */
+		const NumaTopology& topology() const;
+	private:
+		struct Node {
+			Node(size_t size, unsigned int node, const NumaTopology& topology, PAGEBACKEND::ENUM backend) : mArena(size, node, topology, backend) {}
+
+			std::mutex mLock;
+			NumaArena mArena;
+		};
+
+		/**
+		 * Variables
+		 */
+
+		NumaTopology mTopology;
+
+		CpuSource mCpuSource;
+
+		std::vector<std::unique_ptr<Node> > mNodes;
+	};
+
+	/**
+	 * MemoryManager front end placing every allocation on the node of the allocating thread
+	 */
+	template <class BoundsChecker = NoBoundsCheckingPolicy, class Tracker = NoTrackingPolicy>
+	using NumaMemoryManager = MemoryManager<NumaAllocator, BoundsChecker, Tracker>;
+
+}
+
+#endif
@@ -0,0 +1,92 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file NumaTopology.hpp
+ */
+
+#ifndef NUMATOPOLOGY_HPP
+#define NUMATOPOLOGY_HPP
+
+#include <vector>
+
+namespace ondraluk {
+
+	/**
+	 * NumaTopology
+	 *
+	 * Maps cpus to NUMA nodes. Either read from /sys/devices/system/node or simulated, so the NUMA allocators
+	 * can be exercised on single node machines.
+	 */
+	class NumaTopology {
+	public:
+		/**
+		 * detect
+		 *
+		 * Reads the topology of the running system. Falls back to a single node holding every cpu if it can not be read.
+		 *
+		 * @return NumaTopology
+		 */
+		static NumaTopology detect();
+
+		/**
+		 * simulated
+		 *
+		 * Cpus are assigned to the nodes in blocks: cpu 0..cpusPerNode-1 on node 0 and so on
+		 *
+		 * @param unsigned int nodes
+		 * @param unsigned int cpusPerNode
+		 *
+		 * @return NumaTopology
+		 */
+		static NumaTopology simulated(unsigned int nodes, unsigned int cpusPerNode);
+
+		/**
+		 * @return unsigned int number of nodes, at least 1
+		 */
+		unsigned int nodeCount() const;
+
+		/**
+		 * @return unsigned int number of cpus known to the topology
+		 */
+		unsigned int cpuCount() const;
+
+		/**
+		 * nodeOfCpu
+		 *
+		 * @param unsigned int cpu
+		 *
+		 * @return unsigned int the node of the cpu, 0 for cpus unknown to the topology
+		 */
+		unsigned int nodeOfCpu(unsigned int cpu) const;
+
+		/**
+		 * @return const std::vector<unsigned int>& the cpus of the node
+		 */
+		const std::vector<unsigned int>& cpusOfNode(unsigned int node) const;
+
+		/**
+		 * @return bool true if the topology does not describe the real system; memory is not bound then
+		 */
+		bool isSimulated() const;
+	private:
+		NumaTopology();
+
+		void add(unsigned int cpu, unsigned int node);
+
+		/**
+		 * Variables
+		 */
+
+		std::vector<unsigned int> mCpuToNode;
+
+		std::vector<std::vector<unsigned int> > mNodeToCpus;
+
+		bool mSimulated;
+	};
+
+}
+
+#endif
@@ -0,0 +1,93 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file PageSource.hpp
+ */
+
+#ifndef PAGESOURCE_HPP
+#define PAGESOURCE_HPP
+
+#include <cstdlib>
+
+namespace ondraluk {
+
+	/**
+	 * Backends a PageSource can get its memory from, from cheapest to most TLB friendly
+	 */
+	struct PAGEBACKEND {
+		enum ENUM {
+			// ::malloc
+			MALLOC,
+			// anonymous private mmap
+			MMAP,
+			// anonymous mmap aligned to the huge page size, advised with MADV_HUGEPAGE (transparent huge pages)
+			MMAP_TRANSPARENT_HUGE,
+			// anonymous mmap with MAP_HUGETLB from the preallocated huge page pool
+			MMAP_HUGETLB
+		};
+	};
+
+	/**
+	 * A region handed out by the PageSource
+	 */
+	struct PageRegion {
+		PageRegion() : mMem(nullptr), mSize(0), mBackend(PAGEBACKEND::MALLOC) {}
+
+		void* mMem;
+		// size of the mapping, at least the requested size
+		size_t mSize;
+		// the backend which actually provided the memory
+		PAGEBACKEND::ENUM mBackend;
+	};
+
+	/**
+	 * PageSource
+	 *
+	 * Provides the large regions the allocators carve up.
+	 * If the requested backend is not available (no huge pages reserved, THP disabled, not a POSIX system) it falls
+	 * back to the next cheaper backend: MMAP_HUGETLB -> MMAP_TRANSPARENT_HUGE -> MMAP -> MALLOC.
+	 * The backend that was used is reported in the returned region.
+	 */
+	class PageSource {
+	public:
+		/**
+		 * acquire
+		 *
+		 * @param size_t size
+		 * @param PAGEBACKEND::ENUM preferred
+		 *
+		 * @return PageRegion mMem is nullptr if even malloc failed
+		 */
+		static PageRegion acquire(size_t size, PAGEBACKEND::ENUM preferred);
+
+		/**
+		 * release
+		 *
+		 * @param const PageRegion& region A region returned by acquire
+		 *
+		 * @return void
+		 */
+		static void release(const PageRegion& region);
+
+		/**
+		 * @return size_t the size of a regular page
+		 */
+		static size_t pageSize();
+
+		/**
+		 * @return size_t the default huge page size, 0 if the system has none
+		 */
+		static size_t hugePageSize();
+
+		/**
+		 * @return const char* printable name of the backend
+		 */
+		static const char* name(PAGEBACKEND::ENUM backend);
+	};
+
+}
+
+#endif
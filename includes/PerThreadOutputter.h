@@ -0,0 +1,327 @@
+/**
+ *  This file is part of the debuglib project
+ *  Copyright by Christian Ondracek
+ *  Contact: coder[at]paxi.at
+ *
+ *  Per thread log buffers merged into one timeline
+ */
+
+#ifndef PERTHREADOUTPUTTER_H
+#define PERTHREADOUTPUTTER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "CycleClock.h"
+
+namespace debuglib
+{
+	namespace logger
+	{
+		/**
+		 * Outputting through per thread buffers.
+		 *
+		 * Wraps any other output policy. Every producing thread appends its messages together with a monotonic
+		 * timestamp (see CycleClock.h) to its own preallocated buffer, so producers never contend with each other.
+		 * flush() collects the buffers of all threads, merges the messages by timestamp and hands them to the
+		 * wrapped outputter, which therefore only ever sees a single writer.
+		 *
+		 * @remark A thread whose buffer is full flushes on its own. Every buffer is double buffered: the collector
+		 *		   swaps it out under a per thread spin lock and merges without blocking the producer.
+		 *		   Messages are ordered within every flush; a message stamped while a flush is collecting may end up
+		 *		   in the next one.
+		 *		   The buffer of a thread which ended is drained by the next flush and freed.
+		 */
+		template <class Outputter>
+		struct PerThreadOutputter {
+			// c_tor
+			PerThreadOutputter() {}
+
+			// move constructor
+			PerThreadOutputter(PerThreadOutputter&& other) {
+				std::swap(other.mState, mState);
+			}
+
+			// c_tor
+			explicit PerThreadOutputter(Outputter outputter, size_t bufferSize = 1 << 20) :
+				mState(std::make_shared<State>(std::move(outputter), bufferSize)) {
+
+			}
+
+			void out(const char* msg) const {
+				if(mState) {
+					mState->append(msg, strlen(msg));
+				}
+			}
+
+			void flush() const {
+				if(mState) {
+					mState->collect();
+				}
+			}
+
+			/**
+			 * Number of bytes currently waiting in the buffers of all threads.
+			 */
+			size_t pending() const {
+				return mState ? mState->pending() : 0;
+			}
+
+			/**
+			 * Number of thread buffers, one per thread which logged and did not end before the last flush.
+			 */
+			size_t buffers() const {
+				return mState ? mState->buffers() : 0;
+			}
+
+		private:
+			PerThreadOutputter(const PerThreadOutputter&);
+			PerThreadOutputter& operator=(const PerThreadOutputter& other);
+
+			// header of every message in a buffer, followed by the \0 terminated message
+			struct Record {
+				uint64_t mTimestamp;
+				uint32_t mLength;
+			};
+
+			static size_t recordSize(size_t length) {
+				return (sizeof(Record) + length + 1 + 7) & ~static_cast<size_t>(7);
+			}
+
+			struct ThreadBuffer {
+				explicit ThreadBuffer(size_t size) : mSize(size), mActiveUsed(0), mStandbyUsed(0), mRetired(false) {
+					mLock.clear();
+					mActive = static_cast<char*>(::malloc(size));
+					mStandby = static_cast<char*>(::malloc(size));
+				}
+
+				~ThreadBuffer() {
+					::free(mActive);
+					::free(mStandby);
+				}
+
+				void lock() {
+					while(mLock.test_and_set(std::memory_order_acquire)) {
+					}
+				}
+
+				void unlock() {
+					mLock.clear(std::memory_order_release);
+				}
+
+				size_t mSize;
+
+				// written by the owning thread
+				char* mActive;
+				size_t mActiveUsed;
+
+				// owned by the collector
+				char* mStandby;
+				size_t mStandbyUsed;
+
+				// the owning thread ended, guarded by mCollectMutex
+				bool mRetired;
+
+				std::atomic_flag mLock;
+			};
+
+			class State : public std::enable_shared_from_this<State> {
+			public:
+				State(Outputter outputter, size_t bufferSize) : mOutputter(std::move(outputter)), mBufferSize(bufferSize), mId(nextId()) {}
+
+				~State() {
+					collect();
+				}
+
+				void append(const char* msg, size_t length) {
+					size_t size = recordSize(length);
+
+					// a message larger than a whole buffer bypasses the buffers, after everything logged before it
+					if(size > mBufferSize) {
+						std::lock_guard<std::mutex> lock(mCollectMutex);
+						collectLocked();
+						mOutputter.out(msg);
+						return;
+					}
+
+					ThreadBuffer& buffer = threadBuffer();
+
+					while(true) {
+						buffer.lock();
+
+						if(buffer.mActiveUsed + size <= buffer.mSize) {
+							Record* record = reinterpret_cast<Record*>(buffer.mActive + buffer.mActiveUsed);
+							record->mTimestamp = debuglib::clock::ticks();
+							record->mLength = static_cast<uint32_t>(length);
+							memcpy(record + 1, msg, length + 1);
+
+							buffer.mActiveUsed += size;
+							buffer.unlock();
+							return;
+						}
+
+						buffer.unlock();
+						collect();
+					}
+				}
+
+				void collect() {
+					std::lock_guard<std::mutex> lock(mCollectMutex);
+					collectLocked();
+				}
+
+				size_t pending() {
+					std::lock_guard<std::mutex> lock(mCollectMutex);
+					size_t bytes = 0;
+
+					for(size_t i = 0; i < mBuffers.size(); ++i) {
+						mBuffers[i]->lock();
+						bytes += mBuffers[i]->mActiveUsed;
+						mBuffers[i]->unlock();
+					}
+
+					return bytes;
+				}
+
+				size_t buffers() {
+					std::lock_guard<std::mutex> lock(mCollectMutex);
+					return mBuffers.size();
+				}
+
+			private:
+				State(const State&);
+				State& operator=(const State&);
+
+				// position within the standby buffer of one thread during the merge
+				struct Cursor {
+					Cursor(const Record* record, size_t buffer) : mRecord(record), mBuffer(buffer) {}
+
+					bool operator<(const Cursor& other) const {
+						// priority_queue is a max heap
+						return mRecord->mTimestamp > other.mRecord->mTimestamp;
+					}
+
+					const Record* mRecord;
+					size_t mBuffer;
+				};
+
+				static uint64_t nextId() {
+					static std::atomic<uint64_t> id(0);
+					return ++id;
+				}
+
+				/**
+				 * Buffers of one thread, retires them when the thread ends
+				 */
+				struct ThreadBuffers {
+					struct Entry {
+						uint64_t mId;
+						std::weak_ptr<State> mState;
+						ThreadBuffer* mBuffer;
+					};
+
+					~ThreadBuffers() {
+						for(size_t i = 0; i < mEntries.size(); ++i) {
+							std::shared_ptr<State> state = mEntries[i].mState.lock();
+
+							if(state) {
+								std::lock_guard<std::mutex> lock(state->mCollectMutex);
+								mEntries[i].mBuffer->mRetired = true;
+							}
+						}
+					}
+
+					std::vector<Entry> mEntries;
+				};
+
+				ThreadBuffer& threadBuffer() {
+					// ids are never reused, so entries of destroyed outputters can not match
+					static thread_local ThreadBuffers buffers;
+
+					for(size_t i = 0; i < buffers.mEntries.size(); ++i) {
+						if(buffers.mEntries[i].mId == mId) {
+							return *buffers.mEntries[i].mBuffer;
+						}
+					}
+
+					// forget outputters destroyed in the meantime
+					buffers.mEntries.erase(std::remove_if(buffers.mEntries.begin(), buffers.mEntries.end(), [](const typename ThreadBuffers::Entry& entry) {
+						return entry.mState.expired();
+					}), buffers.mEntries.end());
+
+					ThreadBuffer* buffer = new ThreadBuffer(mBufferSize);
+					{
+						std::lock_guard<std::mutex> lock(mCollectMutex);
+						mBuffers.push_back(std::unique_ptr<ThreadBuffer>(buffer));
+					}
+
+					typename ThreadBuffers::Entry entry = { mId, this->shared_from_this(), buffer };
+					buffers.mEntries.push_back(entry);
+					return *buffer;
+				}
+
+				void collectLocked() {
+					std::priority_queue<Cursor> merge;
+
+					for(size_t i = 0; i < mBuffers.size(); ++i) {
+						ThreadBuffer& buffer = *mBuffers[i];
+
+						buffer.lock();
+						std::swap(buffer.mActive, buffer.mStandby);
+						buffer.mStandbyUsed = buffer.mActiveUsed;
+						buffer.mActiveUsed = 0;
+						buffer.unlock();
+
+						if(buffer.mStandbyUsed > 0) {
+							merge.push(Cursor(reinterpret_cast<const Record*>(buffer.mStandby), i));
+						}
+					}
+
+					bool merged = !merge.empty();
+
+					while(!merge.empty()) {
+						Cursor cursor = merge.top();
+						merge.pop();
+
+						mOutputter.out(reinterpret_cast<const char*>(cursor.mRecord + 1));
+
+						const ThreadBuffer& buffer = *mBuffers[cursor.mBuffer];
+						const char* next = reinterpret_cast<const char*>(cursor.mRecord) + recordSize(cursor.mRecord->mLength);
+
+						if(next < buffer.mStandby + buffer.mStandbyUsed) {
+							merge.push(Cursor(reinterpret_cast<const Record*>(next), cursor.mBuffer));
+						}
+					}
+
+					if(merged) {
+						mOutputter.flush();
+					}
+
+					// the owners of retired buffers ended, everything they logged was merged above
+					mBuffers.erase(std::remove_if(mBuffers.begin(), mBuffers.end(), [](const std::unique_ptr<ThreadBuffer>& buffer) {
+						return buffer->mRetired;
+					}), mBuffers.end());
+				}
+
+				Outputter mOutputter;
+				size_t mBufferSize;
+				uint64_t mId;
+
+				std::mutex mCollectMutex;
+				std::vector<std::unique_ptr<ThreadBuffer> > mBuffers;
+			};
+
+			mutable std::shared_ptr<State> mState;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,191 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file PoisoningAllocator.hpp
+ */
+
+#ifndef POISONINGALLOCATOR_HPP
+#define POISONINGALLOCATOR_HPP
+
+#include <cassert>
+#include <cstdlib>
+#include <functional>
+#include <utility>
+
+#include "Sanitizer.hpp"
+
+#ifndef ONDRALUK_TRACKING
+#define ONDRALUK_TRACKING 1
+#endif
+
+#if ONDRALUK_TRACKING
+#include "Logger.h"
+#endif
+
+namespace ondraluk {
+
+	/**
+	 * Called when a block leaving the quarantine was written to after it had been freed
+	 *
+	 * @param block the address handed out by allocate
+	 * @param offset first modified byte, relative to block
+	 */
+	typedef std::function<void(const void* block, size_t offset)> UseAfterFreeHandler;
+
+	/**
+	 * PoisoningAllocator
+	 *
+	 * Debug policy catching use-after-free in front of any allocator:
+	 * 	-freed blocks are filled with Pattern and poisoned for AddressSanitizer
+	 * 	-they are kept in a FIFO quarantine of QuarantineSize blocks instead of being reused right away
+	 * 	-when a block leaves the quarantine the pattern is verified before the block goes back to Alloc
+	 *
+	 * Writes through stale pointers are reported to the handler (asserts without one), reads return the pattern.
+	 * Under ASan every access to a quarantined block is reported immediately.
+	 *
+	 * @remark Alloc has to accept frees in any order; LinearAllocator rewinds and must not be wrapped, it carries
+	 *		   the ASan annotations itself
+	 */
+	template <class Alloc, size_t QuarantineSize = 256, unsigned char Pattern = 0xDD>
+	class PoisoningAllocator {
+		static_assert(QuarantineSize > 0, "QuarantineSize == 0");
+
+	public:
+		static const size_t HEADER = 16;
+
+		PoisoningAllocator(Alloc allocator = Alloc(), UseAfterFreeHandler handler = UseAfterFreeHandler()) :
+			mAllocator(std::move(allocator)), mHandler(handler), mHead(0), mCount(0), mCorruptions(0) {}
+
+		PoisoningAllocator(PoisoningAllocator&& other) : mAllocator(std::move(other.mAllocator)), mHandler(std::move(other.mHandler)),
+			mHead(other.mHead), mCount(other.mCount), mCorruptions(other.mCorruptions) {
+			for(size_t i = 0; i < QuarantineSize; ++i) {
+				mQuarantine[i] = other.mQuarantine[i];
+			}
+			other.mCount = 0;
+		}
+
+		~PoisoningAllocator() {
+			flush();
+		}
+
+		void* allocate(size_t size) {
+			unsigned char* mem = static_cast<unsigned char*>(mAllocator.allocate(size + HEADER));
+
+			if(mem == nullptr) {
+				return nullptr;
+			}
+
+			*reinterpret_cast<size_t*>(mem) = size;
+
+			return mem + HEADER;
+		}
+
+		void free(void* mem) {
+			if(mem == nullptr) {
+				return;
+			}
+
+			unsigned char* block = static_cast<unsigned char*>(mem) - HEADER;
+			size_t size = *reinterpret_cast<size_t*>(block);
+
+			fillPattern(mem, size, Pattern);
+			ONDRALUK_POISON_MEMORY_REGION(block, size + HEADER);
+
+			if(mCount == QuarantineSize) {
+				release(mQuarantine[mHead]);
+				--mCount;
+			}
+
+			mQuarantine[(mHead + mCount) % QuarantineSize] = block;
+			++mCount;
+		}
+
+		bool owns(const void* mem) const {
+			return mAllocator.owns(mem);
+		}
+
+		/**
+		 * flush
+		 *
+		 * Verifies and releases every quarantined block
+		 *
+		 * @return void
+		 */
+		void flush() {
+			while(mCount > 0) {
+				release(mQuarantine[mHead]);
+				--mCount;
+			}
+		}
+
+		/**
+		 * @return size_t blocks currently in the quarantine
+		 */
+		size_t quarantined() const { return mCount; }
+
+		/**
+		 * @return size_t number of blocks found modified after free
+		 */
+		size_t corruptions() const { return mCorruptions; }
+
+		Alloc& allocator() { return mAllocator; }
+	private:
+		PoisoningAllocator(const PoisoningAllocator&);
+
+		/**
+		 * Takes the oldest block out of the quarantine, verifies the pattern and hands the block back to Alloc
+		 */
+		void release(unsigned char* block) {
+			mHead = (mHead + 1) % QuarantineSize;
+
+			ONDRALUK_UNPOISON_MEMORY_REGION(block, HEADER);
+			size_t size = *reinterpret_cast<size_t*>(block);
+			ONDRALUK_UNPOISON_MEMORY_REGION(block + HEADER, size);
+
+			size_t offset = findPatternMismatch(block + HEADER, size, Pattern);
+
+			if(offset != size) {
+				++mCorruptions;
+
+#if ONDRALUK_TRACKING
+				LOG_EVENT(1, debuglib::logger::ERR, "use_after_free",
+						debuglib::logger::LogField("addr", static_cast<const void*>(block + HEADER)),
+						debuglib::logger::LogField("offset", offset),
+						debuglib::logger::LogField("size", size));
+#endif
+
+				if(mHandler) {
+					mHandler(block + HEADER, offset);
+				} else {
+					assert(false);
+				}
+			}
+
+			mAllocator.free(block);
+		}
+
+		/**
+		 * Variables
+		 */
+
+		Alloc mAllocator;
+
+		UseAfterFreeHandler mHandler;
+
+		// ring buffer, oldest block at mHead
+		unsigned char* mQuarantine[QuarantineSize];
+		size_t mHead;
+		size_t mCount;
+
+		size_t mCorruptions;
+	};
+
+	template <class Alloc, size_t QuarantineSize, unsigned char Pattern>
+	const size_t PoisoningAllocator<Alloc, QuarantineSize, Pattern>::HEADER;
+
+}
+
+#endif
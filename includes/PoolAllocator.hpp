@@ -0,0 +1,179 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file PoolAllocator.hpp
+ */
+
+#ifndef POOLALLOCATOR_HPP
+#define POOLALLOCATOR_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "PageSource.hpp"
+
+namespace ondraluk {
+
+	/**
+	 * PoolAllocator
+	 *
+	 * Allocator for blocks of one fixed size, carved from a single PageSource region.
+	 * Freed blocks go to an intrusive free list, untouched blocks are handed out in address order,
+	 * so pages of a large pool are only faulted in when they are first used.
+	 */
+	class PoolAllocator {
+	public:
+		/**
+		 * Position of an incremental free list walk, see markFree
+		 */
+		struct FreeListCursor {
+			FreeListCursor() : mNext(nullptr), mGeneration(0), mStarted(false) {}
+
+			const void* mNext;
+			uint64_t mGeneration;
+			bool mStarted;
+		};
+
+		/**
+		 * Constructor
+		 *
+		 * @param blockSize - size of every block, rounded up to the pointer size
+		 * @param blockCount - number of blocks in the pool
+		 * @param backend - preferred PageSource backend, falls back to cheaper ones if not available
+		 */
+		PoolAllocator(size_t blockSize, size_t blockCount, PAGEBACKEND::ENUM backend = PAGEBACKEND::MALLOC);
+
+		/**
+		 * Move constructor
+		 * @param
+		 */
+		PoolAllocator(PoolAllocator&&);
+
+		/**
+		 * Destructor
+		 *
+		 * Releases the region
+		 */
+		~PoolAllocator();
+
+		/**
+		 * allocate
+		 *
+		 * @param size_t size
+		 *
+		 * @return void* pointer to a block, nullptr if size is larger than the block size or the pool is exhausted
+		 */
+		void* allocate(size_t size);
+
+		/**
+		 * free
+		 *
+		 * @param void* mem A block returned by allocate
+		 *
+		 * @return void
+		 */
+		void free(void* mem);
+
+		/**
+		 * owns
+		 *
+		 * @param const void* mem
+		 *
+		 * @return bool true if mem lies within the region of this allocator
+		 */
+		bool owns(const void* mem) const;
+
+		/**
+		 * @return size_t the block size after rounding
+		 */
+		size_t blockSize() const;
+
+		/**
+		 * @return size_t the number of blocks
+		 */
+		size_t blockCount() const;
+
+		/**
+		 * @return PAGEBACKEND::ENUM the backend which actually provided the region
+		 */
+		PAGEBACKEND::ENUM backend() const;
+
+		/**
+		 * @return size_t the number of blocks currently handed out
+		 */
+		size_t used() const;
+
+		/**
+		 * @return size_t the number of blocks handed out at least once, free or not
+		 */
+		size_t touched() const;
+
+		/**
+		 * blockStates
+		 *
+		 * Walks the free list, O(blockCount)
+		 *
+		 * @param std::vector<bool>& used - resized to touched(), true for every block currently handed out
+		 *
+		 * @return void
+		 */
+		void blockStates(std::vector<bool>& used) const;
+
+		/**
+		 * markFree
+		 *
+		 * Incremental blockStates: follows up to maxLinks links of the free list per call. If the pool was modified
+		 * since the previous call the walk starts over, used is reset to touched() blocks in use.
+		 *
+		 * @param std::vector<bool>& used
+		 * @param FreeListCursor& cursor - default constructed for a new walk
+		 * @param size_t maxLinks
+		 *
+		 * @return bool true once the whole free list was marked
+		 */
+		bool markFree(std::vector<bool>& used, FreeListCursor& cursor, size_t maxLinks) const;
+
+		/**
+		 * @return uint64_t counts every allocate and free
+		 */
+		uint64_t generation() const;
+	private:
+		/**
+		 * Private copy constructor
+		 * @param
+		 */
+		PoolAllocator(const PoolAllocator&);
+
+		struct FreeBlock {
+			FreeBlock* mNext;
+		};
+
+		/**
+		 * Variables
+		 */
+
+		PageRegion mRegion;
+
+		FreeBlock* mFreeList;
+
+		// first block which was never handed out
+		unsigned char* mUntouched;
+
+		unsigned char* mEnd;
+
+		size_t mBlockSize;
+
+		size_t mBlockCount;
+
+		size_t mUsed;
+
+		uint64_t mGeneration;
+	};
+
+}
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file Sanitizer.hpp
+ *
+ * AddressSanitizer annotations for the allocators and the pattern fill / verify used to catch use-after-free.
+ * Without ASan the annotations compile to nothing.
+ */
+
+#ifndef SANITIZER_HPP
+#define SANITIZER_HPP
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SANITIZE_ADDRESS__)
+	#define ONDRALUK_ASAN 1
+#elif defined(__has_feature)
+	#if __has_feature(address_sanitizer)
+		#define ONDRALUK_ASAN 1
+	#endif
+#endif
+
+#ifndef ONDRALUK_ASAN
+	#define ONDRALUK_ASAN 0
+#endif
+
+#if ONDRALUK_ASAN
+	#include <sanitizer/asan_interface.h>
+
+	// accesses to poisoned memory are reported by ASan like accesses to freed heap memory
+	#define ONDRALUK_POISON_MEMORY_REGION(addr, size) ASAN_POISON_MEMORY_REGION(addr, size)
+	#define ONDRALUK_UNPOISON_MEMORY_REGION(addr, size) ASAN_UNPOISON_MEMORY_REGION(addr, size)
+#else
+	#define ONDRALUK_POISON_MEMORY_REGION(addr, size) ((void)(addr), (void)(size))
+	#define ONDRALUK_UNPOISON_MEMORY_REGION(addr, size) ((void)(addr), (void)(size))
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+	#include <emmintrin.h>
+	#define ONDRALUK_SSE2 1
+#else
+	#define ONDRALUK_SSE2 0
+#endif
+
+namespace ondraluk {
+
+	/**
+	 * fillPattern
+	 *
+	 * @param void* begin
+	 * @param size_t size
+	 * @param unsigned char pattern
+	 *
+	 * Fills the memory with pattern, 16 bytes per store with SSE2
+	 *
+	 * @return void
+	 */
+	inline void fillPattern(void* begin, size_t size, unsigned char pattern) {
+		unsigned char* byte = static_cast<unsigned char*>(begin);
+		size_t i = 0;
+
+#if ONDRALUK_SSE2
+		const __m128i value = _mm_set1_epi8(static_cast<char>(pattern));
+
+		for(; i + 16 <= size; i += 16) {
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(byte + i), value);
+		}
+#endif
+
+		for(; i < size; ++i) {
+			byte[i] = pattern;
+		}
+	}
+
+	/**
+	 * findPatternMismatch
+	 *
+	 * @param const void* begin
+	 * @param size_t size
+	 * @param unsigned char pattern
+	 *
+	 * Compares 16 bytes at a time with SSE2
+	 *
+	 * @return size_t offset of the first byte differing from pattern, size if all match
+	 */
+	inline size_t findPatternMismatch(const void* begin, size_t size, unsigned char pattern) {
+		const unsigned char* byte = static_cast<const unsigned char*>(begin);
+		size_t i = 0;
+
+#if ONDRALUK_SSE2
+		const __m128i value = _mm_set1_epi8(static_cast<char>(pattern));
+
+		for(; i + 16 <= size; i += 16) {
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(byte + i));
+			int equal = _mm_movemask_epi8(_mm_cmpeq_epi8(block, value));
+
+			if(equal != 0xFFFF) {
+				break;
+			}
+		}
+#endif
+
+		for(; i < size; ++i) {
+			if(byte[i] != pattern) {
+				return i;
+			}
+		}
+
+		return size;
+	}
+
+}
+
+#endif
@@ -0,0 +1,304 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file SharedMemoryAllocator.hpp
+ */
+
+#ifndef SHAREDMEMORYALLOCATOR_HPP
+#define SHAREDMEMORYALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+
+#include "StdAllocator.hpp"
+
+namespace ondraluk {
+
+	/**
+	 * OffsetPtr
+	 *
+	 * Pointer storing the distance to itself instead of an address, so it stays valid wherever the memory
+	 * holding both the pointer and the target is mapped. Used for links inside shared memory.
+	 * A random access iterator and a pointer type for allocators, see StdAllocator.
+	 */
+	template <typename T>
+	class OffsetPtr {
+	public:
+		typedef T element_type;
+		typedef typename std::remove_cv<T>::type value_type;
+		typedef typename std::add_lvalue_reference<T>::type reference;
+		typedef T* pointer;
+		typedef std::ptrdiff_t difference_type;
+		typedef std::random_access_iterator_tag iterator_category;
+
+		OffsetPtr() : mOffset(NULL_OFFSET) {}
+		OffsetPtr(std::nullptr_t) : mOffset(NULL_OFFSET) {}
+		OffsetPtr(T* ptr) { set(ptr); }
+		OffsetPtr(const OffsetPtr& other) { set(other.get()); }
+
+		// OffsetPtr<T> to OffsetPtr<const T> / OffsetPtr<void>, like the raw pointers
+		template <typename U, typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+		OffsetPtr(const OffsetPtr<U>& other) { set(other.get()); }
+
+		OffsetPtr& operator=(const OffsetPtr& other) { set(other.get()); return *this; }
+		OffsetPtr& operator=(T* ptr) { set(ptr); return *this; }
+
+		T* get() const {
+			return mOffset == NULL_OFFSET ? nullptr : reinterpret_cast<T*>(reinterpret_cast<intptr_t>(this) + mOffset);
+		}
+
+		T* operator->() const { return get(); }
+		reference operator*() const { return *get(); }
+		reference operator[](difference_type n) const { return get()[n]; }
+		explicit operator bool() const { return mOffset != NULL_OFFSET; }
+
+		OffsetPtr& operator+=(difference_type n) { set(get() + n); return *this; }
+		OffsetPtr& operator-=(difference_type n) { set(get() - n); return *this; }
+		OffsetPtr& operator++() { return *this += 1; }
+		OffsetPtr& operator--() { return *this -= 1; }
+		OffsetPtr operator++(int) { OffsetPtr old(*this); ++*this; return old; }
+		OffsetPtr operator--(int) { OffsetPtr old(*this); --*this; return old; }
+
+		OffsetPtr operator+(difference_type n) const { return OffsetPtr(get() + n); }
+		OffsetPtr operator-(difference_type n) const { return OffsetPtr(get() - n); }
+		difference_type operator-(const OffsetPtr& other) const { return get() - other.get(); }
+
+		bool operator==(const OffsetPtr& other) const { return get() == other.get(); }
+		bool operator!=(const OffsetPtr& other) const { return get() != other.get(); }
+		bool operator<(const OffsetPtr& other) const { return get() < other.get(); }
+		bool operator<=(const OffsetPtr& other) const { return get() <= other.get(); }
+		bool operator>(const OffsetPtr& other) const { return get() > other.get(); }
+		bool operator>=(const OffsetPtr& other) const { return get() >= other.get(); }
+
+		// std::pointer_traits<OffsetPtr>::pointer_to
+		template <typename R = T>
+		static OffsetPtr pointer_to(typename std::enable_if<!std::is_void<R>::value, R>::type& target) { return OffsetPtr(&target); }
+	private:
+		// 0 would point to the OffsetPtr itself, 1 can never be a valid distance for an aligned T
+		static const intptr_t NULL_OFFSET = 1;
+
+		void set(T* ptr) {
+			mOffset = ptr == nullptr ? NULL_OFFSET : reinterpret_cast<intptr_t>(ptr) - reinterpret_cast<intptr_t>(this);
+		}
+
+		intptr_t mOffset;
+	};
+
+	template <typename T>
+	OffsetPtr<T> operator+(std::ptrdiff_t n, const OffsetPtr<T>& ptr) {
+		return ptr + n;
+	}
+
+	template <typename T>
+	const intptr_t OffsetPtr<T>::NULL_OFFSET;
+
+	/**
+	 * Whether a SharedMemoryAllocator creates the segment or attaches to an existing one
+	 */
+	struct SHMMODE {
+		enum ENUM {
+			// fails if a segment with the name exists
+			CREATE,
+			OPEN
+		};
+	};
+
+	// implementation detail, see SharedMemoryAllocator.cpp
+	struct SharedSegmentHeader;
+
+	/**
+	 * Position of an incremental walk over the blocks of a segment, see SharedMemoryAllocator::walk
+	 */
+	struct SharedHeapCursor {
+		SharedHeapCursor() : mOffset(0), mNextFree(0), mGeneration(0) {}
+
+		// next block, 0 before the walk started
+		uint64_t mOffset;
+		uint64_t mNextFree;
+		uint64_t mGeneration;
+	};
+
+	/**
+	 * SharedMemoryAllocator
+	 *
+	 * Allocator on a named POSIX shared memory segment (shm_open + mmap). Every process opening the segment
+	 * allocates from the same heap: a first-fit free list with coalescing, guarded by a process-shared
+	 * robust mutex in the segment. All bookkeeping is stored as offsets, so the segment can be mapped at a
+	 * different address in every process.
+	 *
+	 * Data structures built in the segment must link with OffsetPtr or offsets, the root pointer lets
+	 * other processes find them.
+	 *
+	 * @remark Only available on POSIX systems. The segment outlives the processes until remove() is called.
+	 */
+	class SharedMemoryAllocator {
+	public:
+		/**
+		 * Constructor
+		 *
+		 * @param name - shm_open name, f.e. "/ondraluk"
+		 * @param mode
+		 * @param size - size of the segment when creating, ignored when opening
+		 */
+		SharedMemoryAllocator(const char* name, SHMMODE::ENUM mode, size_t size = 0);
+
+		/**
+		 * Move constructor
+		 * @param
+		 */
+		SharedMemoryAllocator(SharedMemoryAllocator&&);
+
+		/**
+		 * Destructor
+		 *
+		 * Unmaps the segment, the segment and its allocations stay alive
+		 */
+		~SharedMemoryAllocator();
+
+		/**
+		 * @return bool false if creating / opening the segment failed
+		 */
+		bool isOpen() const;
+
+		/**
+		 * allocate
+		 *
+		 * @param size_t size
+		 *
+		 * @return void* 16 byte aligned memory, nullptr if the segment is full
+		 */
+		void* allocate(size_t size);
+
+		/**
+		 * free
+		 *
+		 * @param void* mem Memory allocated by any process from this segment
+		 *
+		 * @return void
+		 */
+		void free(void* mem);
+
+		/**
+		 * @return bool true if mem lies within the mapping of the segment
+		 */
+		bool owns(const void* mem) const;
+
+		/**
+		 * @return uint64_t offset of mem from the start of the segment, valid in every process
+		 */
+		uint64_t offsetOf(const void* mem) const;
+
+		/**
+		 * @return void* the address of the offset in this process, nullptr for offset 0
+		 */
+		void* at(uint64_t offset) const;
+
+		/**
+		 * setRoot
+		 *
+		 * Publishes the entry point of the data in the segment
+		 *
+		 * @param const void* root nullptr to clear
+		 *
+		 * @return void
+		 */
+		void setRoot(const void* root);
+
+		/**
+		 * @return void* the root in this process' mapping, nullptr if none was set
+		 */
+		void* root() const;
+
+		/**
+		 * @return size_t size of the segment
+		 */
+		size_t size() const;
+
+		/**
+		 * @return size_t bytes allocated, including the block headers
+		 */
+		size_t used() const;
+
+		/**
+		 * @return bool true if a process died while changing the free list; allocate returns nullptr and free
+		 *		   does nothing from then on, the data in the segment is still readable
+		 */
+		bool poisoned() const;
+
+		/**
+		 * Called with offset, size and whether the block is allocated
+		 */
+		typedef std::function<void(uint64_t, uint64_t, bool)> BlockVisitor;
+
+		/**
+		 * walk
+		 *
+		 * Visits the next blocks of the segment in address order, starting with the segment header as one used
+		 * block. Every call holds the segment lock only for its own blocks; if any process allocated or freed in
+		 * between the walk starts over. A call with maxBlocks SIZE_MAX walks the whole segment under one lock,
+		 * so it always completes (HeapWalker falls back to that after a few restarts).
+		 *
+		 * @param SharedHeapCursor& cursor - default constructed for a new walk
+		 * @param const BlockVisitor& visitor - runs under the segment lock, visits nothing in a poisoned segment
+		 * @param size_t maxBlocks
+		 * @param[out] bool& restarted - true if the walk started over
+		 *
+		 * @return bool true once the last block was visited
+		 */
+		bool walk(SharedHeapCursor& cursor, const BlockVisitor& visitor, size_t maxBlocks, bool& restarted) const;
+
+		/**
+		 * remove
+		 *
+		 * @param const char* name
+		 *
+		 * Removes the name, the memory is released once every process unmapped it
+		 *
+		 * @return bool
+		 */
+		static bool remove(const char* name);
+	private:
+		/**
+		 * Private copy constructor
+		 * @param
+		 */
+		SharedMemoryAllocator(const SharedMemoryAllocator&);
+
+		/**
+		 * Variables
+		 */
+
+		SharedSegmentHeader* mHeader;
+
+		unsigned char* mBase;
+
+		size_t mSize;
+	};
+
+}
+
+namespace ondraluk {
+
+	/**
+	 * Containers on a segment link their memory with OffsetPtr, see StdAllocator
+	 */
+	template <>
+	struct StdPointer<SharedMemoryAllocator> {
+		template <typename T>
+		struct of {
+			typedef OffsetPtr<T> type;
+
+			static T* address(const type& ptr) { return ptr.get(); }
+		};
+	};
+
+}
+
+#endif
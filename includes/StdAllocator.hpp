@@ -0,0 +1,88 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file StdAllocator.hpp
+ */
+
+#ifndef STDALLOCATOR_HPP
+#define STDALLOCATOR_HPP
+
+#include <cstddef>
+#include <new>
+
+namespace ondraluk {
+
+	/**
+	 * Pointer type of the StdAllocator of a policy, raw pointers unless specialized for the policy
+	 */
+	template <class Alloc>
+	struct StdPointer {
+		template <typename T>
+		struct of {
+			typedef T* type;
+
+			static T* address(type ptr) { return ptr; }
+		};
+	};
+
+	/**
+	 * StdAllocator
+	 *
+	 * Adapts an allocator policy (allocate(size_t) / free(void*)) to the standard allocator interface, so std containers
+	 * can use it. The policy is referenced, not owned, and has to outlive the containers.
+	 *
+	 * For a SharedMemoryAllocator the pointer type is OffsetPtr<T>: a container placed in the segment, f.e. a
+	 * std::vector constructed with new on segment memory and published with setRoot(), can be read in place by
+	 * processes mapping the segment at any address.
+	 *
+	 * @remark Only containers using the pointer type of the allocator for their links qualify (std::vector;
+	 *		   node based containers of libstdc++ keep raw pointers). The container references the allocator by
+	 *		   address, so only the process which built it may change it.
+	 */
+	template <typename T, class Alloc>
+	class StdAllocator {
+	public:
+		typedef T value_type;
+		typedef typename StdPointer<Alloc>::template of<T>::type pointer;
+
+		template <typename U>
+		struct rebind {
+			typedef StdAllocator<U, Alloc> other;
+		};
+
+		explicit StdAllocator(Alloc& allocator) : mAllocator(&allocator) {}
+
+		template <typename U>
+		StdAllocator(const StdAllocator<U, Alloc>& other) : mAllocator(other.allocator()) {}
+
+		pointer allocate(size_t n) {
+			void* mem = mAllocator->allocate(n * sizeof(T));
+
+			if(mem == nullptr) {
+				throw std::bad_alloc();
+			}
+
+			return pointer(static_cast<T*>(mem));
+		}
+
+		void deallocate(pointer mem, size_t) {
+			mAllocator->free(StdPointer<Alloc>::template of<T>::address(mem));
+		}
+
+		Alloc* allocator() const { return mAllocator; }
+
+		template <typename U>
+		bool operator==(const StdAllocator<U, Alloc>& other) const { return mAllocator == other.allocator(); }
+
+		template <typename U>
+		bool operator!=(const StdAllocator<U, Alloc>& other) const { return mAllocator != other.allocator(); }
+	private:
+		Alloc* mAllocator;
+	};
+
+}
+
+#endif
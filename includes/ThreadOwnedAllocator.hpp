@@ -0,0 +1,182 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file ThreadOwnedAllocator.hpp
+ */
+
+#ifndef THREADOWNEDALLOCATOR_HPP
+#define THREADOWNEDALLOCATOR_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "MemoryManager.hpp"
+#include "PageSource.hpp"
+
+namespace ondraluk {
+
+	/**
+	 * ThreadOwnedAllocator
+	 *
+	 * Allocator policy for memory allocated on one thread and freed on others. Every thread gets its own heap with
+	 * size segregated free lists, every block remembers the heap it came from:
+	 * 	-allocate and a free on the owning thread only touch the heap of the calling thread, no lock, no atomic
+	 * 	-a free from any other thread pushes the block onto the lock-free remote free list of the owner
+	 * 	-the owner takes the whole remote list with one exchange on its next allocate and sorts it into its free lists
+	 *
+	 * Heaps of exited threads are abandoned, not destroyed; blocks freed into them are kept and the next thread
+	 * needing a heap adopts one. The mutex is only taken to create or adopt a heap and to map new chunks.
+	 *
+	 * Requests above MAX_SMALL_SIZE go to ::malloc and are not owned by a heap.
+	 * Copies share the heaps, a copy handed to a MemoryManager can still be queried for the statistics.
+	 *
+	 * @remark The allocator has to outlive every thread still freeing into it
+	 */
+	class ThreadOwnedAllocator {
+	public:
+		static const size_t HEADER = 16;
+		static const size_t MIN_SMALL_SIZE = 16;
+		static const size_t MAX_SMALL_SIZE = 32768;
+		// powers of two from MIN_SMALL_SIZE to MAX_SMALL_SIZE
+		static const unsigned int SIZE_CLASSES = 12;
+
+		/**
+		 * Constructor
+		 *
+		 * @param chunkSize - size of the regions the heaps carve their blocks from
+		 * @param backend - preferred PageSource backend of the chunks
+		 */
+		explicit ThreadOwnedAllocator(size_t chunkSize = 256 * 1024, PAGEBACKEND::ENUM backend = PAGEBACKEND::MALLOC);
+
+		/**
+		 * allocate
+		 *
+		 * @param size_t size
+		 *
+		 * @return void* pointer to memory from the heap of the calling thread, nullptr if out of memory
+		 */
+		void* allocate(size_t size);
+
+		/**
+		 * free
+		 *
+		 * @param void* mem - may be freed from any thread
+		 *
+		 * @return void
+		 */
+		void free(void* mem);
+
+		/**
+		 * @return bool true if mem lies in one of the chunks, large blocks are not owned
+		 */
+		bool owns(const void* mem) const;
+
+		/**
+		 * @return size_t number of heaps, used and abandoned
+		 */
+		size_t heapCount() const;
+
+		/**
+		 * @return size_t number of heaps waiting to be adopted
+		 */
+		size_t abandonedHeaps() const;
+
+		/**
+		 * @return size_t number of blocks freed by a thread other than their owner
+		 */
+		size_t remoteFrees() const;
+
+		/**
+		 * @return size_t number of remote frees already taken back by their owners
+		 */
+		size_t drainedFrees() const;
+	private:
+		struct FreeBlock {
+			FreeBlock* mNext;
+		};
+
+		struct ThreadHeap;
+
+		struct BlockHeader {
+			// nullptr for large blocks
+			ThreadHeap* mOwner;
+			uint32_t mSizeClass;
+		};
+
+		struct ThreadHeap {
+			ThreadHeap() : mRemoteFrees(nullptr), mCurrent(nullptr), mEnd(nullptr), mAbandoned(false) {
+				for(unsigned int i = 0; i < SIZE_CLASSES; ++i) {
+					mLocalFrees[i] = nullptr;
+				}
+			}
+
+			// written by every thread freeing into the heap, padded off the line of the owner only fields
+			std::atomic<FreeBlock*> mRemoteFrees;
+			unsigned char mPadding[64];
+
+			FreeBlock* mLocalFrees[SIZE_CLASSES];
+
+			unsigned char* mCurrent;
+			unsigned char* mEnd;
+
+			// guarded by Shared::mLock
+			bool mAbandoned;
+		};
+
+		// state the thread local heap lookup can keep alive after the allocator is gone
+		struct Shared {
+			Shared(size_t chunkSize, PAGEBACKEND::ENUM backend);
+			~Shared();
+
+			const uint64_t mId;
+			const size_t mChunkSize;
+			const PAGEBACKEND::ENUM mBackend;
+
+			mutable std::mutex mLock;
+			std::vector<std::unique_ptr<ThreadHeap> > mHeaps;
+			std::vector<PageRegion> mChunks;
+
+			std::atomic<size_t> mRemoteFreeCount;
+			std::atomic<size_t> mDrainedCount;
+		};
+
+		/**
+		 * @param bool create - create or adopt a heap if the thread has none yet
+		 *
+		 * @return ThreadHeap* heap of the calling thread, nullptr if it has none
+		 */
+		ThreadHeap* threadHeap(bool create);
+
+		void drainRemoteFrees(ThreadHeap& heap);
+
+		bool refill(ThreadHeap& heap, size_t blockSize);
+
+		static unsigned int sizeClass(size_t size);
+
+		static BlockHeader* header(void* mem) {
+			return reinterpret_cast<BlockHeader*>(static_cast<unsigned char*>(mem) - HEADER);
+		}
+
+		/**
+		 * Variables
+		 */
+
+		std::shared_ptr<Shared> mShared;
+	};
+
+	/**
+	 * MemoryManager front end for memory crossing threads between allocate and free
+	 */
+	template <class BoundsChecker = NoBoundsCheckingPolicy, class Tracker = NoTrackingPolicy>
+	using ThreadOwnedMemoryManager = MemoryManager<ThreadOwnedAllocator, BoundsChecker, Tracker>;
+
+}
+
+#endif
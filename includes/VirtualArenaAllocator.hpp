@@ -0,0 +1,172 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file VirtualArenaAllocator.hpp
+ */
+
+#ifndef VIRTUALARENAALLOCATOR_HPP
+#define VIRTUALARENAALLOCATOR_HPP
+
+#include <cstdlib>
+
+namespace ondraluk {
+
+	/**
+	 * How memory above the retain mark is given back on reset
+	 */
+	struct DECOMMIT {
+		enum ENUM {
+			// pages are dropped immediately and protected again, the next touch faults in zeroed pages
+			DONTNEED,
+			// pages stay accessible and are only reclaimed by the kernel under memory pressure, cheaper to reuse
+			FREE
+		};
+	};
+
+	/**
+	 * Tuning knobs of the VirtualArenaAllocator
+	 */
+	struct VirtualArenaConfig {
+		VirtualArenaConfig() : mReserveSize(static_cast<size_t>(64) << 30), mCommitSize(64 << 10), mRetainSize(1 << 20), mDecommit(DECOMMIT::DONTNEED) {}
+
+		// address range reserved up front, the arena can never grow beyond it
+		size_t mReserveSize;
+		// pages are committed in steps of at least this many bytes
+		size_t mCommitSize;
+		// high-water mark: committed memory up to here is kept on reset, everything above is decommitted
+		size_t mRetainSize;
+		DECOMMIT::ENUM mDecommit;
+	};
+
+	/**
+	 * VirtualArenaAllocator
+	 *
+	 * Linear allocator on a large reserved (PROT_NONE) address range. Pages are committed as the bump pointer
+	 * advances, so the arena grows in place without moving or chaining chunks and pointers stay stable.
+	 * reset() rewinds the arena and returns the memory above the retain mark to the OS after load spikes.
+	 *
+	 * @remark Only available on POSIX systems
+	 */
+	class VirtualArenaAllocator {
+	public:
+		/**
+		 * Constructor
+		 *
+		 * Reserves the address range, nothing is committed yet
+		 *
+		 * @param config
+		 */
+		explicit VirtualArenaAllocator(const VirtualArenaConfig& config = VirtualArenaConfig());
+
+		/**
+		 * Move constructor
+		 * @param
+		 */
+		VirtualArenaAllocator(VirtualArenaAllocator&&);
+
+		/**
+		 * Destructor
+		 *
+		 * Releases the whole range
+		 */
+		~VirtualArenaAllocator();
+
+		/**
+		 * allocate
+		 *
+		 * @param size_t size
+		 *
+		 * Returns the next free size-bytes memory, committing pages if necessary
+		 *
+		 * @return void* pointer to memory, nullptr if the reservation is exhausted or committing failed
+		 */
+		void* allocate(size_t size);
+
+		/**
+		 * free
+		 *
+		 * @param void* mem
+		 *
+		 * Rewinds the bump pointer to the given address, like the LinearAllocator. Nothing is decommitted.
+		 *
+		 * @return void
+		 */
+		void free(void* mem);
+
+		/**
+		 * owns
+		 *
+		 * @param const void* mem
+		 *
+		 * @return bool true if mem lies within the reserved range of this allocator
+		 */
+		bool owns(const void* mem) const;
+
+		/**
+		 * reset
+		 *
+		 * Rewinds the whole arena and decommits everything above the retain mark
+		 *
+		 * @return void
+		 */
+		void reset();
+
+		/**
+		 * @return size_t bytes currently handed out
+		 */
+		size_t used() const;
+
+		/**
+		 * @return size_t bytes currently committed
+		 */
+		size_t committed() const;
+
+		/**
+		 * @return size_t size of the reserved range, 0 if the reservation failed
+		 */
+		size_t reserved() const;
+
+		/**
+		 * @return size_t the largest used() seen since construction
+		 */
+		size_t peak() const;
+	private:
+		/**
+		 * Private copy constructor
+		 * @param
+		 */
+		VirtualArenaAllocator(const VirtualArenaAllocator&);
+
+		/**
+		 * commit
+		 *
+		 * @param unsigned char* end Address which has to be accessible afterwards
+		 *
+		 * @return bool false if the range could not be committed
+		 */
+		bool commit(unsigned char* end);
+
+		/**
+		 * Variables
+		 */
+
+		VirtualArenaConfig mConfig;
+
+		unsigned char* mMem;
+
+		unsigned char* mCurrent;
+
+		// end of the committed (read/write) part
+		unsigned char* mCommitted;
+
+		unsigned char* mEnd;
+
+		size_t mPeak;
+	};
+
+}
+
+#endif
@@ -0,0 +1,219 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file AllocationTrace.cpp
+ */
+
+#include "../includes/AllocationTrace.hpp"
+
+#include <cstring>
+
+using namespace ondraluk;
+
+namespace {
+	const char MAGIC[4] = { 'O', 'T', 'R', 'C' };
+	const uint32_t VERSION = 1;
+	const size_t FILE_BUFFER_SIZE = 1 << 20;
+}
+
+AllocationTraceWriter::AllocationTraceWriter(const char* fname) : mFile(std::fopen(fname, "wb")), mStart(Clock::now()), mLastTimestamp(0), mNextId(1) {
+	if(mFile != nullptr) {
+		std::setvbuf(mFile, nullptr, _IOFBF, FILE_BUFFER_SIZE);
+
+		unsigned char version[4] = {
+			static_cast<unsigned char>(VERSION), static_cast<unsigned char>(VERSION >> 8),
+			static_cast<unsigned char>(VERSION >> 16), static_cast<unsigned char>(VERSION >> 24)
+		};
+
+		std::fwrite(MAGIC, 1, sizeof(MAGIC), mFile);
+		std::fwrite(version, 1, sizeof(version), mFile);
+	}
+}
+
+AllocationTraceWriter::~AllocationTraceWriter() {
+	if(mFile != nullptr) {
+		std::fclose(mFile);
+	}
+}
+
+bool AllocationTraceWriter::isOpen() const {
+	return mFile != nullptr;
+}
+
+void AllocationTraceWriter::allocate(const void* addr, size_t size, size_t alignment) {
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	if(mFile == nullptr) {
+		return;
+	}
+
+	uint64_t id = mNextId++;
+	mLiveIds[addr] = id;
+
+	uint64_t log2Alignment = 0;
+	while((static_cast<size_t>(2) << log2Alignment) <= alignment) {
+		++log2Alignment;
+	}
+
+	uint64_t timestampDelta;
+	uint32_t thread;
+	writeHeader(AllocationEvent::ALLOCATE, timestampDelta, thread);
+
+	writeVarint(timestampDelta);
+	writeVarint(thread);
+	writeVarint(id);
+	writeVarint(size);
+	writeVarint(log2Alignment);
+}
+
+void AllocationTraceWriter::free(const void* addr) {
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	if(mFile == nullptr) {
+		return;
+	}
+
+	std::unordered_map<const void*, uint64_t>::iterator it = mLiveIds.find(addr);
+
+	if(it == mLiveIds.end()) {
+		return;
+	}
+
+	uint64_t id = it->second;
+	mLiveIds.erase(it);
+
+	uint64_t timestampDelta;
+	uint32_t thread;
+	writeHeader(AllocationEvent::FREE, timestampDelta, thread);
+
+	writeVarint(timestampDelta);
+	writeVarint(thread);
+	writeVarint(id);
+}
+
+void AllocationTraceWriter::writeHeader(char type, uint64_t& timestampDelta, uint32_t& thread) {
+	uint64_t timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - mStart).count());
+
+	// the mutex orders the events, the clock is monotonic
+	timestampDelta = timestamp - mLastTimestamp;
+	mLastTimestamp = timestamp;
+
+	std::unordered_map<std::thread::id, uint32_t>::iterator it = mThreads.find(std::this_thread::get_id());
+
+	if(it == mThreads.end()) {
+		thread = static_cast<uint32_t>(mThreads.size());
+		mThreads[std::this_thread::get_id()] = thread;
+	} else {
+		thread = it->second;
+	}
+
+	std::fputc(type, mFile);
+}
+
+void AllocationTraceWriter::writeVarint(uint64_t value) {
+	unsigned char bytes[10];
+	size_t count = 0;
+
+	do {
+		unsigned char byte = value & 0x7F;
+		value >>= 7;
+
+		if(value != 0) {
+			byte |= 0x80;
+		}
+
+		bytes[count++] = byte;
+	} while(value != 0);
+
+	std::fwrite(bytes, 1, count, mFile);
+}
+
+AllocationTraceReader::AllocationTraceReader(const char* fname) : mFile(std::fopen(fname, "rb")), mTimestamp(0) {
+	if(mFile != nullptr) {
+		std::setvbuf(mFile, nullptr, _IOFBF, FILE_BUFFER_SIZE);
+
+		char magic[4];
+		unsigned char version[4];
+
+		bool valid = std::fread(magic, 1, sizeof(magic), mFile) == sizeof(magic) && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0 &&
+					 std::fread(version, 1, sizeof(version), mFile) == sizeof(version) &&
+					 (version[0] | version[1] << 8 | version[2] << 16 | static_cast<uint32_t>(version[3]) << 24) == VERSION;
+
+		if(!valid) {
+			std::fclose(mFile);
+			mFile = nullptr;
+		}
+	}
+}
+
+AllocationTraceReader::~AllocationTraceReader() {
+	if(mFile != nullptr) {
+		std::fclose(mFile);
+	}
+}
+
+bool AllocationTraceReader::isOpen() const {
+	return mFile != nullptr;
+}
+
+bool AllocationTraceReader::next(AllocationEvent& event) {
+	if(mFile == nullptr) {
+		return false;
+	}
+
+	int type = std::fgetc(mFile);
+
+	if(type != AllocationEvent::ALLOCATE && type != AllocationEvent::FREE) {
+		return false;
+	}
+
+	uint64_t timestampDelta;
+	uint64_t thread;
+
+	if(!readVarint(timestampDelta) || !readVarint(thread) || !readVarint(event.mId)) {
+		return false;
+	}
+
+	mTimestamp += timestampDelta;
+
+	event.mType = static_cast<AllocationEvent::TYPE>(type);
+	event.mTimestamp = mTimestamp;
+	event.mThread = static_cast<uint32_t>(thread);
+	event.mSize = 0;
+	event.mAlignment = 0;
+
+	if(type == AllocationEvent::ALLOCATE) {
+		uint64_t log2Alignment;
+
+		if(!readVarint(event.mSize) || !readVarint(log2Alignment) || log2Alignment >= 64) {
+			return false;
+		}
+
+		event.mAlignment = static_cast<uint64_t>(1) << log2Alignment;
+	}
+
+	return true;
+}
+
+bool AllocationTraceReader::readVarint(uint64_t& value) {
+	value = 0;
+
+	for(unsigned int shift = 0; shift < 64; shift += 7) {
+		int byte = std::fgetc(mFile);
+
+		if(byte == EOF) {
+			return false;
+		}
+
+		value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+		if((byte & 0x80) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
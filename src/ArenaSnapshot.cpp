@@ -0,0 +1,218 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file ArenaSnapshot.cpp
+ */
+
+#include "../includes/ArenaSnapshot.hpp"
+#include "../includes/PageSource.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ondraluk;
+
+namespace {
+
+	const char MAGIC[4] = { 'O', 'S', 'N', 'P' };
+	const uint32_t VERSION = 1;
+	const uint64_t NO_ROOT = ~static_cast<uint64_t>(0);
+
+	/**
+	 * First page of the file; the region starts at mRegionOffset, the relocation table
+	 * (one uint64_t offset per pointer) follows the region
+	 */
+	struct SnapshotHeader {
+		char mMagic[4];
+		uint32_t mVersion;
+		uint64_t mBase;
+		uint64_t mSize;
+		uint64_t mRoot;
+		uint64_t mRegionOffset;
+		uint64_t mRelocationCount;
+	};
+
+	bool inRegion(uintptr_t address, uintptr_t base, uint64_t size) {
+		return address >= base && address - base <= size;
+	}
+
+	bool readAt(int fd, void* dest, size_t size, uint64_t offset) {
+		return pread(fd, dest, size, static_cast<off_t>(offset)) == static_cast<ssize_t>(size);
+	}
+
+	/**
+	 * The header of a truncated or corrupt file must not make the loader allocate or map more than the file
+	 * holds, mapping past its end raises SIGBUS on the first access
+	 */
+	bool fitsFile(int fd, const SnapshotHeader& header) {
+		struct stat status;
+
+		if(fstat(fd, &status) != 0 || status.st_size < 0) {
+			return false;
+		}
+
+		uint64_t fileSize = static_cast<uint64_t>(status.st_size);
+
+		// written without sums, they could overflow
+		return header.mRegionOffset >= sizeof(SnapshotHeader) &&
+			   header.mRegionOffset <= fileSize &&
+			   header.mSize <= fileSize - header.mRegionOffset &&
+			   header.mRelocationCount <= (fileSize - header.mRegionOffset - header.mSize) / sizeof(uint64_t);
+	}
+}
+
+bool ArenaSnapshot::save(const char* fname, const LinearAllocator& arena, const void* root, const RelocationTable& relocations) {
+	uintptr_t base = reinterpret_cast<uintptr_t>(arena.data());
+	uint64_t size = arena.used();
+
+	if(base == 0 || size == 0 || (root != nullptr && !inRegion(reinterpret_cast<uintptr_t>(root), base, size - 1))) {
+		return false;
+	}
+
+	std::vector<uint64_t> offsets;
+	offsets.reserve(relocations.size());
+
+	for(size_t i = 0; i < relocations.size(); ++i) {
+		uintptr_t field = reinterpret_cast<uintptr_t>(relocations.fields()[i]);
+		uintptr_t value;
+
+		if(size < sizeof(void*) || !inRegion(field, base, size - sizeof(void*))) {
+			return false;
+		}
+
+		std::memcpy(&value, relocations.fields()[i], sizeof(value));
+
+		// pointers out of the arena can not be relocated, one past the end is fine
+		if(value != 0 && !inRegion(value, base, size)) {
+			return false;
+		}
+
+		offsets.push_back(field - base);
+	}
+
+	SnapshotHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.mMagic, MAGIC, sizeof(MAGIC));
+	header.mVersion = VERSION;
+	header.mBase = base;
+	header.mSize = size;
+	header.mRoot = root != nullptr ? reinterpret_cast<uintptr_t>(root) - base : NO_ROOT;
+	header.mRegionOffset = PageSource::pageSize();
+	header.mRelocationCount = offsets.size();
+
+	std::FILE* file = std::fopen(fname, "wb");
+
+	if(file == nullptr) {
+		return false;
+	}
+
+	std::vector<unsigned char> page(static_cast<size_t>(header.mRegionOffset), 0);
+	std::memcpy(page.data(), &header, sizeof(header));
+
+	bool written = std::fwrite(page.data(), 1, page.size(), file) == page.size() &&
+				   std::fwrite(arena.data(), 1, static_cast<size_t>(size), file) == size &&
+				   (offsets.empty() || std::fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file) == offsets.size());
+
+	return std::fclose(file) == 0 && written;
+}
+
+ArenaSnapshot::ArenaSnapshot(const char* fname) : mRegion(nullptr), mSize(0), mRoot(nullptr), mRelocated(false) {
+	int fd = open(fname, O_RDONLY);
+
+	if(fd < 0) {
+		return;
+	}
+
+	SnapshotHeader header;
+	std::vector<uint64_t> offsets;
+
+	bool valid = readAt(fd, &header, sizeof(header), 0) &&
+				 std::memcmp(header.mMagic, MAGIC, sizeof(MAGIC)) == 0 &&
+				 header.mVersion == VERSION &&
+				 header.mSize > 0 &&
+				 header.mRegionOffset % PageSource::pageSize() == 0 &&
+				 fitsFile(fd, header);
+
+	if(valid) {
+		offsets.resize(static_cast<size_t>(header.mRelocationCount));
+		valid = offsets.empty() || readAt(fd, offsets.data(), offsets.size() * sizeof(uint64_t), header.mRegionOffset + header.mSize);
+	}
+
+	void* mem = MAP_FAILED;
+
+	if(valid) {
+		// try the original address first, a hint only, never replaces an existing mapping
+		mem = mmap(reinterpret_cast<void*>(static_cast<uintptr_t>(header.mBase)), static_cast<size_t>(header.mSize), PROT_READ | PROT_WRITE,
+				   MAP_PRIVATE, fd, static_cast<off_t>(header.mRegionOffset));
+	}
+
+	close(fd);
+
+	if(mem == MAP_FAILED) {
+		return;
+	}
+
+	unsigned char* region = static_cast<unsigned char*>(mem);
+	uintptr_t oldBase = static_cast<uintptr_t>(header.mBase);
+	uintptr_t newBase = reinterpret_cast<uintptr_t>(region);
+
+	if(newBase != oldBase) {
+		for(size_t i = 0; i < offsets.size(); ++i) {
+			uintptr_t value;
+
+			if(header.mSize < sizeof(value) || offsets[i] > header.mSize - sizeof(value)) {
+				munmap(mem, static_cast<size_t>(header.mSize));
+				return;
+			}
+
+			std::memcpy(&value, region + offsets[i], sizeof(value));
+
+			if(value != 0) {
+				value = value - oldBase + newBase;
+				std::memcpy(region + offsets[i], &value, sizeof(value));
+			}
+		}
+
+		mRelocated = true;
+	}
+
+	mRegion = region;
+	mSize = static_cast<size_t>(header.mSize);
+	mRoot = header.mRoot < header.mSize ? region + header.mRoot : nullptr;
+}
+
+ArenaSnapshot::ArenaSnapshot(ArenaSnapshot&& other) : mRegion(other.mRegion), mSize(other.mSize), mRoot(other.mRoot), mRelocated(other.mRelocated) {
+	other.mRegion = nullptr;
+	other.mSize = 0;
+	other.mRoot = nullptr;
+}
+
+ArenaSnapshot::~ArenaSnapshot() {
+	if(mRegion != nullptr) {
+		munmap(mRegion, mSize);
+	}
+}
+
+bool ArenaSnapshot::isOpen() const {
+	return mRegion != nullptr;
+}
+
+void* ArenaSnapshot::data() const {
+	return mRegion;
+}
+
+size_t ArenaSnapshot::size() const {
+	return mSize;
+}
+
+bool ArenaSnapshot::relocated() const {
+	return mRelocated;
+}
@@ -0,0 +1,267 @@
+/**
+ *  This file is part of the debuglib project
+ *  Copyright by Christian Ondracek
+ *  Contact: coder[at]paxi.at
+ */
+
+#include "../includes/BufferedFileOutputter.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace debuglib
+{
+	namespace logger
+	{
+		/**
+		 * Owns the file descriptor, the buffer and the background worker of a BufferedFileOutputter.
+		 */
+		class BufferedFile {
+		public:
+			BufferedFile(const char* fname, const BufferedFileOutputterConfig& config);
+			~BufferedFile();
+
+			void write(const char* msg, size_t len);
+			void flush();
+
+		private:
+			BufferedFile(const BufferedFile&);
+			BufferedFile& operator=(const BufferedFile&);
+
+			typedef std::chrono::steady_clock Clock;
+
+			void open();
+			void flushLocked();
+			void writeLocked(const char* first, size_t firstLen, const char* second, size_t secondLen);
+			bool rotationDueLocked(size_t incoming) const;
+			void rotateLocked();
+			void workerLoop();
+
+			std::string mFileName;
+			BufferedFileOutputterConfig mConfig;
+
+			int mFd;
+			char* mBuffer;
+			size_t mUsed;
+			size_t mFileSize;
+			unsigned int mRotation;
+			Clock::time_point mOpenedAt;
+
+			std::mutex mMutex;
+			std::condition_variable mWake;
+			std::deque<std::string> mRotatedFiles;
+			bool mStop;
+			std::thread mWorker;
+		};
+
+		BufferedFile::BufferedFile(const char* fname, const BufferedFileOutputterConfig& config) :
+			mFileName(fname), mConfig(config), mFd(-1), mBuffer(nullptr), mUsed(0), mFileSize(0), mRotation(0), mStop(false) {
+
+			if(mConfig.mBufferSize == 0) {
+				mConfig.mBufferSize = 1;
+			}
+
+			mBuffer = static_cast<char*>(::malloc(mConfig.mBufferSize));
+			open();
+
+			// the worker is only needed for periodic flushes and compression
+			if(mConfig.mFlushIntervalMs > 0 || mConfig.mCompressionHook) {
+				mWorker = std::thread(&BufferedFile::workerLoop, this);
+			}
+		}
+
+		BufferedFile::~BufferedFile() {
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mStop = true;
+			}
+			mWake.notify_one();
+
+			if(mWorker.joinable()) {
+				mWorker.join();
+			}
+
+			flushLocked();
+
+			if(mFd >= 0) {
+				::close(mFd);
+			}
+
+			::free(mBuffer);
+		}
+
+		void BufferedFile::open() {
+			mFd = ::open(mFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+			mFileSize = 0;
+			mOpenedAt = Clock::now();
+		}
+
+		void BufferedFile::write(const char* msg, size_t len) {
+			std::lock_guard<std::mutex> lock(mMutex);
+
+			if(rotationDueLocked(len)) {
+				flushLocked();
+				rotateLocked();
+			}
+
+			if(mUsed + len <= mConfig.mBufferSize) {
+				memcpy(mBuffer + mUsed, msg, len);
+				mUsed += len;
+				return;
+			}
+
+			// buffer and message are handed to the kernel with a single writev
+			writeLocked(mBuffer, mUsed, msg, len);
+			mUsed = 0;
+		}
+
+		void BufferedFile::flush() {
+			std::lock_guard<std::mutex> lock(mMutex);
+			flushLocked();
+		}
+
+		void BufferedFile::flushLocked() {
+			if(mUsed > 0) {
+				writeLocked(mBuffer, mUsed, nullptr, 0);
+				mUsed = 0;
+			}
+		}
+
+		void BufferedFile::writeLocked(const char* first, size_t firstLen, const char* second, size_t secondLen) {
+			mFileSize += firstLen + secondLen;
+
+			if(mFd < 0) {
+				return;
+			}
+
+			iovec iov[2];
+			iov[0].iov_base = const_cast<char*>(first);
+			iov[0].iov_len = firstLen;
+			iov[1].iov_base = const_cast<char*>(second);
+			iov[1].iov_len = secondLen;
+
+			iovec* current = iov;
+			int count = secondLen > 0 ? 2 : 1;
+
+			while(count > 0) {
+				ssize_t written = ::writev(mFd, current, count);
+
+				if(written < 0) {
+					if(errno == EINTR) {
+						continue;
+					}
+					// nothing sensible left to do; the data is dropped
+					return;
+				}
+
+				// skip the fully written vectors and advance into a partially written one
+				size_t remaining = static_cast<size_t>(written);
+				while(count > 0 && remaining >= current->iov_len) {
+					remaining -= current->iov_len;
+					++current;
+					--count;
+				}
+
+				if(count > 0) {
+					current->iov_base = static_cast<char*>(current->iov_base) + remaining;
+					current->iov_len -= remaining;
+				}
+			}
+		}
+
+		bool BufferedFile::rotationDueLocked(size_t incoming) const {
+			size_t pending = mFileSize + mUsed;
+
+			if(mConfig.mRotateSize > 0 && pending > 0 && pending + incoming > mConfig.mRotateSize) {
+				return true;
+			}
+
+			if(mConfig.mRotateIntervalSec > 0 && Clock::now() - mOpenedAt >= std::chrono::seconds(mConfig.mRotateIntervalSec)) {
+				return true;
+			}
+
+			return false;
+		}
+
+		void BufferedFile::rotateLocked() {
+			if(mFd >= 0) {
+				::close(mFd);
+			}
+
+			char suffix[16];
+			snprintf(suffix, sizeof(suffix), ".%u", ++mRotation);
+
+			std::string rotated = mFileName + suffix;
+			::rename(mFileName.c_str(), rotated.c_str());
+
+			open();
+
+			if(mConfig.mCompressionHook) {
+				mRotatedFiles.push_back(rotated);
+				mWake.notify_one();
+			}
+		}
+
+		void BufferedFile::workerLoop() {
+			std::unique_lock<std::mutex> lock(mMutex);
+
+			while(true) {
+				if(mRotatedFiles.empty() && !mStop) {
+					if(mConfig.mFlushIntervalMs > 0) {
+						mWake.wait_for(lock, std::chrono::milliseconds(mConfig.mFlushIntervalMs));
+					} else {
+						mWake.wait(lock);
+					}
+				}
+
+				if(mConfig.mFlushIntervalMs > 0) {
+					flushLocked();
+				}
+
+				// the hook may take long, run it without blocking the writers
+				while(!mRotatedFiles.empty()) {
+					std::string rotated;
+					rotated.swap(mRotatedFiles.front());
+					mRotatedFiles.pop_front();
+
+					lock.unlock();
+					mConfig.mCompressionHook(rotated.c_str());
+					lock.lock();
+				}
+
+				if(mStop) {
+					return;
+				}
+			}
+		}
+
+		BufferedFileOutputter::BufferedFileOutputter(const char* fname, const BufferedFileOutputterConfig& config) :
+			mFile(std::make_shared<BufferedFile>(fname, config)) {
+
+		}
+
+		void BufferedFileOutputter::out(const char* msg) const {
+			if(mFile) {
+				mFile->write(msg, strlen(msg));
+			}
+		}
+
+		void BufferedFileOutputter::flush() const {
+			if(mFile) {
+				mFile->flush();
+			}
+		}
+	}
+}
@@ -0,0 +1,217 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file HeapWalker.cpp
+ */
+
+#include "../includes/HeapWalker.hpp"
+#include "../includes/LinearAllocator.hpp"
+
+#ifndef _WIN32
+#include "../includes/VirtualArenaAllocator.hpp"
+#endif
+
+#include <algorithm>
+
+using namespace ondraluk;
+
+const unsigned int FragmentationReport::BUCKETS;
+
+FragmentationReport::FragmentationReport() {
+	clear();
+}
+
+void FragmentationReport::add(const HeapBlock& block) {
+	if(block.mUsed) {
+		mUsedBytes += block.mSize;
+		++mUsedBlocks;
+		return;
+	}
+
+	mFreeBytes += block.mSize;
+	++mFreeBlocks;
+	mLargestFree = std::max(mLargestFree, block.mSize);
+
+	unsigned int bucket = 0;
+	for(size_t size = block.mSize; size > 1; size >>= 1) {
+		++bucket;
+	}
+
+	++mFreeHistogram[bucket];
+}
+
+void FragmentationReport::clear() {
+	mUsedBytes = 0;
+	mFreeBytes = 0;
+	mUsedBlocks = 0;
+	mFreeBlocks = 0;
+	mLargestFree = 0;
+	std::fill(mFreeHistogram, mFreeHistogram + BUCKETS, 0);
+}
+
+double FragmentationReport::externalFragmentation() const {
+	return mFreeBytes > 0 ? 1.0 - static_cast<double>(mLargestFree) / static_cast<double>(mFreeBytes) : 0.0;
+}
+
+void FragmentationReport::write(std::ostream& out) const {
+	out << "used " << mUsedBytes << " in " << mUsedBlocks << " blocks, free " << mFreeBytes << " in " << mFreeBlocks
+		<< " blocks, largest free " << mLargestFree << ", external fragmentation " << externalFragmentation() << "\n";
+
+	for(unsigned int i = 0; i < BUCKETS; ++i) {
+		if(mFreeHistogram[i] > 0) {
+			out << "  free >= " << (static_cast<size_t>(1) << i) << ": " << mFreeHistogram[i] << "\n";
+		}
+	}
+}
+
+HeapMap::HeapMap(size_t heapSize, size_t cells) : mHeapSize(heapSize), mCellSize(1) {
+	if(heapSize > 0 && cells > 0) {
+		mCellSize = (heapSize + cells - 1) / cells;
+		mCells.assign((heapSize + mCellSize - 1) / mCellSize, 0);
+	}
+}
+
+void HeapMap::add(const HeapBlock& block) {
+	if(!block.mUsed) {
+		return;
+	}
+
+	size_t end = std::min(block.mOffset + block.mSize, mHeapSize);
+
+	for(size_t offset = block.mOffset; offset < end; ) {
+		size_t cell = offset / mCellSize;
+		size_t cellEnd = std::min((cell + 1) * mCellSize, end);
+
+		mCells[cell] += cellEnd - offset;
+		offset = cellEnd;
+	}
+}
+
+void HeapMap::clear() {
+	std::fill(mCells.begin(), mCells.end(), 0);
+}
+
+std::string HeapMap::str() const {
+	std::string map;
+
+	for(size_t i = 0; i < mCells.size(); ++i) {
+		// the last cell may be cut off by the end of the heap
+		size_t cellSize = std::min(mCellSize, mHeapSize - i * mCellSize);
+
+		if(mCells[i] == 0) {
+			map += '.';
+		} else if(mCells[i] >= cellSize) {
+			map += '#';
+		} else {
+			map += static_cast<char>('0' + std::min<size_t>(std::max<size_t>(mCells[i] * 10 / cellSize, 1), 9));
+		}
+	}
+
+	return map;
+}
+
+void HeapMap::writeJson(std::ostream& out) const {
+	out << "{\"heapSize\": " << mHeapSize << ", \"cellSize\": " << mCellSize << ", \"used\": [";
+
+	for(size_t i = 0; i < mCells.size(); ++i) {
+		out << (i > 0 ? ", " : "") << mCells[i];
+	}
+
+	out << "]}";
+}
+
+size_t HeapLayout<LinearAllocator>::size(const LinearAllocator& allocator) {
+	return allocator.size();
+}
+
+WALKSTEP::ENUM HeapLayout<LinearAllocator>::step(const LinearAllocator& allocator, State& state, std::vector<HeapBlock>& blocks, size_t) {
+	if(!state.mDone) {
+		blocks.push_back(HeapBlock(0, allocator.used(), true));
+		blocks.push_back(HeapBlock(allocator.used(), allocator.size() - allocator.used(), false));
+		state.mDone = true;
+	}
+
+	return WALKSTEP::DONE;
+}
+
+size_t HeapLayout<PoolAllocator>::size(const PoolAllocator& allocator) {
+	return allocator.blockSize() * allocator.blockCount();
+}
+
+WALKSTEP::ENUM HeapLayout<PoolAllocator>::step(const PoolAllocator& allocator, State& state, std::vector<HeapBlock>& blocks, size_t budget) {
+	if(state.mDone) {
+		return WALKSTEP::DONE;
+	}
+
+	budget = std::max<size_t>(budget, 1);
+
+	if(!state.mMarked) {
+		bool restarted = state.mCursor.mStarted && state.mCursor.mGeneration != allocator.generation();
+
+		state.mMarked = allocator.markFree(state.mUsed, state.mCursor, budget);
+
+		return restarted ? WALKSTEP::RESTARTED : WALKSTEP::MORE;
+	}
+
+	// runs of slots in the same state, the state of the marked snapshot
+	size_t blockSize = allocator.blockSize();
+	size_t end = std::min(state.mSlot + budget, state.mUsed.size());
+
+	while(state.mSlot < end) {
+		size_t begin = state.mSlot;
+		bool used = state.mUsed[begin];
+
+		while(state.mSlot < end && state.mUsed[state.mSlot] == used) {
+			++state.mSlot;
+		}
+
+		blocks.push_back(HeapBlock(begin * blockSize, (state.mSlot - begin) * blockSize, used));
+	}
+
+	if(state.mSlot < state.mUsed.size()) {
+		return WALKSTEP::MORE;
+	}
+
+	blocks.push_back(HeapBlock(state.mUsed.size() * blockSize, (allocator.blockCount() - state.mUsed.size()) * blockSize, false));
+	state.mDone = true;
+
+	return WALKSTEP::DONE;
+}
+
+#ifndef _WIN32
+
+size_t HeapLayout<VirtualArenaAllocator>::size(const VirtualArenaAllocator& allocator) {
+	return allocator.committed();
+}
+
+WALKSTEP::ENUM HeapLayout<VirtualArenaAllocator>::step(const VirtualArenaAllocator& allocator, State& state, std::vector<HeapBlock>& blocks, size_t) {
+	if(!state.mDone) {
+		blocks.push_back(HeapBlock(0, allocator.used(), true));
+		blocks.push_back(HeapBlock(allocator.used(), allocator.committed() - allocator.used(), false));
+		state.mDone = true;
+	}
+
+	return WALKSTEP::DONE;
+}
+
+size_t HeapLayout<SharedMemoryAllocator>::size(const SharedMemoryAllocator& allocator) {
+	return allocator.size();
+}
+
+WALKSTEP::ENUM HeapLayout<SharedMemoryAllocator>::step(const SharedMemoryAllocator& allocator, State& state, std::vector<HeapBlock>& blocks, size_t budget) {
+	bool restarted;
+	bool done = allocator.walk(state, [&blocks](uint64_t offset, uint64_t size, bool used) {
+		blocks.push_back(HeapBlock(static_cast<size_t>(offset), static_cast<size_t>(size), used));
+	}, std::max<size_t>(budget, 1), restarted);
+
+	if(restarted) {
+		return done ? WALKSTEP::RESTARTED_DONE : WALKSTEP::RESTARTED;
+	}
+
+	return done ? WALKSTEP::DONE : WALKSTEP::MORE;
+}
+
+#endif
@@ -0,0 +1,401 @@
+/**
+ *  This file is part of the debuglib project
+ *  Copyright by Christian Ondracek
+ *  Contact: coder[at]paxi.at
+ */
+
+#include "../includes/Instrumentation.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace debuglib
+{
+	namespace instrument
+	{
+		const unsigned int LatencyHistogram::SUB_BITS;
+		const unsigned int LatencyHistogram::SUB_BUCKETS;
+		const unsigned int LatencyHistogram::MAX_BITS;
+		const unsigned int LatencyHistogram::BUCKETS;
+
+		namespace {
+
+			struct TraceEvent {
+				std::atomic<uint64_t> mStart;
+				std::atomic<uint64_t> mEnd;
+				std::atomic<unsigned int> mProbe;
+			};
+
+			/**
+			 * Histograms and trace events of one thread; kept after the thread exits and adopted by the next new thread
+			 */
+			struct ThreadProfile {
+				explicit ThreadProfile(unsigned int thread) : mThread(thread), mEvents(nullptr), mCapacity(0), mWritten(0), mInUse(true) {
+					for(unsigned int i = 0; i < MAX_PROBES; ++i) {
+						mHistograms[i].store(nullptr);
+					}
+				}
+
+				~ThreadProfile() {
+					for(unsigned int i = 0; i < MAX_PROBES; ++i) {
+						delete mHistograms[i].load();
+					}
+					delete[] mEvents.load();
+				}
+
+				void trace(unsigned int probe, uint64_t start, uint64_t end, size_t capacity) {
+					TraceEvent* events = mEvents.load(std::memory_order_relaxed);
+
+					if(events == nullptr) {
+						// the capacity is fixed once the buffer is published
+						mCapacity = capacity > 0 ? capacity : 1;
+						events = new TraceEvent[mCapacity];
+						mEvents.store(events, std::memory_order_release);
+					}
+
+					uint64_t written = mWritten.load(std::memory_order_relaxed);
+					TraceEvent& event = events[written % mCapacity];
+
+					event.mStart.store(start, std::memory_order_relaxed);
+					event.mEnd.store(end, std::memory_order_relaxed);
+					event.mProbe.store(probe, std::memory_order_relaxed);
+
+					mWritten.store(written + 1, std::memory_order_release);
+				}
+
+				const unsigned int mThread;
+
+				std::atomic<LatencyHistogram*> mHistograms[MAX_PROBES];
+
+				std::atomic<TraceEvent*> mEvents;
+				size_t mCapacity;
+				std::atomic<uint64_t> mWritten;
+
+				// guarded by Registry::mLock
+				bool mInUse;
+			};
+
+			struct Registry {
+				Registry() : mTracing(false), mEventsPerThread(1 << 16), mEpoch(debuglib::clock::ticks()) {}
+
+				std::mutex mLock;
+				std::vector<std::string> mProbes;
+				std::vector<std::unique_ptr<ThreadProfile> > mProfiles;
+
+				std::atomic<bool> mTracing;
+				std::atomic<size_t> mEventsPerThread;
+
+				// trace timestamps are relative to this
+				const uint64_t mEpoch;
+			};
+
+			Registry& registry() {
+				// never destroyed, threads may still time scopes while the statics are torn down
+				static Registry* registry = new Registry();
+				return *registry;
+			}
+
+			// gives the profile back when the thread exits
+			struct ProfileHolder {
+				ProfileHolder() : mProfile(nullptr) {}
+
+				~ProfileHolder() {
+					if(mProfile != nullptr) {
+						std::lock_guard<std::mutex> lock(registry().mLock);
+						mProfile->mInUse = false;
+					}
+				}
+
+				ThreadProfile* mProfile;
+			};
+
+			ThreadProfile& threadProfile() {
+				static thread_local ProfileHolder holder;
+
+				if(holder.mProfile == nullptr) {
+					Registry& reg = registry();
+					std::lock_guard<std::mutex> lock(reg.mLock);
+
+					for(size_t i = 0; i < reg.mProfiles.size() && holder.mProfile == nullptr; ++i) {
+						if(!reg.mProfiles[i]->mInUse) {
+							holder.mProfile = reg.mProfiles[i].get();
+							holder.mProfile->mInUse = true;
+						}
+					}
+
+					if(holder.mProfile == nullptr) {
+						reg.mProfiles.push_back(std::unique_ptr<ThreadProfile>(new ThreadProfile(static_cast<unsigned int>(reg.mProfiles.size()) + 1)));
+						holder.mProfile = reg.mProfiles.back().get();
+					}
+				}
+
+				return *holder.mProfile;
+			}
+
+			// merges the probe over all threads, registry lock held
+			void mergeLocked(Registry& reg, unsigned int probe, LatencyHistogram& merged) {
+				merged.clear();
+
+				for(size_t i = 0; i < reg.mProfiles.size(); ++i) {
+					const LatencyHistogram* histogram = reg.mProfiles[i]->mHistograms[probe].load(std::memory_order_acquire);
+
+					if(histogram != nullptr) {
+						merged.merge(*histogram);
+					}
+				}
+			}
+
+			void appendJsonString(std::ostream& out, const std::string& str) {
+				out << '"';
+				for(size_t i = 0; i < str.size(); ++i) {
+					if(str[i] == '"' || str[i] == '\\') {
+						out << '\\';
+					}
+					out << str[i];
+				}
+				out << '"';
+			}
+		}
+
+		LatencyHistogram::LatencyHistogram() {
+			clear();
+		}
+
+		void LatencyHistogram::clear() {
+			mCount.store(0, std::memory_order_relaxed);
+			mSum.store(0, std::memory_order_relaxed);
+			mMin.store(UINT64_MAX, std::memory_order_relaxed);
+			mMax.store(0, std::memory_order_relaxed);
+
+			for(unsigned int i = 0; i < BUCKETS; ++i) {
+				mBuckets[i].store(0, std::memory_order_relaxed);
+			}
+		}
+
+		void LatencyHistogram::merge(const LatencyHistogram& other) {
+			if(other.count() == 0) {
+				return;
+			}
+
+			for(unsigned int i = 0; i < BUCKETS; ++i) {
+				uint64_t count = other.mBuckets[i].load(std::memory_order_relaxed);
+
+				if(count > 0) {
+					add(mBuckets[i], count);
+				}
+			}
+
+			add(mCount, other.count());
+			add(mSum, other.sum());
+
+			if(other.min() < mMin.load(std::memory_order_relaxed)) {
+				mMin.store(other.min(), std::memory_order_relaxed);
+			}
+			if(other.max() > mMax.load(std::memory_order_relaxed)) {
+				mMax.store(other.max(), std::memory_order_relaxed);
+			}
+		}
+
+		uint64_t LatencyHistogram::valueAtPercentile(double percentile) const {
+			uint64_t total = count();
+
+			if(total == 0) {
+				return 0;
+			}
+
+			// rank of the value, 1 based
+			uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(total) + 0.5);
+			rank = std::max<uint64_t>(1, std::min(rank, total));
+
+			uint64_t seen = 0;
+
+			for(unsigned int i = 0; i < BUCKETS; ++i) {
+				seen += mBuckets[i].load(std::memory_order_relaxed);
+
+				if(seen >= rank) {
+					uint64_t value = bucketStart(i) + bucketWidth(i) / 2;
+					return std::max(min(), std::min(value, max()));
+				}
+			}
+
+			return max();
+		}
+
+		unsigned int probe(const char* name) {
+			Registry& reg = registry();
+			std::lock_guard<std::mutex> lock(reg.mLock);
+
+			for(size_t i = 0; i < reg.mProbes.size(); ++i) {
+				if(reg.mProbes[i] == name) {
+					return static_cast<unsigned int>(i);
+				}
+			}
+
+			if(reg.mProbes.size() == MAX_PROBES) {
+				return MAX_PROBES;
+			}
+
+			reg.mProbes.push_back(name);
+			return static_cast<unsigned int>(reg.mProbes.size() - 1);
+		}
+
+		void record(unsigned int probe, uint64_t start, uint64_t end) {
+			if(probe >= MAX_PROBES) {
+				return;
+			}
+
+			ThreadProfile& profile = threadProfile();
+			LatencyHistogram* histogram = profile.mHistograms[probe].load(std::memory_order_relaxed);
+
+			if(histogram == nullptr) {
+				histogram = new LatencyHistogram();
+				profile.mHistograms[probe].store(histogram, std::memory_order_release);
+			}
+
+			histogram->record(end > start ? end - start : 0);
+
+			Registry& reg = registry();
+
+			if(reg.mTracing.load(std::memory_order_relaxed)) {
+				profile.trace(probe, start, end, reg.mEventsPerThread.load(std::memory_order_relaxed));
+			}
+		}
+
+		void setTracing(bool enabled, size_t eventsPerThread) {
+			Registry& reg = registry();
+
+			reg.mEventsPerThread.store(eventsPerThread);
+			reg.mTracing.store(enabled);
+		}
+
+		bool isTracing() {
+			return registry().mTracing.load();
+		}
+
+		void reset() {
+			Registry& reg = registry();
+			std::lock_guard<std::mutex> lock(reg.mLock);
+
+			for(size_t i = 0; i < reg.mProfiles.size(); ++i) {
+				ThreadProfile& profile = *reg.mProfiles[i];
+
+				for(unsigned int probe = 0; probe < MAX_PROBES; ++probe) {
+					LatencyHistogram* histogram = profile.mHistograms[probe].load(std::memory_order_acquire);
+
+					if(histogram != nullptr) {
+						histogram->clear();
+					}
+				}
+
+				profile.mWritten.store(0);
+			}
+		}
+
+		bool histogram(const char* name, LatencyHistogram& merged) {
+			Registry& reg = registry();
+			std::lock_guard<std::mutex> lock(reg.mLock);
+
+			for(size_t i = 0; i < reg.mProbes.size(); ++i) {
+				if(reg.mProbes[i] == name) {
+					mergeLocked(reg, static_cast<unsigned int>(i), merged);
+					return true;
+				}
+			}
+
+			merged.clear();
+			return false;
+		}
+
+		void writeText(std::ostream& out) {
+			static const double PERCENTILES[] = { 50.0, 90.0, 99.0, 99.9 };
+
+			Registry& reg = registry();
+			std::lock_guard<std::mutex> lock(reg.mLock);
+
+			double nsPerTick = debuglib::clock::nanosecondsPerTick();
+			std::unique_ptr<LatencyHistogram> merged(new LatencyHistogram());
+			char line[256];
+
+			snprintf(line, sizeof(line), "%-32s %10s %9s %9s %9s %9s %9s %9s %9s\n", "probe [ns]", "count", "min", "p50", "p90", "p99", "p99.9", "max", "mean");
+			out << line;
+
+			for(size_t i = 0; i < reg.mProbes.size(); ++i) {
+				mergeLocked(reg, static_cast<unsigned int>(i), *merged);
+
+				if(merged->count() == 0) {
+					continue;
+				}
+
+				// the name may be longer than the column, it is written as is
+				const std::string& name = reg.mProbes[i];
+				out << name;
+				if(name.size() < 32) {
+					out << std::string(32 - name.size(), ' ');
+				}
+
+				snprintf(line, sizeof(line), " %10llu %9.0f", static_cast<unsigned long long>(merged->count()), merged->min() * nsPerTick);
+				out << line;
+
+				for(size_t p = 0; p < sizeof(PERCENTILES) / sizeof(PERCENTILES[0]); ++p) {
+					snprintf(line, sizeof(line), " %9.0f", merged->valueAtPercentile(PERCENTILES[p]) * nsPerTick);
+					out << line;
+				}
+
+				snprintf(line, sizeof(line), " %9.0f %9.1f\n", merged->max() * nsPerTick, static_cast<double>(merged->sum()) / merged->count() * nsPerTick);
+				out << line;
+			}
+		}
+
+		void writeChromeTrace(std::ostream& out) {
+			Registry& reg = registry();
+			std::lock_guard<std::mutex> lock(reg.mLock);
+
+			double usPerTick = debuglib::clock::nanosecondsPerTick() / 1000.0;
+			bool first = true;
+			char numbers[96];
+
+			out << "{\"traceEvents\":[";
+
+			for(size_t i = 0; i < reg.mProfiles.size(); ++i) {
+				const ThreadProfile& profile = *reg.mProfiles[i];
+				const TraceEvent* events = profile.mEvents.load(std::memory_order_acquire);
+
+				if(events == nullptr) {
+					continue;
+				}
+
+				uint64_t written = profile.mWritten.load(std::memory_order_acquire);
+				uint64_t begin = written > profile.mCapacity ? written - profile.mCapacity : 0;
+
+				for(uint64_t e = begin; e < written; ++e) {
+					const TraceEvent& event = events[e % profile.mCapacity];
+					uint64_t start = event.mStart.load(std::memory_order_relaxed);
+					uint64_t end = event.mEnd.load(std::memory_order_relaxed);
+					unsigned int probe = event.mProbe.load(std::memory_order_relaxed);
+
+					// torn by the owner overwriting the slot, or from before the epoch
+					if(end < start || start < reg.mEpoch || probe >= reg.mProbes.size()) {
+						continue;
+					}
+
+					out << (first ? "\n" : ",\n") << "{\"name\":";
+					appendJsonString(out, reg.mProbes[probe]);
+
+					snprintf(numbers, sizeof(numbers), ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", profile.mThread,
+						(start - reg.mEpoch) * usPerTick, (end - start) * usPerTick);
+					out << numbers;
+
+					first = false;
+				}
+			}
+
+			out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+		}
+	}
+}
@@ -0,0 +1,360 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file IntrospectionServer.cpp
+ */
+
+#include "../includes/IntrospectionServer.hpp"
+#include "../includes/AllocationStatistics.hpp"
+#include "../includes/LinearAllocator.hpp"
+#include "../includes/Logger.h"
+#include "../includes/MemoryBudget.hpp"
+#include "../includes/PoolAllocator.hpp"
+#include "../includes/ThreadOwnedAllocator.hpp"
+#include "../includes/VirtualArenaAllocator.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace ondraluk;
+
+namespace {
+
+	const size_t MAP_WIDTH = 64;
+
+	bool sendAll(int fd, const std::string& text) {
+		size_t sent = 0;
+
+		while(sent < text.size()) {
+			ssize_t n = ::send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+
+			if(n <= 0) {
+				return false;
+			}
+			sent += static_cast<size_t>(n);
+		}
+
+		return true;
+	}
+
+	void describeBudget(std::ostream& out, const MemoryBudget::Snapshot& snapshot, int depth) {
+		out << std::string(2 * depth, ' ') << snapshot.mName << ": used " << snapshot.mUsed << " peak " << snapshot.mPeak;
+
+		if(snapshot.mLimit != MemoryBudget::UNLIMITED) {
+			out << " limit " << snapshot.mLimit;
+		}
+
+		out << " rejected " << snapshot.mRejected << "\n";
+
+		for(size_t i = 0; i < snapshot.mChildren.size(); ++i) {
+			describeBudget(out, snapshot.mChildren[i], depth + 1);
+		}
+	}
+
+}
+
+IntrospectionServer::IntrospectionServer() : mListener(-1), mRunning(false) {
+	mWake[0] = -1;
+	mWake[1] = -1;
+}
+
+IntrospectionServer::~IntrospectionServer() {
+	stop();
+}
+
+bool IntrospectionServer::start(const std::string& path) {
+	sockaddr_un address;
+
+	if(mRunning || path.size() >= sizeof(address.sun_path)) {
+		return false;
+	}
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+	mListener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if(mListener < 0) {
+		return false;
+	}
+
+	// a socket file left behind by a crashed process blocks bind
+	::unlink(path.c_str());
+
+	if(::bind(mListener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(mListener, 4) != 0 || ::pipe(mWake) != 0) {
+		::close(mListener);
+		mListener = -1;
+		return false;
+	}
+
+	mPath = path;
+	mRunning = true;
+	mThread = std::thread(&IntrospectionServer::run, this);
+
+	return true;
+}
+
+void IntrospectionServer::stop() {
+	if(!mRunning.exchange(false)) {
+		return;
+	}
+
+	char wake = 0;
+	ssize_t written = ::write(mWake[1], &wake, 1);
+	(void)written;
+
+	mThread.join();
+
+	::close(mListener);
+	::close(mWake[0]);
+	::close(mWake[1]);
+	::unlink(mPath.c_str());
+
+	mListener = -1;
+	mWake[0] = -1;
+	mWake[1] = -1;
+}
+
+void IntrospectionServer::addProvider(const std::string& name, IntrospectionProvider provider) {
+	std::lock_guard<std::mutex> lock(mProvidersLock);
+
+	mProviders[name] = std::move(provider);
+}
+
+void IntrospectionServer::removeProvider(const std::string& name) {
+	std::lock_guard<std::mutex> lock(mProvidersLock);
+
+	mProviders.erase(name);
+}
+
+void IntrospectionServer::run() {
+	while(mRunning) {
+		pollfd fds[2] = { { mListener, POLLIN, 0 }, { mWake[0], POLLIN, 0 } };
+
+		if(::poll(fds, 2, -1) < 0 || (fds[1].revents & POLLIN)) {
+			continue;
+		}
+
+		int connection = ::accept(mListener, nullptr, nullptr);
+
+		if(connection >= 0) {
+			serve(connection);
+			::close(connection);
+		}
+	}
+}
+
+void IntrospectionServer::serve(int connection) {
+	std::string buffer;
+	char chunk[512];
+
+	while(mRunning) {
+		pollfd fds[2] = { { connection, POLLIN, 0 }, { mWake[0], POLLIN, 0 } };
+
+		if(::poll(fds, 2, -1) < 0 || (fds[1].revents & POLLIN)) {
+			return;
+		}
+
+		ssize_t received = ::recv(connection, chunk, sizeof(chunk), 0);
+
+		if(received <= 0) {
+			return;
+		}
+
+		buffer.append(chunk, static_cast<size_t>(received));
+
+		size_t end;
+		while((end = buffer.find('\n')) != std::string::npos) {
+			std::ostringstream answer;
+
+			execute(buffer.substr(0, end), answer);
+			answer << "\n";
+			buffer.erase(0, end + 1);
+
+			if(!sendAll(connection, answer.str())) {
+				return;
+			}
+		}
+	}
+}
+
+void IntrospectionServer::execute(const std::string& command, std::ostream& out) {
+	std::istringstream arguments(command);
+	std::string verb;
+
+	arguments >> verb;
+
+	if(verb == "providers") {
+		std::lock_guard<std::mutex> lock(mProvidersLock);
+
+		for(std::map<std::string, IntrospectionProvider>::const_iterator it = mProviders.begin(); it != mProviders.end(); ++it) {
+			out << it->first << "\n";
+		}
+	} else if(verb == "show") {
+		std::string name;
+		arguments >> name;
+
+		std::lock_guard<std::mutex> lock(mProvidersLock);
+
+		if(!name.empty() && mProviders.find(name) == mProviders.end()) {
+			out << "error: no provider " << name << "\n";
+			return;
+		}
+
+		for(std::map<std::string, IntrospectionProvider>::const_iterator it = mProviders.begin(); it != mProviders.end(); ++it) {
+			if(name.empty() || it->first == name) {
+				out << "[" << it->first << "]\n";
+				it->second(out);
+			}
+		}
+	} else if(verb == "loggers") {
+		int loggers = debuglib::logdispatch::LoggerMgr.size();
+
+		out << "loggers " << loggers << "\n";
+		for(int i = 0; i < loggers; ++i) {
+			out << "  " << i << ": pending " << debuglib::logdispatch::LoggerMgr.pending(i) << "\n";
+		}
+	} else if(verb == "log") {
+		executeLog(arguments, out);
+	} else if(verb == "help" || verb.empty()) {
+		out << "providers | show [name] | loggers | log | log level <level> | log channel <channel> on|off | log sample <level> <every>\n";
+	} else {
+		out << "error: unknown command " << verb << "\n";
+	}
+}
+
+void IntrospectionServer::executeLog(std::istream& arguments, std::ostream& out) {
+	using debuglib::logdispatch::LoggerManager;
+	LoggerManager& manager = debuglib::logdispatch::LoggerMgr;
+
+	std::string setting;
+	arguments >> setting;
+
+	if(setting.empty()) {
+		out << "level " << manager.level() << "\nchannels";
+		for(int channel = 0; channel < LoggerManager::MAX_CHANNELS; ++channel) {
+			if(manager.isChannelEnabled(channel)) {
+				out << " " << channel;
+			}
+		}
+		out << "\nsampling";
+		for(int level = 0; level < LoggerManager::LEVELS; ++level) {
+			out << " " << manager.sampling(level);
+		}
+		out << "\n";
+	} else if(setting == "level") {
+		int level;
+
+		if(!(arguments >> level)) {
+			out << "error: log level <level>\n";
+			return;
+		}
+
+		manager.setLevel(level);
+		out << "ok\n";
+	} else if(setting == "channel") {
+		int channel;
+		std::string state;
+
+		if(!(arguments >> channel >> state) || (state != "on" && state != "off") || channel < 0 || channel >= LoggerManager::MAX_CHANNELS) {
+			out << "error: log channel <0.." << LoggerManager::MAX_CHANNELS - 1 << "> on|off\n";
+			return;
+		}
+
+		manager.enableChannel(channel, state == "on");
+		out << "ok\n";
+	} else if(setting == "sample") {
+		int level;
+		unsigned int every;
+
+		if(!(arguments >> level >> every) || level < 0 || level >= LoggerManager::LEVELS || every == 0) {
+			out << "error: log sample <0.." << LoggerManager::LEVELS - 1 << "> <every>\n";
+			return;
+		}
+
+		manager.setSampling(level, every);
+		out << "ok\n";
+	} else {
+		out << "error: unknown log setting " << setting << "\n";
+	}
+}
+
+void PublishedText::publish(const IntrospectionProvider& writer) {
+	std::ostringstream text;
+	writer(text);
+
+	std::string published = text.str();
+
+	std::lock_guard<std::mutex> lock(mLock);
+	mText.swap(published);
+}
+
+void PublishedText::write(std::ostream& out) const {
+	std::lock_guard<std::mutex> lock(mLock);
+	out << mText;
+}
+
+void ondraluk::describe(std::ostream& out, const LinearAllocator& allocator) {
+	out << "linear: used " << allocator.used() << " of " << allocator.size() << " (" << PageSource::name(allocator.backend()) << ")\n";
+}
+
+void ondraluk::describe(std::ostream& out, const PoolAllocator& allocator) {
+	out << "pool: " << allocator.used() << " of " << allocator.blockCount() << " blocks of " << allocator.blockSize() << " used, "
+		<< allocator.touched() << " touched, generation " << allocator.generation() << " (" << PageSource::name(allocator.backend()) << ")\n";
+}
+
+void ondraluk::describeMap(std::ostream& out, const PoolAllocator& allocator) {
+	std::vector<bool> used;
+	allocator.blockStates(used);
+
+	if(used.empty()) {
+		return;
+	}
+
+	// one character per group of blocks
+	size_t group = (used.size() + MAP_WIDTH - 1) / MAP_WIDTH;
+	std::string map;
+
+	for(size_t begin = 0; begin < used.size(); begin += group) {
+		size_t end = std::min(begin + group, used.size());
+		size_t count = 0;
+
+		for(size_t i = begin; i < end; ++i) {
+			count += used[i];
+		}
+
+		map += count == end - begin ? '#' : count > 0 ? '+' : '.';
+	}
+
+	out << "[" << map << "]\n";
+}
+
+void ondraluk::describe(std::ostream& out, const VirtualArenaAllocator& allocator) {
+	out << "virtual arena: used " << allocator.used() << " peak " << allocator.peak() << " committed " << allocator.committed()
+		<< " reserved " << allocator.reserved() << "\n";
+}
+
+void ondraluk::describe(std::ostream& out, const ThreadOwnedAllocator& allocator) {
+	out << "thread owned: heaps " << allocator.heapCount() << " abandoned " << allocator.abandonedHeaps() << " remote frees "
+		<< allocator.remoteFrees() << " drained " << allocator.drainedFrees() << "\n";
+}
+
+void ondraluk::describe(std::ostream& out, const MemoryBudget& budget) {
+	describeBudget(out, budget.snapshot(), 0);
+}
+
+void ondraluk::describe(std::ostream& out, const AllocationStatistics& statistics) {
+	out << "allocations " << statistics.mAllocations.load() << " deallocations " << statistics.mDeallocations.load()
+		<< " live " << statistics.live() << " peak live " << statistics.mPeakLive.load() << " bytes " << statistics.mBytes.load() << "\n";
+}
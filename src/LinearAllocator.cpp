@@ -8,49 +8,88 @@
  */
 
 #include "../includes/LinearAllocator.hpp"
+#include "../includes/Sanitizer.hpp"
 
 #include <cstdio>
 
 using namespace ondraluk;
 
-LinearAllocator::LinearAllocator(size_t size) : mMem(nullptr), mCurrent(nullptr), mEnd(nullptr), mSize(size) {
+LinearAllocator::LinearAllocator(size_t size, PAGEBACKEND::ENUM backend) : mMem(nullptr), mCurrent(nullptr), mEnd(nullptr), mSize(size), mPreferred(backend) {
 	init();
 }
 
-LinearAllocator::LinearAllocator(LinearAllocator&& other) : mMem(other.mMem), mCurrent(other.mMem), mEnd(other.mEnd), mSize(other.mSize) {
+LinearAllocator::LinearAllocator(LinearAllocator&& other) : mMem(other.mMem), mCurrent(other.mCurrent), mEnd(other.mEnd), mSize(other.mSize),
+	mPreferred(other.mPreferred), mRegion(other.mRegion) {
 	other.mMem = nullptr;
 	other.mCurrent = nullptr;
 	other.mEnd = nullptr;
 	other.mSize = 0;
+	other.mRegion = PageRegion();
 }
 
 LinearAllocator::~LinearAllocator() {
-	if (mSize > 0 && mMem != nullptr)
-		::free(mMem);
+	if(mMem != nullptr) {
+		ONDRALUK_UNPOISON_MEMORY_REGION(mMem, mSize);
+	}
+
+	PageSource::release(mRegion);
 
 	mMem = nullptr;
 }
 
 void LinearAllocator::init() {
-	mMem = static_cast<byte*>(::malloc(mSize));
+	mRegion = PageSource::acquire(mSize, mPreferred);
+	mMem = static_cast<byte*>(mRegion.mMem);
 	mCurrent = mMem;
-	mEnd = mMem + mSize;
+	mEnd = mMem != nullptr ? mMem + mSize : nullptr;
+
+	// nothing is handed out yet, ASan reports every access until allocate
+	if(mMem != nullptr) {
+		ONDRALUK_POISON_MEMORY_REGION(mMem, mSize);
+	}
 }
 
 void* LinearAllocator::allocate(size_t size) {
 	void* address = asVoid;
 	mCurrent += size;
 
-	if(mCurrent >= mEnd) {
+	if(mCurrent > mEnd) {
 		mCurrent -= size;
 		return nullptr;
 	}
 
+	ONDRALUK_UNPOISON_MEMORY_REGION(address, size);
+
 	return address;
 }
 
 void LinearAllocator::free(void* mem) {
+	// everything above the rewind mark is dead
+	if(mem != nullptr && mem < asVoid) {
+		ONDRALUK_POISON_MEMORY_REGION(mem, static_cast<byte*>(asVoid) - static_cast<byte*>(mem));
+	}
+
 	asVoid = mem;
 }
 
+bool LinearAllocator::owns(const void* mem) const {
+	const byte* address = static_cast<const byte*>(mem);
+
+	return mMem != nullptr && address >= mMem && address < mEnd;
+}
+
+PAGEBACKEND::ENUM LinearAllocator::backend() const {
+	return mRegion.mBackend;
+}
+
+const void* LinearAllocator::data() const {
+	return mMem;
+}
+
+size_t LinearAllocator::used() const {
+	return mCurrent - mMem;
+}
 
+size_t LinearAllocator::size() const {
+	return mSize;
+}
@@ -5,8 +5,10 @@
 
 
 #include "../includes/Logger.h"
+#include "../includes/Instrumentation.h"
 #include <algorithm>
 #include <cstdarg>
+#include <thread>
 
 namespace debuglib 
 {
@@ -14,52 +16,205 @@ namespace debuglib
 	{
 		LoggerManager LoggerMgr;
 
-		LoggerManager::LoggerManager() {
-			mChannels.insert(1);
+		const int LoggerManager::MAX_CHANNELS;
+		const int LoggerManager::LEVELS;
+
+		LoggerManager::LoggerManager() : mLevel(debuglib::logger::UNDEFINED), mCurrent(&mLists[0]) {
+			for(int i = 0; i < MAX_CHANNELS / 64; ++i) {
+				mChannels[i].store(0);
+			}
+			for(int i = 0; i < LEVELS; ++i) {
+				mSampling[i].store(1);
+			}
+
+			enableChannel(1);
 		}
 
 		LoggerManager::~LoggerManager() {
-			// no need to clear mChannels since the memory will be freed anyway after the LoggerManager is destructed and deleted
+
+		}
+
+		LoggerManager::ListReader::ListReader(LoggerManager& manager) {
+			while(true) {
+				mList = manager.mCurrent.load();
+				mList->mReaders.fetch_add(1);
+
+				// the list may have been replaced between loading and registering
+				if(manager.mCurrent.load() == mList) {
+					return;
+				}
+
+				mList->mReaders.fetch_sub(1);
+			}
+		}
+
+		LoggerManager::ListReader::~ListReader() {
+			mList->mReaders.fetch_sub(1);
+		}
+
+		void LoggerManager::waitForReaders(const LoggerList& list) {
+			while(list.mReaders.load() != 0) {
+				std::this_thread::yield();
+			}
+		}
+
+		void LoggerManager::publish(debuglib::logger::LoggerBase* added, debuglib::logger::LoggerBase* removed) {
+			LoggerList* current = mCurrent.load();
+			LoggerList* spare = current == &mLists[0] ? &mLists[1] : &mLists[0];
+
+			// readers of the spare only registered to find out that it is not current
+			waitForReaders(*spare);
+
+			spare->mLoggers = current->mLoggers;
+			if(added != nullptr) {
+				spare->mLoggers.push_back(added);
+			}
+			spare->mLoggers.erase(std::remove(spare->mLoggers.begin(), spare->mLoggers.end(), removed), spare->mLoggers.end());
+
+			mCurrent.store(spare);
+
+			// dispatches which started before the switch may still use a removed logger
+			waitForReaders(*current);
 		}
 
 		void LoggerManager::addLogger(debuglib::logger::LoggerBase* l) {
-			mLoggers.push_back(l);
+			std::lock_guard<std::mutex> lock(mLoggersLock);
+			publish(l, nullptr);
 		}
 
 		void LoggerManager::removeLogger(debuglib::logger::LoggerBase* l) {
-			std::remove(mLoggers.begin(), mLoggers.end(), l);
+			std::lock_guard<std::mutex> lock(mLoggersLock);
+			publish(nullptr, l);
 		}
 
 		int LoggerManager::size() {
-			return mLoggers.size();
+			ListReader reader(*this);
+			return static_cast<int>(reader.loggers().size());
+		}
+
+		bool LoggerManager::accepts(int channel, int loglevel) {
+			if(!isChannelEnabled(channel) || loglevel < mLevel.load(std::memory_order_relaxed)) {
+				return false;
+			}
+
+			if(loglevel < 0 || loglevel >= LEVELS) {
+				return true;
+			}
+
+			unsigned int every = mSampling[loglevel].load(std::memory_order_relaxed);
+
+			if(every <= 1) {
+				return true;
+			}
+
+			static thread_local unsigned int counters[LEVELS] = {};
+
+			return counters[loglevel]++ % every == 0;
 		}
 
 		void LoggerManager::log(int channel, int loglevel, const char* formated_message, ...) {
-			
-			if(mChannels.find(channel) != mChannels.end()) {
+			INSTRUMENT_SCOPE("LoggerManager::log");
+
+			if(accepts(channel, loglevel)) {
 
 				va_list list;
 				va_start(list, formated_message);
 
-				if(size()) {
-					for(std::vector<debuglib::logger::LoggerBase*>::const_iterator it = mLoggers.cbegin(); it != mLoggers.cend(); ++it) {
-						debuglib::logger::LoggerBase* tmp = *it;
-			
-						tmp->log(channel, loglevel, formated_message, list);
-					}
+				ListReader reader(*this);
+				const std::vector<debuglib::logger::LoggerBase*>& loggers = reader.loggers();
+
+				for(std::vector<debuglib::logger::LoggerBase*>::const_iterator it = loggers.cbegin(); it != loggers.cend(); ++it) {
+					debuglib::logger::LoggerBase* tmp = *it;
+		
+					tmp->log(channel, loglevel, formated_message, list);
 				}
 
 				va_end(list);
 			}
 		}
 
+		void LoggerManager::logEvent(int channel, int loglevel, const debuglib::logger::LogEvent& event) {
+			INSTRUMENT_SCOPE("LoggerManager::logEvent");
+
+			if(accepts(channel, loglevel)) {
+				ListReader reader(*this);
+				const std::vector<debuglib::logger::LoggerBase*>& loggers = reader.loggers();
+
+				for(std::vector<debuglib::logger::LoggerBase*>::const_iterator it = loggers.cbegin(); it != loggers.cend(); ++it) {
+					(*it)->logEvent(channel, loglevel, event);
+				}
+			}
+		}
+
+		void LoggerManager::flush() {
+			ListReader reader(*this);
+			const std::vector<debuglib::logger::LoggerBase*>& loggers = reader.loggers();
+
+			for(std::vector<debuglib::logger::LoggerBase*>::const_iterator it = loggers.cbegin(); it != loggers.cend(); ++it) {
+				(*it)->flush();
+			}
+		}
+
 		void LoggerManager::registerChannel(int channel) {
-			std::pair<std::set<int>::iterator,bool> ret = mChannels.insert(channel);
+			if(channel < 0 || channel >= MAX_CHANNELS) {
+				LOG(1, debuglib::logger::ERR, "Channel %d out of range", channel);
+				return;
+			}
+
+			uint64_t bit = static_cast<uint64_t>(1) << (channel % 64);
 			
 			// element already existed
-			if(ret.second == false) {
+			if(mChannels[channel / 64].fetch_or(bit) & bit) {
 				LOG(1, debuglib::logger::ERR, "Channel %d already taken", channel);
 			}
 		}
+
+		void LoggerManager::enableChannel(int channel, bool enabled) {
+			if(channel < 0 || channel >= MAX_CHANNELS) {
+				return;
+			}
+
+			uint64_t bit = static_cast<uint64_t>(1) << (channel % 64);
+
+			if(enabled) {
+				mChannels[channel / 64].fetch_or(bit);
+			} else {
+				mChannels[channel / 64].fetch_and(~bit);
+			}
+		}
+
+		bool LoggerManager::isChannelEnabled(int channel) const {
+			if(channel < 0 || channel >= MAX_CHANNELS) {
+				return false;
+			}
+
+			return (mChannels[channel / 64].load(std::memory_order_relaxed) >> (channel % 64)) & 1;
+		}
+
+		void LoggerManager::setLevel(int loglevel) {
+			mLevel.store(loglevel);
+		}
+
+		int LoggerManager::level() const {
+			return mLevel.load();
+		}
+
+		void LoggerManager::setSampling(int loglevel, unsigned int every) {
+			if(loglevel >= 0 && loglevel < LEVELS) {
+				mSampling[loglevel].store(every > 0 ? every : 1);
+			}
+		}
+
+		unsigned int LoggerManager::sampling(int loglevel) const {
+			return loglevel >= 0 && loglevel < LEVELS ? mSampling[loglevel].load() : 1;
+		}
+
+		size_t LoggerManager::pending(int logger) {
+			// the logger can not finish unregistering, and so not be destroyed, while it is asked
+			ListReader reader(*this);
+			const std::vector<debuglib::logger::LoggerBase*>& loggers = reader.loggers();
+
+			return logger >= 0 && logger < static_cast<int>(loggers.size()) ? loggers[logger]->pending() : 0;
+		}
 	}
 }
\ No newline at end of file
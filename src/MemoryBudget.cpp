@@ -0,0 +1,126 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file MemoryBudget.cpp
+ */
+
+#include "../includes/MemoryBudget.hpp"
+
+#include <algorithm>
+
+using namespace ondraluk;
+
+const size_t MemoryBudget::UNLIMITED;
+
+MemoryBudget::MemoryBudget(const char* name, size_t limit, MemoryBudget* parent, BudgetExceededCallback callback) : mName(name), mParent(parent),
+	mCallback(callback), mUsed(0), mLimit(limit), mPeak(0), mRejected(0) {
+	if(mParent != nullptr) {
+		std::lock_guard<std::mutex> lock(mParent->mChildrenLock);
+		mParent->mChildren.push_back(this);
+	}
+}
+
+MemoryBudget::~MemoryBudget() {
+	if(mParent != nullptr) {
+		{
+			std::lock_guard<std::mutex> lock(mParent->mChildrenLock);
+			mParent->mChildren.erase(std::remove(mParent->mChildren.begin(), mParent->mChildren.end(), this), mParent->mChildren.end());
+		}
+
+		size_t remaining = mUsed.load();
+		if(remaining > 0) {
+			mParent->release(remaining);
+		}
+	}
+}
+
+bool MemoryBudget::reserve(size_t size) {
+	MemoryBudget* budget = this;
+
+	while(budget != nullptr && budget->tryReserve(size)) {
+		budget = budget->mParent;
+	}
+
+	if(budget == nullptr) {
+		return true;
+	}
+
+	// undo the budgets below the rejecting one
+	for(MemoryBudget* accounted = this; accounted != budget; accounted = accounted->mParent) {
+		accounted->mUsed.fetch_sub(size, std::memory_order_relaxed);
+	}
+
+	return false;
+}
+
+bool MemoryBudget::tryReserve(size_t size) {
+	for(bool retried = false; ; retried = true) {
+		size_t used = mUsed.load(std::memory_order_relaxed);
+		size_t limit = mLimit.load(std::memory_order_relaxed);
+
+		while(size <= limit && used <= limit - size) {
+			if(mUsed.compare_exchange_weak(used, used + size, std::memory_order_relaxed)) {
+				account(used + size);
+				return true;
+			}
+		}
+
+#if ONDRALUK_TRACKING
+		LOG_EVENT(1, debuglib::logger::WARN, "budget_exceeded",
+			debuglib::logger::LogField("budget", mName.c_str()),
+			debuglib::logger::LogField("requested", size),
+			debuglib::logger::LogField("used", used),
+			debuglib::logger::LogField("limit", limit));
+#endif
+
+		BUDGETACTION::ENUM action = mCallback ? mCallback(*this, size) : BUDGETACTION::REJECT;
+
+		if(action == BUDGETACTION::ALLOW) {
+			account(mUsed.fetch_add(size, std::memory_order_relaxed) + size);
+			return true;
+		}
+
+		if(action == BUDGETACTION::REJECT || retried) {
+			mRejected.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+	}
+}
+
+void MemoryBudget::account(size_t used) {
+	size_t peak = mPeak.load(std::memory_order_relaxed);
+
+	while(used > peak && !mPeak.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {
+	}
+}
+
+void MemoryBudget::release(size_t size) {
+	for(MemoryBudget* budget = this; budget != nullptr; budget = budget->mParent) {
+		budget->mUsed.fetch_sub(size, std::memory_order_relaxed);
+	}
+}
+
+void MemoryBudget::setLimit(size_t limit) {
+	mLimit.store(limit, std::memory_order_relaxed);
+}
+
+MemoryBudget::Snapshot MemoryBudget::snapshot() const {
+	Snapshot snapshot;
+
+	snapshot.mName = mName;
+	snapshot.mUsed = used();
+	snapshot.mLimit = limit();
+	snapshot.mPeak = peak();
+	snapshot.mRejected = rejected();
+
+	std::lock_guard<std::mutex> lock(mChildrenLock);
+
+	for(size_t i = 0; i < mChildren.size(); ++i) {
+		snapshot.mChildren.push_back(mChildren[i]->snapshot());
+	}
+
+	return snapshot;
+}
@@ -0,0 +1,203 @@
+/**
+ *  This file is part of the debuglib project
+ *  Copyright by Christian Ondracek
+ *  Contact: coder[at]paxi.at
+ */
+
+#include "../includes/MmapFileOutputter.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace debuglib
+{
+	namespace logger
+	{
+		/**
+		 * Owns the file and the mapped segments of a MmapFileOutputter.
+		 */
+		class MappedLogFile {
+		public:
+			MappedLogFile(const char* fname, size_t segmentSize);
+			~MappedLogFile();
+
+			void write(const char* msg, size_t len);
+			void sync();
+
+		private:
+			MappedLogFile(const MappedLogFile&);
+			MappedLogFile& operator=(const MappedLogFile&);
+
+			struct Segment {
+				Segment() : mBase(nullptr), mFileOffset(0), mOffset(0), mWriters(0) {}
+
+				char* mBase;
+				size_t mFileOffset;
+				std::atomic<size_t> mOffset;
+				std::atomic<unsigned int> mWriters;
+			};
+
+			bool map(Segment* segment, size_t fileOffset);
+			void advance(Segment* full);
+
+			int mFd;
+			size_t mSegmentSize;
+
+			std::atomic<Segment*> mCurrent;
+
+			// the current segment and the spare the next one is mapped into. A writer may still look at a retired
+			// segment, so the objects live as long as the file; one reused as current takes such a writer along.
+			Segment mSegments[2];
+			std::mutex mRemapMutex;
+
+			// bytes logged up to the current segment, all there is once mapping a segment failed
+			size_t mLogged;
+		};
+
+		MappedLogFile::MappedLogFile(const char* fname, size_t segmentSize) : mFd(-1), mSegmentSize(0), mCurrent(nullptr), mLogged(0) {
+			size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+			mSegmentSize = ((segmentSize + page - 1) / page) * page;
+
+			if(mSegmentSize == 0) {
+				mSegmentSize = page;
+			}
+
+			mFd = ::open(fname, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+			if(mFd >= 0 && map(&mSegments[0], 0)) {
+				mCurrent.store(&mSegments[0]);
+			}
+		}
+
+		MappedLogFile::~MappedLogFile() {
+			Segment* last = mCurrent.load();
+			size_t logged = mLogged;
+
+			if(last != nullptr) {
+				size_t used = last->mOffset.load();
+				logged = last->mFileOffset + (used < mSegmentSize ? used : mSegmentSize);
+				::munmap(last->mBase, mSegmentSize);
+			}
+
+			if(mFd >= 0) {
+				// drop the preallocated but unused tail
+				if(::ftruncate(mFd, static_cast<off_t>(logged)) != 0) {
+					// keep the NUL padded file
+				}
+				::close(mFd);
+			}
+		}
+
+		bool MappedLogFile::map(Segment* segment, size_t fileOffset) {
+			off_t offset = static_cast<off_t>(fileOffset);
+			off_t length = static_cast<off_t>(mSegmentSize);
+
+			// reserve the blocks up front, a full disk must not turn into a SIGBUS on the logging path
+			if(::posix_fallocate(mFd, offset, length) != 0 && ::ftruncate(mFd, offset + length) != 0) {
+				return false;
+			}
+
+			void* base = ::mmap(nullptr, mSegmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, offset);
+
+			if(base == MAP_FAILED) {
+				return false;
+			}
+
+			segment->mBase = static_cast<char*>(base);
+			segment->mFileOffset = fileOffset;
+			segment->mOffset.store(0);
+
+			return true;
+		}
+
+		void MappedLogFile::advance(Segment* full) {
+			std::lock_guard<std::mutex> lock(mRemapMutex);
+
+			// another writer already moved on
+			if(mCurrent.load() != full) {
+				return;
+			}
+
+			mLogged = full->mFileOffset + mSegmentSize;
+
+			// the spare is unmapped, the writers which registered on it saw that it was not current and left
+			Segment* next = full == &mSegments[0] ? &mSegments[1] : &mSegments[0];
+
+			// out of disk space: messages are dropped from now on, mLogged keeps what was written
+			mCurrent.store(map(next, mLogged) ? next : nullptr);
+
+			// writers which registered before the switch are still copying into the old mapping
+			while(full->mWriters.load() != 0) {
+				std::this_thread::yield();
+			}
+
+			::munmap(full->mBase, mSegmentSize);
+			full->mBase = nullptr;
+		}
+
+		void MappedLogFile::write(const char* msg, size_t len) {
+			if(len > mSegmentSize) {
+				len = mSegmentSize;
+			}
+
+			while(true) {
+				Segment* segment = mCurrent.load();
+
+				if(segment == nullptr) {
+					return;
+				}
+
+				segment->mWriters.fetch_add(1);
+
+				// the segment may have been retired between loading and registering
+				if(mCurrent.load() != segment) {
+					segment->mWriters.fetch_sub(1);
+					continue;
+				}
+
+				size_t offset = segment->mOffset.fetch_add(len);
+
+				if(offset + len <= mSegmentSize) {
+					memcpy(segment->mBase + offset, msg, len);
+					segment->mWriters.fetch_sub(1);
+					return;
+				}
+
+				segment->mWriters.fetch_sub(1);
+				advance(segment);
+			}
+		}
+
+		void MappedLogFile::sync() {
+			std::lock_guard<std::mutex> lock(mRemapMutex);
+			Segment* segment = mCurrent.load();
+
+			if(segment != nullptr) {
+				::msync(segment->mBase, mSegmentSize, MS_ASYNC);
+			}
+		}
+
+		MmapFileOutputter::MmapFileOutputter(const char* fname, size_t segmentSize) :
+			mFile(std::make_shared<MappedLogFile>(fname, segmentSize)) {
+
+		}
+
+		void MmapFileOutputter::out(const char* msg) const {
+			if(mFile) {
+				mFile->write(msg, strlen(msg));
+			}
+		}
+
+		void MmapFileOutputter::flush() const {
+			if(mFile) {
+				mFile->sync();
+			}
+		}
+	}
+}
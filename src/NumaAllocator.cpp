@@ -0,0 +1,269 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file NumaAllocator.cpp
+ */
+
+#include "../includes/NumaAllocator.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#if defined(__linux__)
+	#include <sched.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
+
+using namespace ondraluk;
+
+namespace {
+
+#if defined(__linux__) && defined(SYS_mbind)
+	// from linux/mempolicy.h, not every libc ships numaif.h
+	const int ONDRALUK_MPOL_BIND = 2;
+
+	bool bindToNode(void* mem, size_t size, unsigned int node) {
+		const size_t BITS = 8 * sizeof(unsigned long);
+		std::vector<unsigned long> mask(node / BITS + 1, 0);
+
+		mask[node / BITS] |= 1UL << (node % BITS);
+
+		// the kernel expects the number of bits plus one
+		return syscall(SYS_mbind, mem, size, ONDRALUK_MPOL_BIND, mask.data(), mask.size() * BITS + 1, 0) == 0;
+	}
+#else
+	bool bindToNode(void*, size_t, unsigned int) {
+		return false;
+	}
+#endif
+
+	/**
+	 * Faults in every page from a thread running on the cpus of the node, the kernel's default policy then
+	 * places the pages there
+	 */
+	bool touchFromNode(unsigned char* mem, size_t size, const std::vector<unsigned int>& cpus) {
+#if defined(__linux__)
+		if(cpus.empty()) {
+			return false;
+		}
+
+		bool pinned = false;
+
+		std::thread toucher([&]() {
+			cpu_set_t set;
+			CPU_ZERO(&set);
+
+			for(size_t i = 0; i < cpus.size(); ++i) {
+				if(cpus[i] < CPU_SETSIZE) {
+					CPU_SET(cpus[i], &set);
+				}
+			}
+
+			pinned = sched_setaffinity(0, sizeof(set), &set) == 0;
+
+			if(!pinned) {
+				return;
+			}
+
+			size_t page = PageSource::pageSize();
+			for(size_t offset = 0; offset < size; offset += page) {
+				mem[offset] = 0;
+			}
+		});
+
+		toucher.join();
+
+		return pinned;
+#else
+		(void)mem;
+		(void)size;
+		(void)cpus;
+		return false;
+#endif
+	}
+}
+
+NumaArena::NumaArena(size_t size, unsigned int node, const NumaTopology& topology, PAGEBACKEND::ENUM backend) : mCurrent(nullptr), mEnd(nullptr),
+	mNode(node), mBinding(NUMABINDING::NONE) {
+	std::fill(mFree, mFree + CLASSES, nullptr);
+
+	mRegion = PageSource::acquire(size, backend == PAGEBACKEND::MALLOC ? PAGEBACKEND::MMAP : backend);
+
+	if(mRegion.mMem == nullptr) {
+		return;
+	}
+
+	mCurrent = static_cast<unsigned char*>(mRegion.mMem);
+	mEnd = mCurrent + size;
+
+	if(topology.isSimulated() || mRegion.mBackend == PAGEBACKEND::MALLOC) {
+		return;
+	}
+
+	if(bindToNode(mRegion.mMem, mRegion.mSize, node)) {
+		mBinding = NUMABINDING::MBIND;
+	} else if(touchFromNode(mCurrent, mRegion.mSize, topology.cpusOfNode(node))) {
+		mBinding = NUMABINDING::FIRST_TOUCH;
+	}
+}
+
+NumaArena::NumaArena(NumaArena&& other) : mRegion(other.mRegion), mCurrent(other.mCurrent), mEnd(other.mEnd), mNode(other.mNode), mBinding(other.mBinding) {
+	std::copy(other.mFree, other.mFree + CLASSES, mFree);
+	std::fill(other.mFree, other.mFree + CLASSES, nullptr);
+
+	other.mRegion = PageRegion();
+	other.mCurrent = nullptr;
+	other.mEnd = nullptr;
+}
+
+NumaArena::~NumaArena() {
+	PageSource::release(mRegion);
+}
+
+const size_t NumaArena::OVERHEAD;
+const unsigned int NumaArena::CLASSES;
+
+void* NumaArena::allocate(size_t size) {
+	const unsigned char* begin = static_cast<const unsigned char*>(mRegion.mMem);
+
+	if(size > static_cast<size_t>(mEnd - begin)) {
+		return nullptr;
+	}
+
+	size_t blockSize = ((std::max<size_t>(size, 1) + OVERHEAD - 1) & ~(OVERHEAD - 1)) + OVERHEAD;
+	unsigned int sizeClass = classOf(blockSize);
+
+	// first fit within the own class, every block of a larger class is large enough
+	for(FreeBlock** link = &mFree[sizeClass]; *link != nullptr; link = &(*link)->mNext) {
+		if(headerOf(*link)->mSize >= blockSize) {
+			FreeBlock* block = *link;
+			*link = block->mNext;
+			return block;
+		}
+	}
+
+	for(unsigned int larger = sizeClass + 1; larger < CLASSES; ++larger) {
+		if(mFree[larger] != nullptr) {
+			FreeBlock* block = mFree[larger];
+			mFree[larger] = block->mNext;
+			return block;
+		}
+	}
+
+	if(blockSize > static_cast<size_t>(mEnd - mCurrent)) {
+		return nullptr;
+	}
+
+	BlockHeader* header = reinterpret_cast<BlockHeader*>(mCurrent);
+	header->mSize = blockSize;
+	mCurrent += blockSize;
+
+	return header + 1;
+}
+
+void NumaArena::free(void* mem) {
+	if(mem == nullptr) {
+		return;
+	}
+
+	FreeBlock* block = static_cast<FreeBlock*>(mem);
+	unsigned int sizeClass = classOf(headerOf(mem)->mSize);
+
+	block->mNext = mFree[sizeClass];
+	mFree[sizeClass] = block;
+}
+
+NumaArena::BlockHeader* NumaArena::headerOf(void* mem) {
+	return static_cast<BlockHeader*>(mem) - 1;
+}
+
+unsigned int NumaArena::classOf(size_t size) {
+	unsigned int sizeClass = 0;
+
+	while(size > 1) {
+		size >>= 1;
+		++sizeClass;
+	}
+
+	return sizeClass;
+}
+
+bool NumaArena::owns(const void* mem) const {
+	const unsigned char* address = static_cast<const unsigned char*>(mem);
+	const unsigned char* begin = static_cast<const unsigned char*>(mRegion.mMem);
+
+	return begin != nullptr && address >= begin && address < mEnd;
+}
+
+unsigned int NumaArena::node() const {
+	return mNode;
+}
+
+NUMABINDING::ENUM NumaArena::binding() const {
+	return mBinding;
+}
+
+PAGEBACKEND::ENUM NumaArena::backend() const {
+	return mRegion.mBackend;
+}
+
+unsigned int ondraluk::currentCpu() {
+#if defined(__linux__)
+	int cpu = sched_getcpu();
+	return cpu >= 0 ? static_cast<unsigned int>(cpu) : 0;
+#else
+	return 0;
+#endif
+}
+
+NumaAllocator::NumaAllocator(size_t arenaSize, const NumaTopology& topology, CpuSource cpuSource, PAGEBACKEND::ENUM backend) : mTopology(topology),
+	mCpuSource(cpuSource) {
+	for(unsigned int node = 0; node < mTopology.nodeCount(); ++node) {
+		mNodes.push_back(std::unique_ptr<Node>(new Node(arenaSize, node, mTopology, backend)));
+	}
+}
+
+void* NumaAllocator::allocate(size_t size) {
+	Node& node = *mNodes[currentNode()];
+	std::lock_guard<std::mutex> lock(node.mLock);
+
+	return node.mArena.allocate(size);
+}
+
+void NumaAllocator::free(void* mem) {
+	for(size_t i = 0; i < mNodes.size(); ++i) {
+		if(mNodes[i]->mArena.owns(mem)) {
+			std::lock_guard<std::mutex> lock(mNodes[i]->mLock);
+			mNodes[i]->mArena.free(mem);
+			return;
+		}
+	}
+}
+
+bool NumaAllocator::owns(const void* mem) const {
+	for(size_t i = 0; i < mNodes.size(); ++i) {
+		if(mNodes[i]->mArena.owns(mem)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+unsigned int NumaAllocator::currentNode() const {
+	unsigned int node = mTopology.nodeOfCpu(mCpuSource());
+
+	return node < mNodes.size() ? node : 0;
+}
+
+const NumaArena& NumaAllocator::arena(unsigned int node) const {
+	return mNodes[node]->mArena;
+}
+
+const NumaTopology& NumaAllocator::topology() const {
+	return mTopology;
+}
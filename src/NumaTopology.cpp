@@ -0,0 +1,146 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file NumaTopology.cpp
+ */
+
+#include "../includes/NumaTopology.hpp"
+
+#include <cstdio>
+#include <thread>
+
+using namespace ondraluk;
+
+namespace {
+
+	/**
+	 * Parses a kernel cpu list like "0-3,8-11"
+	 */
+	bool readCpuList(const char* fname, std::vector<unsigned int>& cpus) {
+		std::FILE* file = std::fopen(fname, "r");
+
+		if(file == nullptr) {
+			return false;
+		}
+
+		unsigned int first;
+		unsigned int last;
+		char separator;
+
+		while(std::fscanf(file, "%u", &first) == 1) {
+			last = first;
+
+			separator = static_cast<char>(std::fgetc(file));
+			if(separator == '-') {
+				if(std::fscanf(file, "%u", &last) != 1) {
+					break;
+				}
+				separator = static_cast<char>(std::fgetc(file));
+			}
+
+			for(unsigned int cpu = first; cpu <= last; ++cpu) {
+				cpus.push_back(cpu);
+			}
+
+			if(separator != ',') {
+				break;
+			}
+		}
+
+		std::fclose(file);
+
+		return true;
+	}
+}
+
+NumaTopology::NumaTopology() : mSimulated(false) {
+}
+
+NumaTopology NumaTopology::detect() {
+	NumaTopology topology;
+
+#if defined(__linux__)
+	char fname[64];
+
+	for(unsigned int node = 0; ; ++node) {
+		std::vector<unsigned int> cpus;
+
+		std::snprintf(fname, sizeof(fname), "/sys/devices/system/node/node%u/cpulist", node);
+
+		if(!readCpuList(fname, cpus)) {
+			break;
+		}
+
+		for(size_t i = 0; i < cpus.size(); ++i) {
+			topology.add(cpus[i], node);
+		}
+
+		// memory only nodes have no cpus but still count
+		if(topology.mNodeToCpus.size() <= node) {
+			topology.mNodeToCpus.resize(node + 1);
+		}
+	}
+#endif
+
+	if(topology.mNodeToCpus.empty()) {
+		unsigned int cpus = std::thread::hardware_concurrency();
+
+		for(unsigned int cpu = 0; cpu < (cpus > 0 ? cpus : 1); ++cpu) {
+			topology.add(cpu, 0);
+		}
+	}
+
+	return topology;
+}
+
+NumaTopology NumaTopology::simulated(unsigned int nodes, unsigned int cpusPerNode) {
+	NumaTopology topology;
+	topology.mSimulated = true;
+
+	for(unsigned int node = 0; node < (nodes > 0 ? nodes : 1); ++node) {
+		for(unsigned int cpu = 0; cpu < cpusPerNode; ++cpu) {
+			topology.add(node * cpusPerNode + cpu, node);
+		}
+
+		if(topology.mNodeToCpus.size() <= node) {
+			topology.mNodeToCpus.resize(node + 1);
+		}
+	}
+
+	return topology;
+}
+
+void NumaTopology::add(unsigned int cpu, unsigned int node) {
+	if(mCpuToNode.size() <= cpu) {
+		mCpuToNode.resize(cpu + 1, 0);
+	}
+	if(mNodeToCpus.size() <= node) {
+		mNodeToCpus.resize(node + 1);
+	}
+
+	mCpuToNode[cpu] = node;
+	mNodeToCpus[node].push_back(cpu);
+}
+
+unsigned int NumaTopology::nodeCount() const {
+	return static_cast<unsigned int>(mNodeToCpus.size());
+}
+
+unsigned int NumaTopology::cpuCount() const {
+	return static_cast<unsigned int>(mCpuToNode.size());
+}
+
+unsigned int NumaTopology::nodeOfCpu(unsigned int cpu) const {
+	return cpu < mCpuToNode.size() ? mCpuToNode[cpu] : 0;
+}
+
+const std::vector<unsigned int>& NumaTopology::cpusOfNode(unsigned int node) const {
+	return mNodeToCpus[node < mNodeToCpus.size() ? node : 0];
+}
+
+bool NumaTopology::isSimulated() const {
+	return mSimulated;
+}
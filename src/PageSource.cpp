@@ -0,0 +1,195 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file PageSource.cpp
+ */
+
+#include "../includes/PageSource.hpp"
+
+#include <cstdint>
+#include <cstdio>
+
+#ifndef _WIN32
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
+
+using namespace ondraluk;
+
+namespace {
+
+	size_t roundUp(size_t size, size_t granularity) {
+		return (size + granularity - 1) / granularity * granularity;
+	}
+
+#ifndef _WIN32
+	void* mapAnonymous(size_t size, int extraFlags) {
+		void* mem = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extraFlags, -1, 0);
+		return mem == MAP_FAILED ? nullptr : mem;
+	}
+
+	// maps size bytes aligned to alignment by over-mapping and trimming both ends
+	void* mapAligned(size_t size, size_t alignment) {
+		unsigned char* mem = static_cast<unsigned char*>(mapAnonymous(size + alignment, 0));
+
+		if(mem == nullptr) {
+			return nullptr;
+		}
+
+		uintptr_t address = reinterpret_cast<uintptr_t>(mem);
+		uintptr_t aligned = (address + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+		size_t head = aligned - address;
+		size_t tail = alignment - head;
+
+		if(head > 0) {
+			::munmap(mem, head);
+		}
+		if(tail > 0) {
+			::munmap(reinterpret_cast<unsigned char*>(aligned) + size, tail);
+		}
+
+		return reinterpret_cast<void*>(aligned);
+	}
+#endif
+}
+
+PageRegion PageSource::acquire(size_t size, PAGEBACKEND::ENUM preferred) {
+	PageRegion region;
+
+	if(size == 0) {
+		size = 1;
+	}
+
+#ifndef _WIN32
+	size_t hugePage = hugePageSize();
+
+	if(preferred == PAGEBACKEND::MMAP_HUGETLB && hugePage > 0) {
+#ifdef MAP_HUGETLB
+		size_t hugeSize = roundUp(size, hugePage);
+
+		// fails unless enough huge pages are reserved in /proc/sys/vm/nr_hugepages
+		region.mMem = mapAnonymous(hugeSize, MAP_HUGETLB);
+
+		if(region.mMem != nullptr) {
+			region.mSize = hugeSize;
+			region.mBackend = PAGEBACKEND::MMAP_HUGETLB;
+			return region;
+		}
+#endif
+		preferred = PAGEBACKEND::MMAP_TRANSPARENT_HUGE;
+	}
+
+	if(preferred >= PAGEBACKEND::MMAP_TRANSPARENT_HUGE && hugePage > 0) {
+#ifdef MADV_HUGEPAGE
+		size_t hugeSize = roundUp(size, hugePage);
+
+		region.mMem = mapAligned(hugeSize, hugePage);
+
+		if(region.mMem != nullptr) {
+			region.mSize = hugeSize;
+
+			// fails if THP is disabled or not compiled in; the mapping still works with regular pages
+			if(::madvise(region.mMem, hugeSize, MADV_HUGEPAGE) == 0) {
+				region.mBackend = PAGEBACKEND::MMAP_TRANSPARENT_HUGE;
+			} else {
+				region.mBackend = PAGEBACKEND::MMAP;
+			}
+			return region;
+		}
+#endif
+		preferred = PAGEBACKEND::MMAP;
+	}
+
+	if(preferred >= PAGEBACKEND::MMAP) {
+		size_t pageSize = PageSource::pageSize();
+		size_t mappedSize = roundUp(size, pageSize);
+
+		region.mMem = mapAnonymous(mappedSize, 0);
+
+		if(region.mMem != nullptr) {
+			region.mSize = mappedSize;
+			region.mBackend = PAGEBACKEND::MMAP;
+			return region;
+		}
+	}
+#else
+	(void)preferred;
+#endif
+
+	region.mMem = ::malloc(size);
+	region.mSize = region.mMem != nullptr ? size : 0;
+	region.mBackend = PAGEBACKEND::MALLOC;
+
+	return region;
+}
+
+void PageSource::release(const PageRegion& region) {
+	if(region.mMem == nullptr) {
+		return;
+	}
+
+#ifndef _WIN32
+	if(region.mBackend != PAGEBACKEND::MALLOC) {
+		::munmap(region.mMem, region.mSize);
+		return;
+	}
+#endif
+
+	::free(region.mMem);
+}
+
+size_t PageSource::pageSize() {
+#ifndef _WIN32
+	static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	return size;
+#else
+	return 4096;
+#endif
+}
+
+size_t PageSource::hugePageSize() {
+#if defined(__linux__)
+	struct HugePageSize {
+		HugePageSize() : mSize(0) {
+			std::FILE* meminfo = std::fopen("/proc/meminfo", "r");
+
+			if(meminfo == nullptr) {
+				return;
+			}
+
+			char line[128];
+			unsigned long kilobytes;
+
+			while(std::fgets(line, sizeof(line), meminfo) != nullptr) {
+				if(std::sscanf(line, "Hugepagesize: %lu kB", &kilobytes) == 1) {
+					mSize = static_cast<size_t>(kilobytes) * 1024;
+					break;
+				}
+			}
+
+			std::fclose(meminfo);
+		}
+
+		size_t mSize;
+	};
+
+	static const HugePageSize hugePage;
+	return hugePage.mSize;
+#else
+	return 0;
+#endif
+}
+
+const char* PageSource::name(PAGEBACKEND::ENUM backend) {
+	switch(backend) {
+	case PAGEBACKEND::MALLOC:					return "malloc";
+	case PAGEBACKEND::MMAP:						return "mmap";
+	case PAGEBACKEND::MMAP_TRANSPARENT_HUGE:	return "mmap+MADV_HUGEPAGE";
+	case PAGEBACKEND::MMAP_HUGETLB:				return "mmap+MAP_HUGETLB";
+	}
+
+	return "unknown";
+}
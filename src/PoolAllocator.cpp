@@ -0,0 +1,151 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file PoolAllocator.cpp
+ */
+
+#include "../includes/PoolAllocator.hpp"
+#include "../includes/Sanitizer.hpp"
+
+using namespace ondraluk;
+
+PoolAllocator::PoolAllocator(size_t blockSize, size_t blockCount, PAGEBACKEND::ENUM backend) : mFreeList(nullptr), mUntouched(nullptr), mEnd(nullptr),
+	mBlockSize((blockSize + sizeof(FreeBlock) - 1) / sizeof(FreeBlock) * sizeof(FreeBlock)), mBlockCount(blockCount), mUsed(0), mGeneration(0) {
+	if(mBlockSize == 0) {
+		mBlockSize = sizeof(FreeBlock);
+	}
+
+	mRegion = PageSource::acquire(mBlockSize * mBlockCount, backend);
+	mUntouched = static_cast<unsigned char*>(mRegion.mMem);
+	mEnd = mUntouched != nullptr ? mUntouched + mBlockSize * mBlockCount : nullptr;
+
+	if(mUntouched != nullptr) {
+		ONDRALUK_POISON_MEMORY_REGION(mUntouched, mBlockSize * mBlockCount);
+	}
+}
+
+PoolAllocator::PoolAllocator(PoolAllocator&& other) : mRegion(other.mRegion), mFreeList(other.mFreeList), mUntouched(other.mUntouched), mEnd(other.mEnd),
+	mBlockSize(other.mBlockSize), mBlockCount(other.mBlockCount), mUsed(other.mUsed), mGeneration(other.mGeneration) {
+	other.mRegion = PageRegion();
+	other.mFreeList = nullptr;
+	other.mUntouched = nullptr;
+	other.mEnd = nullptr;
+	other.mBlockCount = 0;
+	other.mUsed = 0;
+}
+
+PoolAllocator::~PoolAllocator() {
+	if(mRegion.mMem != nullptr) {
+		ONDRALUK_UNPOISON_MEMORY_REGION(mRegion.mMem, mBlockSize * mBlockCount);
+	}
+
+	PageSource::release(mRegion);
+}
+
+void* PoolAllocator::allocate(size_t size) {
+	if(size > mBlockSize) {
+		return nullptr;
+	}
+
+	if(mFreeList != nullptr) {
+		FreeBlock* block = mFreeList;
+		ONDRALUK_UNPOISON_MEMORY_REGION(block, mBlockSize);
+		mFreeList = block->mNext;
+		++mUsed;
+		++mGeneration;
+		return block;
+	}
+
+	if(mUntouched == mEnd) {
+		return nullptr;
+	}
+
+	void* block = mUntouched;
+	mUntouched += mBlockSize;
+
+	ONDRALUK_UNPOISON_MEMORY_REGION(block, mBlockSize);
+	++mUsed;
+	++mGeneration;
+
+	return block;
+}
+
+void PoolAllocator::free(void* mem) {
+	if(mem == nullptr) {
+		return;
+	}
+
+	FreeBlock* block = static_cast<FreeBlock*>(mem);
+	block->mNext = mFreeList;
+	mFreeList = block;
+	--mUsed;
+	++mGeneration;
+
+	// the free list link is read back in allocate after unpoisoning
+	ONDRALUK_POISON_MEMORY_REGION(block, mBlockSize);
+}
+
+bool PoolAllocator::owns(const void* mem) const {
+	const unsigned char* address = static_cast<const unsigned char*>(mem);
+	const unsigned char* begin = static_cast<const unsigned char*>(mRegion.mMem);
+
+	return begin != nullptr && address >= begin && address < mEnd;
+}
+
+size_t PoolAllocator::blockSize() const {
+	return mBlockSize;
+}
+
+size_t PoolAllocator::blockCount() const {
+	return mBlockCount;
+}
+
+PAGEBACKEND::ENUM PoolAllocator::backend() const {
+	return mRegion.mBackend;
+}
+
+size_t PoolAllocator::used() const {
+	return mUsed;
+}
+
+size_t PoolAllocator::touched() const {
+	return mRegion.mMem != nullptr ? (mUntouched - static_cast<unsigned char*>(mRegion.mMem)) / mBlockSize : 0;
+}
+
+void PoolAllocator::blockStates(std::vector<bool>& used) const {
+	FreeListCursor cursor;
+
+	markFree(used, cursor, SIZE_MAX);
+}
+
+bool PoolAllocator::markFree(std::vector<bool>& used, FreeListCursor& cursor, size_t maxLinks) const {
+	const unsigned char* begin = static_cast<const unsigned char*>(mRegion.mMem);
+
+	if(!cursor.mStarted || cursor.mGeneration != mGeneration) {
+		used.assign(touched(), true);
+
+		cursor.mNext = mFreeList;
+		cursor.mGeneration = mGeneration;
+		cursor.mStarted = true;
+	}
+
+	for(size_t links = 0; links < maxLinks && cursor.mNext != nullptr; ++links) {
+		const FreeBlock* block = static_cast<const FreeBlock*>(cursor.mNext);
+
+		used[(reinterpret_cast<const unsigned char*>(block) - begin) / mBlockSize] = false;
+
+		// the link lives in a poisoned block
+		ONDRALUK_UNPOISON_MEMORY_REGION(block, sizeof(FreeBlock));
+		cursor.mNext = block->mNext;
+		ONDRALUK_POISON_MEMORY_REGION(block, sizeof(FreeBlock));
+	}
+
+	return cursor.mNext == nullptr;
+}
+
+uint64_t PoolAllocator::generation() const {
+	return mGeneration;
+}
@@ -0,0 +1,394 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file SharedMemoryAllocator.cpp
+ */
+
+#include "../includes/SharedMemoryAllocator.hpp"
+
+#include <cerrno>
+#include <new>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ondraluk {
+
+	/**
+	 * Start of every segment. Offsets are relative to the segment start, 0 means none.
+	 */
+	struct SharedSegmentHeader {
+		// written last by the creator, openers refuse segments without it
+		volatile uint32_t mMagic;
+		uint32_t mVersion;
+		uint64_t mSize;
+		uint64_t mFreeList;
+		uint64_t mRoot;
+		uint64_t mUsed;
+		// counts every allocate and free, lets walks notice changes
+		uint64_t mGeneration;
+		// set while allocate / free change the free list, see SegmentLock
+		uint32_t mModifying;
+		// the free list is not trusted anymore
+		uint32_t mPoisoned;
+		pthread_mutex_t mLock;
+	};
+}
+
+using namespace ondraluk;
+
+namespace {
+
+	const uint32_t MAGIC = 0x4F53484D;	// "OSHM"
+	const uint32_t VERSION = 3;
+
+	const uint64_t ALIGNMENT = 16;
+
+	/**
+	 * Header of every block, free or allocated; the payload follows it
+	 */
+	struct Block {
+		// whole block including this header
+		uint64_t mSize;
+		// next free block, only valid while the block is free
+		uint64_t mNext;
+	};
+
+	static_assert(sizeof(Block) % ALIGNMENT == 0, "Block header breaks the alignment");
+
+	// smallest block worth splitting off
+	const uint64_t MIN_BLOCK = sizeof(Block) + ALIGNMENT;
+
+	uint64_t roundUp(uint64_t size, uint64_t granularity) {
+		return (size + granularity - 1) / granularity * granularity;
+	}
+
+	const uint64_t HEAP_START = roundUp(sizeof(SharedSegmentHeader), 64);
+
+	/**
+	 * Locks the segment, recovers the lock if its owner died while holding it.
+	 *
+	 * allocate and free change the free list, the block headers and the counters in several stores. If the owner
+	 * died within such a change the list may be broken and can not be rebuilt (allocated blocks are not marked),
+	 * so the segment is poisoned: allocate fails and free is ignored from then on. An owner dying at any other
+	 * point, f.e. in a walk visitor, left nothing half done.
+	 */
+	class SegmentLock {
+	public:
+		explicit SegmentLock(SharedSegmentHeader* header) : mHeader(header) {
+			if(pthread_mutex_lock(&mHeader->mLock) == EOWNERDEAD) {
+				if(mHeader->mModifying != 0) {
+					mHeader->mPoisoned = 1;
+				}
+				pthread_mutex_consistent(&mHeader->mLock);
+			}
+		}
+
+		~SegmentLock() {
+			pthread_mutex_unlock(&mHeader->mLock);
+		}
+	private:
+		SharedSegmentHeader* mHeader;
+	};
+
+	/**
+	 * Marks a change of the free list for the next owner of the lock, see SegmentLock
+	 */
+	class Modification {
+	public:
+		explicit Modification(SharedSegmentHeader* header) : mHeader(header) {
+			mHeader->mModifying = 1;
+			// the process may die at any instruction, the compiler must not move a store of the change before
+			// the mark or after its removal; the next owner sees them through the mutex
+			__atomic_signal_fence(__ATOMIC_SEQ_CST);
+		}
+
+		~Modification() {
+			__atomic_signal_fence(__ATOMIC_SEQ_CST);
+			mHeader->mModifying = 0;
+		}
+	private:
+		SharedSegmentHeader* mHeader;
+	};
+}
+
+SharedMemoryAllocator::SharedMemoryAllocator(const char* name, SHMMODE::ENUM mode, size_t size) : mHeader(nullptr), mBase(nullptr), mSize(0) {
+	int fd;
+
+	if(mode == SHMMODE::CREATE) {
+		if(size < HEAP_START + MIN_BLOCK) {
+			return;
+		}
+
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+
+		size = static_cast<size_t>(roundUp(size, sysconf(_SC_PAGESIZE)));
+
+		if(fd >= 0 && ftruncate(fd, size) != 0) {
+			close(fd);
+			shm_unlink(name);
+			return;
+		}
+	} else {
+		fd = shm_open(name, O_RDWR, 0600);
+
+		struct stat info;
+		if(fd >= 0 && fstat(fd, &info) == 0) {
+			size = static_cast<size_t>(info.st_size);
+		}
+	}
+
+	if(fd < 0) {
+		return;
+	}
+
+	void* mem = size >= HEAP_START + MIN_BLOCK ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+
+	if(mem == MAP_FAILED) {
+		return;
+	}
+
+	mBase = static_cast<unsigned char*>(mem);
+	mSize = size;
+	mHeader = reinterpret_cast<SharedSegmentHeader*>(mBase);
+
+	if(mode == SHMMODE::CREATE) {
+		pthread_mutexattr_t attributes;
+		pthread_mutexattr_init(&attributes);
+		pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+		pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+		pthread_mutex_init(&mHeader->mLock, &attributes);
+		pthread_mutexattr_destroy(&attributes);
+
+		mHeader->mVersion = VERSION;
+		mHeader->mSize = size;
+		mHeader->mRoot = 0;
+		mHeader->mUsed = 0;
+		mHeader->mGeneration = 0;
+		mHeader->mModifying = 0;
+		mHeader->mPoisoned = 0;
+		mHeader->mFreeList = HEAP_START;
+
+		Block* block = reinterpret_cast<Block*>(mBase + HEAP_START);
+		block->mSize = (size - HEAP_START) / ALIGNMENT * ALIGNMENT;
+		block->mNext = 0;
+
+		__atomic_store_n(&mHeader->mMagic, MAGIC, __ATOMIC_RELEASE);
+	} else if(__atomic_load_n(&mHeader->mMagic, __ATOMIC_ACQUIRE) != MAGIC || mHeader->mVersion != VERSION || mHeader->mSize != size) {
+		munmap(mBase, mSize);
+		mBase = nullptr;
+		mHeader = nullptr;
+		mSize = 0;
+	}
+}
+
+SharedMemoryAllocator::SharedMemoryAllocator(SharedMemoryAllocator&& other) : mHeader(other.mHeader), mBase(other.mBase), mSize(other.mSize) {
+	other.mHeader = nullptr;
+	other.mBase = nullptr;
+	other.mSize = 0;
+}
+
+SharedMemoryAllocator::~SharedMemoryAllocator() {
+	if(mBase != nullptr) {
+		munmap(mBase, mSize);
+	}
+}
+
+bool SharedMemoryAllocator::isOpen() const {
+	return mHeader != nullptr;
+}
+
+void* SharedMemoryAllocator::allocate(size_t size) {
+	if(mHeader == nullptr) {
+		return nullptr;
+	}
+
+	uint64_t needed = roundUp(size > 0 ? size : 1, ALIGNMENT) + sizeof(Block);
+
+	SegmentLock lock(mHeader);
+
+	if(mHeader->mPoisoned != 0) {
+		return nullptr;
+	}
+
+	Modification modification(mHeader);
+
+	uint64_t* link = &mHeader->mFreeList;
+
+	while(*link != 0) {
+		Block* block = reinterpret_cast<Block*>(mBase + *link);
+
+		if(block->mSize >= needed) {
+			uint64_t offset = *link;
+
+			if(block->mSize - needed >= MIN_BLOCK) {
+				Block* rest = reinterpret_cast<Block*>(mBase + offset + needed);
+				rest->mSize = block->mSize - needed;
+				rest->mNext = block->mNext;
+
+				block->mSize = needed;
+				*link = offset + needed;
+			} else {
+				*link = block->mNext;
+			}
+
+			mHeader->mUsed += block->mSize;
+			++mHeader->mGeneration;
+
+			return reinterpret_cast<unsigned char*>(block) + sizeof(Block);
+		}
+
+		link = &block->mNext;
+	}
+
+	return nullptr;
+}
+
+void SharedMemoryAllocator::free(void* mem) {
+	if(mem == nullptr || mHeader == nullptr) {
+		return;
+	}
+
+	uint64_t offset = static_cast<unsigned char*>(mem) - mBase - sizeof(Block);
+	Block* block = reinterpret_cast<Block*>(mBase + offset);
+
+	SegmentLock lock(mHeader);
+
+	if(mHeader->mPoisoned != 0) {
+		return;
+	}
+
+	Modification modification(mHeader);
+
+	mHeader->mUsed -= block->mSize;
+	++mHeader->mGeneration;
+
+	// the free list is ordered by address, find the neighbours
+	uint64_t previous = 0;
+	uint64_t next = mHeader->mFreeList;
+
+	while(next != 0 && next < offset) {
+		previous = next;
+		next = reinterpret_cast<Block*>(mBase + next)->mNext;
+	}
+
+	block->mNext = next;
+
+	if(next != 0 && offset + block->mSize == next) {
+		Block* following = reinterpret_cast<Block*>(mBase + next);
+		block->mSize += following->mSize;
+		block->mNext = following->mNext;
+	}
+
+	if(previous == 0) {
+		mHeader->mFreeList = offset;
+		return;
+	}
+
+	Block* preceding = reinterpret_cast<Block*>(mBase + previous);
+
+	if(previous + preceding->mSize == offset) {
+		preceding->mSize += block->mSize;
+		preceding->mNext = block->mNext;
+	} else {
+		preceding->mNext = offset;
+	}
+}
+
+bool SharedMemoryAllocator::owns(const void* mem) const {
+	const unsigned char* address = static_cast<const unsigned char*>(mem);
+
+	return mBase != nullptr && address >= mBase + HEAP_START && address < mBase + mSize;
+}
+
+uint64_t SharedMemoryAllocator::offsetOf(const void* mem) const {
+	return mem != nullptr ? static_cast<const unsigned char*>(mem) - mBase : 0;
+}
+
+void* SharedMemoryAllocator::at(uint64_t offset) const {
+	return offset != 0 && offset < mSize ? mBase + offset : nullptr;
+}
+
+void SharedMemoryAllocator::setRoot(const void* root) {
+	if(mHeader != nullptr) {
+		__atomic_store_n(&mHeader->mRoot, offsetOf(root), __ATOMIC_RELEASE);
+	}
+}
+
+void* SharedMemoryAllocator::root() const {
+	return mHeader != nullptr ? at(__atomic_load_n(&mHeader->mRoot, __ATOMIC_ACQUIRE)) : nullptr;
+}
+
+size_t SharedMemoryAllocator::size() const {
+	return mSize;
+}
+
+size_t SharedMemoryAllocator::used() const {
+	if(mHeader == nullptr) {
+		return 0;
+	}
+
+	SegmentLock lock(mHeader);
+	return static_cast<size_t>(mHeader->mUsed);
+}
+
+bool SharedMemoryAllocator::poisoned() const {
+	if(mHeader == nullptr) {
+		return false;
+	}
+
+	SegmentLock lock(mHeader);
+	return mHeader->mPoisoned != 0;
+}
+
+bool SharedMemoryAllocator::walk(SharedHeapCursor& cursor, const BlockVisitor& visitor, size_t maxBlocks, bool& restarted) const {
+	restarted = false;
+
+	if(mHeader == nullptr) {
+		return true;
+	}
+
+	uint64_t heapEnd = HEAP_START + (mSize - HEAP_START) / ALIGNMENT * ALIGNMENT;
+
+	SegmentLock lock(mHeader);
+
+	if(mHeader->mPoisoned != 0) {
+		return true;
+	}
+
+	if(cursor.mOffset == 0 || cursor.mGeneration != mHeader->mGeneration) {
+		restarted = cursor.mOffset != 0;
+
+		cursor.mOffset = HEAP_START;
+		cursor.mNextFree = mHeader->mFreeList;
+		cursor.mGeneration = mHeader->mGeneration;
+
+		visitor(0, HEAP_START, true);
+	}
+
+	// the free list is ordered by address, so the next free block tells whether the current one is free
+	for(size_t visited = 0; visited < maxBlocks && cursor.mOffset < heapEnd; ++visited) {
+		const Block* block = reinterpret_cast<const Block*>(mBase + cursor.mOffset);
+		bool isFree = cursor.mOffset == cursor.mNextFree;
+
+		if(isFree) {
+			cursor.mNextFree = block->mNext;
+		}
+
+		visitor(cursor.mOffset, block->mSize, !isFree);
+		cursor.mOffset += block->mSize;
+	}
+
+	return cursor.mOffset >= heapEnd;
+}
+
+bool SharedMemoryAllocator::remove(const char* name) {
+	return shm_unlink(name) == 0;
+}
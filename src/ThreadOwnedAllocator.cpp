@@ -0,0 +1,271 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file ThreadOwnedAllocator.cpp
+ */
+
+#include "../includes/ThreadOwnedAllocator.hpp"
+
+#include <algorithm>
+
+using namespace ondraluk;
+
+const size_t ThreadOwnedAllocator::HEADER;
+const size_t ThreadOwnedAllocator::MIN_SMALL_SIZE;
+const size_t ThreadOwnedAllocator::MAX_SMALL_SIZE;
+const unsigned int ThreadOwnedAllocator::SIZE_CLASSES;
+
+namespace {
+
+	std::atomic<uint64_t> nextAllocatorId(1);
+
+}
+
+ThreadOwnedAllocator::Shared::Shared(size_t chunkSize, PAGEBACKEND::ENUM backend) : mId(nextAllocatorId.fetch_add(1)),
+	mChunkSize(std::max(chunkSize, HEADER + MAX_SMALL_SIZE)), mBackend(backend), mRemoteFreeCount(0), mDrainedCount(0) {
+
+}
+
+ThreadOwnedAllocator::Shared::~Shared() {
+	for(size_t i = 0; i < mChunks.size(); ++i) {
+		PageSource::release(mChunks[i]);
+	}
+}
+
+ThreadOwnedAllocator::ThreadOwnedAllocator(size_t chunkSize, PAGEBACKEND::ENUM backend) : mShared(std::make_shared<Shared>(chunkSize, backend)) {
+
+}
+
+ThreadOwnedAllocator::ThreadHeap* ThreadOwnedAllocator::threadHeap(bool create) {
+	struct Entry {
+		uint64_t mId;
+		std::weak_ptr<Shared> mShared;
+		ThreadHeap* mHeap;
+	};
+
+	// abandons the heaps of the thread when it exits
+	struct ThreadHeaps {
+		~ThreadHeaps() {
+			for(size_t i = 0; i < mEntries.size(); ++i) {
+				std::shared_ptr<Shared> shared = mEntries[i].mShared.lock();
+
+				if(shared) {
+					std::lock_guard<std::mutex> lock(shared->mLock);
+					mEntries[i].mHeap->mAbandoned = true;
+				}
+			}
+		}
+
+		std::vector<Entry> mEntries;
+	};
+
+	static thread_local ThreadHeaps heaps;
+
+	Shared& shared = *mShared;
+
+	for(size_t i = 0; i < heaps.mEntries.size(); ++i) {
+		if(heaps.mEntries[i].mId == shared.mId) {
+			return heaps.mEntries[i].mHeap;
+		}
+	}
+
+	if(!create) {
+		return nullptr;
+	}
+
+	// forget allocators destroyed in the meantime
+	heaps.mEntries.erase(std::remove_if(heaps.mEntries.begin(), heaps.mEntries.end(), [](const Entry& entry) {
+		return entry.mShared.expired();
+	}), heaps.mEntries.end());
+
+	ThreadHeap* heap = nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock(shared.mLock);
+
+		for(size_t i = 0; i < shared.mHeaps.size() && heap == nullptr; ++i) {
+			if(shared.mHeaps[i]->mAbandoned) {
+				heap = shared.mHeaps[i].get();
+				heap->mAbandoned = false;
+			}
+		}
+
+		if(heap == nullptr) {
+			shared.mHeaps.push_back(std::unique_ptr<ThreadHeap>(new ThreadHeap()));
+			heap = shared.mHeaps.back().get();
+		}
+	}
+
+	Entry entry;
+	entry.mId = shared.mId;
+	entry.mShared = mShared;
+	entry.mHeap = heap;
+	heaps.mEntries.push_back(entry);
+
+	return heap;
+}
+
+unsigned int ThreadOwnedAllocator::sizeClass(size_t size) {
+	unsigned int sizeClass = 0;
+
+	while((MIN_SMALL_SIZE << sizeClass) < size) {
+		++sizeClass;
+	}
+
+	return sizeClass;
+}
+
+void* ThreadOwnedAllocator::allocate(size_t size) {
+	if(size > MAX_SMALL_SIZE) {
+		unsigned char* mem = static_cast<unsigned char*>(::malloc(HEADER + size));
+
+		if(mem == nullptr) {
+			return nullptr;
+		}
+
+		BlockHeader* block = reinterpret_cast<BlockHeader*>(mem);
+		block->mOwner = nullptr;
+		block->mSizeClass = SIZE_CLASSES;
+
+		return mem + HEADER;
+	}
+
+	ThreadHeap* heap = threadHeap(true);
+	unsigned int sizeClass = ThreadOwnedAllocator::sizeClass(size);
+
+	if(heap->mRemoteFrees.load(std::memory_order_relaxed) != nullptr) {
+		drainRemoteFrees(*heap);
+	}
+
+	FreeBlock* free = heap->mLocalFrees[sizeClass];
+
+	if(free != nullptr) {
+		heap->mLocalFrees[sizeClass] = free->mNext;
+		return free;
+	}
+
+	size_t blockSize = HEADER + (MIN_SMALL_SIZE << sizeClass);
+
+	if(heap->mCurrent == nullptr || static_cast<size_t>(heap->mEnd - heap->mCurrent) < blockSize) {
+		if(!refill(*heap, blockSize)) {
+			return nullptr;
+		}
+	}
+
+	BlockHeader* block = reinterpret_cast<BlockHeader*>(heap->mCurrent);
+	block->mOwner = heap;
+	block->mSizeClass = sizeClass;
+
+	heap->mCurrent += blockSize;
+
+	return reinterpret_cast<unsigned char*>(block) + HEADER;
+}
+
+void ThreadOwnedAllocator::free(void* mem) {
+	if(mem == nullptr) {
+		return;
+	}
+
+	BlockHeader* block = header(mem);
+
+	if(block->mOwner == nullptr) {
+		::free(block);
+		return;
+	}
+
+	FreeBlock* free = static_cast<FreeBlock*>(mem);
+	ThreadHeap* owner = block->mOwner;
+
+	if(owner == threadHeap(false)) {
+		free->mNext = owner->mLocalFrees[block->mSizeClass];
+		owner->mLocalFrees[block->mSizeClass] = free;
+		return;
+	}
+
+	// Treiber push; the owner only ever takes the whole list, so there is no ABA on the head
+	FreeBlock* head = owner->mRemoteFrees.load(std::memory_order_relaxed);
+	do {
+		free->mNext = head;
+	} while(!owner->mRemoteFrees.compare_exchange_weak(head, free, std::memory_order_release, std::memory_order_relaxed));
+
+	mShared->mRemoteFreeCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ThreadOwnedAllocator::drainRemoteFrees(ThreadHeap& heap) {
+	FreeBlock* free = heap.mRemoteFrees.exchange(nullptr, std::memory_order_acquire);
+	size_t drained = 0;
+
+	while(free != nullptr) {
+		FreeBlock* next = free->mNext;
+		uint32_t sizeClass = header(free)->mSizeClass;
+
+		free->mNext = heap.mLocalFrees[sizeClass];
+		heap.mLocalFrees[sizeClass] = free;
+
+		free = next;
+		++drained;
+	}
+
+	mShared->mDrainedCount.fetch_add(drained, std::memory_order_relaxed);
+}
+
+bool ThreadOwnedAllocator::refill(ThreadHeap& heap, size_t blockSize) {
+	Shared& shared = *mShared;
+
+	PageRegion chunk = PageSource::acquire(shared.mChunkSize, shared.mBackend);
+
+	if(chunk.mMem == nullptr) {
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(shared.mLock);
+		shared.mChunks.push_back(chunk);
+	}
+
+	// the rest of the old chunk is too small for this class and stays unused
+	heap.mCurrent = static_cast<unsigned char*>(chunk.mMem);
+	heap.mEnd = heap.mCurrent + shared.mChunkSize;
+
+	return static_cast<size_t>(heap.mEnd - heap.mCurrent) >= blockSize;
+}
+
+bool ThreadOwnedAllocator::owns(const void* mem) const {
+	const unsigned char* address = static_cast<const unsigned char*>(mem);
+	std::lock_guard<std::mutex> lock(mShared->mLock);
+
+	for(size_t i = 0; i < mShared->mChunks.size(); ++i) {
+		const unsigned char* begin = static_cast<const unsigned char*>(mShared->mChunks[i].mMem);
+
+		if(address >= begin && address < begin + mShared->mChunkSize) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+size_t ThreadOwnedAllocator::heapCount() const {
+	std::lock_guard<std::mutex> lock(mShared->mLock);
+
+	return mShared->mHeaps.size();
+}
+
+size_t ThreadOwnedAllocator::abandonedHeaps() const {
+	std::lock_guard<std::mutex> lock(mShared->mLock);
+
+	return std::count_if(mShared->mHeaps.begin(), mShared->mHeaps.end(), [](const std::unique_ptr<ThreadHeap>& heap) {
+		return heap->mAbandoned;
+	});
+}
+
+size_t ThreadOwnedAllocator::remoteFrees() const {
+	return mShared->mRemoteFreeCount.load(std::memory_order_relaxed);
+}
+
+size_t ThreadOwnedAllocator::drainedFrees() const {
+	return mShared->mDrainedCount.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,151 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file VirtualArenaAllocator.cpp
+ */
+
+#include "../includes/VirtualArenaAllocator.hpp"
+#include "../includes/PageSource.hpp"
+
+#include <sys/mman.h>
+
+using namespace ondraluk;
+
+namespace {
+
+	size_t roundUp(size_t size, size_t granularity) {
+		return (size + granularity - 1) / granularity * granularity;
+	}
+}
+
+VirtualArenaAllocator::VirtualArenaAllocator(const VirtualArenaConfig& config) : mConfig(config), mMem(nullptr), mCurrent(nullptr), mCommitted(nullptr),
+	mEnd(nullptr), mPeak(0) {
+	size_t pageSize = PageSource::pageSize();
+
+	mConfig.mReserveSize = roundUp(mConfig.mReserveSize, pageSize);
+	mConfig.mCommitSize = roundUp(mConfig.mCommitSize > 0 ? mConfig.mCommitSize : pageSize, pageSize);
+	mConfig.mRetainSize = roundUp(mConfig.mRetainSize, pageSize);
+
+	if(mConfig.mRetainSize > mConfig.mReserveSize) {
+		mConfig.mRetainSize = mConfig.mReserveSize;
+	}
+
+	// MAP_NORESERVE: the range does not count against the overcommit limit until it is committed
+	void* mem = ::mmap(nullptr, mConfig.mReserveSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+	if(mem != MAP_FAILED) {
+		mMem = static_cast<unsigned char*>(mem);
+		mCurrent = mMem;
+		mCommitted = mMem;
+		mEnd = mMem + mConfig.mReserveSize;
+	}
+}
+
+VirtualArenaAllocator::VirtualArenaAllocator(VirtualArenaAllocator&& other) : mConfig(other.mConfig), mMem(other.mMem), mCurrent(other.mCurrent),
+	mCommitted(other.mCommitted), mEnd(other.mEnd), mPeak(other.mPeak) {
+	other.mMem = nullptr;
+	other.mCurrent = nullptr;
+	other.mCommitted = nullptr;
+	other.mEnd = nullptr;
+	other.mPeak = 0;
+}
+
+VirtualArenaAllocator::~VirtualArenaAllocator() {
+	if(mMem != nullptr) {
+		::munmap(mMem, mEnd - mMem);
+	}
+
+	mMem = nullptr;
+}
+
+bool VirtualArenaAllocator::commit(unsigned char* end) {
+	size_t needed = roundUp(end - mCommitted, mConfig.mCommitSize);
+
+	if(needed > static_cast<size_t>(mEnd - mCommitted)) {
+		needed = mEnd - mCommitted;
+	}
+
+	if(::mprotect(mCommitted, needed, PROT_READ | PROT_WRITE) != 0) {
+		return false;
+	}
+
+	mCommitted += needed;
+
+	return true;
+}
+
+void* VirtualArenaAllocator::allocate(size_t size) {
+	if(mMem == nullptr || size > static_cast<size_t>(mEnd - mCurrent)) {
+		return nullptr;
+	}
+
+	unsigned char* address = mCurrent;
+	unsigned char* next = mCurrent + size;
+
+	if(next > mCommitted && !commit(next)) {
+		return nullptr;
+	}
+
+	mCurrent = next;
+
+	if(used() > mPeak) {
+		mPeak = used();
+	}
+
+	return address;
+}
+
+void VirtualArenaAllocator::free(void* mem) {
+	mCurrent = static_cast<unsigned char*>(mem);
+}
+
+bool VirtualArenaAllocator::owns(const void* mem) const {
+	const unsigned char* address = static_cast<const unsigned char*>(mem);
+
+	return mMem != nullptr && address >= mMem && address < mEnd;
+}
+
+void VirtualArenaAllocator::reset() {
+	mCurrent = mMem;
+
+	unsigned char* retain = mMem + mConfig.mRetainSize;
+
+	if(mCommitted <= retain) {
+		return;
+	}
+
+	size_t excess = mCommitted - retain;
+
+	if(mConfig.mDecommit == DECOMMIT::FREE) {
+#ifdef MADV_FREE
+		// the pages stay committed from our point of view, the kernel takes them when it needs them
+		if(::madvise(retain, excess, MADV_FREE) == 0) {
+			return;
+		}
+#endif
+	}
+
+	::madvise(retain, excess, MADV_DONTNEED);
+	::mprotect(retain, excess, PROT_NONE);
+
+	mCommitted = retain;
+}
+
+size_t VirtualArenaAllocator::used() const {
+	return mCurrent - mMem;
+}
+
+size_t VirtualArenaAllocator::committed() const {
+	return mCommitted - mMem;
+}
+
+size_t VirtualArenaAllocator::reserved() const {
+	return mEnd - mMem;
+}
+
+size_t VirtualArenaAllocator::peak() const {
+	return mPeak;
+}
@@ -0,0 +1,68 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file AllocationTraceTest.cpp
+ */
+
+#include "Test.h"
+
+#include "../includes/MemoryManager.hpp"
+#include "../includes/MallocAllocator.hpp"
+#include "../includes/AllocationTrace.hpp"
+
+using namespace ondraluk;
+
+TEST(traceRoundTrip) {
+	{
+		MemoryManager<MallocAllocator, NoBoundsCheckingPolicy, TraceRecordingPolicy> manager(MallocAllocator(), NoBoundsCheckingPolicy(),
+			TraceRecordingPolicy(std::make_shared<AllocationTraceWriter>("AllocationTraceTest.trace")));
+
+		char* text = manager.allocate<char>(300);
+		double* value = manager.allocate<double>();
+		manager.deallocate<char, ARRAY::YES>(text);
+		manager.deallocate<double, ARRAY::NO>(value);
+	}
+
+	AllocationTraceReader reader("AllocationTraceTest.trace");
+	CHECK(reader.isOpen());
+
+	AllocationEvent events[5];
+	int count = 0;
+	while(count < 5 && reader.next(events[count])) {
+		++count;
+	}
+
+	CHECK(count == 4);
+
+	CHECK(events[0].mType == AllocationEvent::ALLOCATE);
+	CHECK(events[0].mId == 1);
+	CHECK(events[0].mSize == 300);
+	CHECK(events[0].mAlignment == 1);
+
+	CHECK(events[1].mType == AllocationEvent::ALLOCATE);
+	CHECK(events[1].mId == 2);
+	CHECK(events[1].mSize == sizeof(double));
+	CHECK(events[1].mAlignment == alignof(double));
+
+	CHECK(events[2].mType == AllocationEvent::FREE);
+	CHECK(events[2].mId == 1);
+	CHECK(events[3].mType == AllocationEvent::FREE);
+	CHECK(events[3].mId == 2);
+
+	CHECK(events[0].mTimestamp <= events[3].mTimestamp);
+	CHECK(events[0].mThread == 0 && events[3].mThread == 0);
+}
+
+TEST(rejectsForeignFiles) {
+	std::FILE* file = std::fopen("AllocationTraceTest.bogus", "wb");
+	std::fputs("not a trace", file);
+	std::fclose(file);
+
+	AllocationTraceReader reader("AllocationTraceTest.bogus");
+	CHECK(!reader.isOpen());
+}
+
+RUN_TESTS()
@@ -0,0 +1,219 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file ArenaSnapshotTest.cpp
+ */
+
+#include "Test.h"
+
+#include "../includes/ArenaSnapshot.hpp"
+#include "../includes/SharedMemoryAllocator.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include <unistd.h>
+
+using namespace ondraluk;
+
+namespace {
+
+	const char* SNAPSHOT = "ondraluk_test_snapshot.bin";
+
+	struct Entry {
+		int mKey;
+		const char* mName;
+		Entry* mNext;
+	};
+
+	struct Table {
+		Entry* mBuckets[8];
+	};
+
+	template <typename T>
+	T* create(LinearAllocator& arena) {
+		return new (arena.allocate(sizeof(T))) T();
+	}
+
+	const char* copyString(LinearAllocator& arena, const char* text) {
+		// the LinearAllocator does not align, keep the next Entry aligned
+		char* copy = static_cast<char*>(arena.allocate((std::strlen(text) + 1 + alignof(Entry) - 1) / alignof(Entry) * alignof(Entry)));
+		std::strcpy(copy, text);
+		return copy;
+	}
+
+	/**
+	 * 64 entries hashed into 8 buckets, every pointer registered for relocation
+	 */
+	Table* buildTable(LinearAllocator& arena, RelocationTable& relocations) {
+		Table* table = create<Table>(arena);
+
+		for(int i = 0; i < 8; ++i) {
+			table->mBuckets[i] = nullptr;
+			relocations.add(table->mBuckets[i]);
+		}
+
+		char name[16];
+		for(int key = 0; key < 64; ++key) {
+			Entry* entry = create<Entry>(arena);
+
+			std::snprintf(name, sizeof(name), "entry%d", key);
+			entry->mKey = key;
+			entry->mName = copyString(arena, name);
+			entry->mNext = table->mBuckets[key % 8];
+			table->mBuckets[key % 8] = entry;
+
+			relocations.add(entry->mName);
+			relocations.add(entry->mNext);
+		}
+
+		return table;
+	}
+
+	bool verifyTable(const Table* table) {
+		int found = 0;
+		char name[16];
+
+		for(int i = 0; i < 8; ++i) {
+			for(const Entry* entry = table->mBuckets[i]; entry != nullptr; entry = entry->mNext) {
+				std::snprintf(name, sizeof(name), "entry%d", entry->mKey);
+
+				if(entry->mKey % 8 != i || std::strcmp(entry->mName, name) != 0) {
+					return false;
+				}
+				++found;
+			}
+		}
+
+		return found == 64;
+	}
+}
+
+TEST(loadRelocatesPointers) {
+	LinearAllocator arena(1 << 16, PAGEBACKEND::MMAP);
+	RelocationTable relocations;
+
+	Table* table = buildTable(arena, relocations);
+	CHECK(ArenaSnapshot::save(SNAPSHOT, arena, table, relocations));
+
+	// the arena is still mapped, the snapshot has to go elsewhere
+	ArenaSnapshot snapshot(SNAPSHOT);
+
+	CHECK(snapshot.isOpen());
+	CHECK(snapshot.relocated());
+	CHECK(snapshot.size() == arena.used());
+	CHECK(snapshot.root<Table>() != table);
+	CHECK(verifyTable(snapshot.root<Table>()));
+
+	// the mapping is private, the original is untouched
+	CHECK(verifyTable(table));
+}
+
+TEST(loadAtOriginalAddress) {
+	const void* original;
+	{
+		LinearAllocator arena(1 << 16, PAGEBACKEND::MMAP);
+		RelocationTable relocations;
+
+		CHECK(ArenaSnapshot::save(SNAPSHOT, arena, buildTable(arena, relocations), relocations));
+		original = arena.data();
+	}
+
+	ArenaSnapshot snapshot(SNAPSHOT);
+
+	CHECK(snapshot.isOpen());
+	CHECK(verifyTable(snapshot.root<Table>()));
+	// only a hint, the kernel may still pick another address
+	CHECK(snapshot.relocated() == (snapshot.data() != original));
+
+	ArenaSnapshot moved(std::move(snapshot));
+	CHECK(!snapshot.isOpen());
+	CHECK(verifyTable(moved.root<Table>()));
+}
+
+TEST(offsetPointersNeedNoRelocations) {
+	struct Node {
+		int mValue;
+		OffsetPtr<Node> mNext;
+	};
+
+	LinearAllocator arena(4096);
+	Node* head = nullptr;
+
+	for(int i = 0; i < 5; ++i) {
+		Node* node = new (arena.allocate(sizeof(Node))) Node();
+		node->mValue = i;
+		node->mNext = head;
+		head = node;
+	}
+
+	CHECK(ArenaSnapshot::save(SNAPSHOT, arena, head, RelocationTable()));
+
+	ArenaSnapshot snapshot(SNAPSHOT);
+	int sum = 0;
+
+	for(Node* node = snapshot.root<Node>(); node != nullptr; node = node->mNext.get()) {
+		CHECK(snapshot.data() <= static_cast<void*>(node));
+		sum += node->mValue;
+	}
+
+	CHECK(sum == 10);
+}
+
+TEST(rejectsInvalidInput) {
+	LinearAllocator arena(4096);
+	RelocationTable relocations;
+
+	int outside = 0;
+	int** field = static_cast<int**>(arena.allocate(sizeof(int*)));
+	*field = &outside;
+	relocations.add(*field);
+
+	// the pointer leaves the arena
+	CHECK(!ArenaSnapshot::save(SNAPSHOT, arena, field, relocations));
+	// the root is not in the arena
+	CHECK(!ArenaSnapshot::save(SNAPSHOT, arena, &outside, RelocationTable()));
+
+	std::FILE* file = std::fopen(SNAPSHOT, "wb");
+	std::fputs("not a snapshot", file);
+	std::fclose(file);
+
+	CHECK(!ArenaSnapshot(SNAPSHOT).isOpen());
+	CHECK(!ArenaSnapshot("ondraluk_missing_snapshot.bin").isOpen());
+
+	std::remove(SNAPSHOT);
+}
+
+TEST(rejectsTruncatedAndCorruptFiles) {
+	LinearAllocator arena(4096);
+	RelocationTable relocations;
+	Table* table = buildTable(arena, relocations);
+
+	CHECK(ArenaSnapshot::save(SNAPSHOT, arena, table, relocations));
+	CHECK(ArenaSnapshot(SNAPSHOT).isOpen());
+
+	// a relocation count far beyond the file, offset of mRelocationCount in the header
+	std::FILE* file = std::fopen(SNAPSHOT, "r+b");
+	uint64_t count = ~static_cast<uint64_t>(0) / 2;
+	std::fseek(file, 40, SEEK_SET);
+	std::fwrite(&count, sizeof(count), 1, file);
+	std::fclose(file);
+
+	CHECK(!ArenaSnapshot(SNAPSHOT).isOpen());
+
+	// the region ends past the end of the file
+	CHECK(ArenaSnapshot::save(SNAPSHOT, arena, table, relocations));
+	CHECK(truncate(SNAPSHOT, static_cast<off_t>(PageSource::pageSize() + 64)) == 0);
+
+	CHECK(!ArenaSnapshot(SNAPSHOT).isOpen());
+
+	std::remove(SNAPSHOT);
+}
+
+RUN_TESTS()
@@ -0,0 +1,107 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file ComposableAllocatorsTest.cpp
+ */
+
+#include "Test.h"
+
+#include "../includes/ComposableAllocators.hpp"
+#include "../includes/LinearAllocator.hpp"
+#include "../includes/MallocAllocator.hpp"
+#include "../includes/MemoryManager.hpp"
+
+#include <cstring>
+
+using namespace ondraluk;
+
+namespace {
+
+	typedef Bucketizer<SizedPool<4>, 0, 64, 16> SmallBuckets;
+	typedef Segregator<64, SmallBuckets, LinearAllocator> Arenas;
+	typedef FallbackAllocator<Arenas, MallocAllocator> SubsystemAllocator;
+
+	SubsystemAllocator createSubsystemAllocator() {
+		return SubsystemAllocator(Arenas(SmallBuckets(), LinearAllocator(1024)));
+	}
+}
+
+TEST(fallbackUsesSecondaryWhenPrimaryIsExhausted) {
+	FallbackAllocator<LinearAllocator, MallocAllocator> allocator(LinearAllocator(64));
+
+	void* first = allocator.allocate(48);
+	void* second = allocator.allocate(48);
+
+	CHECK(allocator.primary().owns(first));
+	CHECK(!allocator.primary().owns(second));
+
+	// freed into the secondary, must not rewind the arena
+	allocator.free(second);
+	CHECK(allocator.allocate(16) != first);
+}
+
+TEST(segregatorRoutesBySize) {
+	Segregator<32, PoolAllocator, LinearAllocator> allocator(PoolAllocator(32, 8), LinearAllocator(1024));
+
+	void* small = allocator.allocate(32);
+	void* large = allocator.allocate(33);
+
+	CHECK(allocator.small().owns(small));
+	CHECK(allocator.large().owns(large));
+	CHECK(allocator.owns(small) && allocator.owns(large));
+
+	allocator.free(small);
+	CHECK(allocator.allocate(8) == small);
+}
+
+TEST(bucketizerSizeClasses) {
+	SmallBuckets buckets;
+
+	CHECK(SmallBuckets::BUCKETS == 4);
+	CHECK(SmallBuckets::bucketSize(0) == 16);
+	CHECK(SmallBuckets::bucketSize(3) == 64);
+
+	CHECK(buckets.allocate(0) == nullptr);
+	CHECK(buckets.allocate(65) == nullptr);
+
+	void* sixteen = buckets.allocate(16);
+	void* seventeen = buckets.allocate(17);
+
+	CHECK(buckets.bucket(0).owns(sixteen));
+	CHECK(buckets.bucket(1).owns(seventeen));
+	CHECK(buckets.bucket(1).blockSize() >= 32);
+
+	buckets.free(seventeen);
+	CHECK(buckets.allocate(32) == seventeen);
+}
+
+TEST(bucketizerFactory) {
+	Bucketizer<PoolAllocator, 0, 32, 8> buckets([](size_t size) { return PoolAllocator(size, 2, PAGEBACKEND::MMAP); });
+
+	CHECK(buckets.bucket(3).backend() == PAGEBACKEND::MMAP);
+	CHECK(buckets.allocate(30) != nullptr);
+	CHECK(buckets.allocate(30) != nullptr);
+	CHECK(buckets.allocate(30) == nullptr);
+}
+
+TEST(composedThroughMemoryManager) {
+	MemoryManager<SubsystemAllocator, BoundsCheckingPolicy<4, 0xEF> > manager(createSubsystemAllocator());
+
+	// pool, arena and malloc sized requests
+	char* small = manager.allocate<char>(8);
+	char* medium = manager.allocate<char>(200);
+	char* large = manager.allocate<char>(4096);
+
+	memset(small, 1, 8);
+	memset(medium, 2, 200);
+	memset(large, 3, 4096);
+
+	manager.deallocate<char, ARRAY::YES>(large);
+	manager.deallocate<char, ARRAY::YES>(medium);
+	manager.deallocate<char, ARRAY::YES>(small);
+}
+
+RUN_TESTS()
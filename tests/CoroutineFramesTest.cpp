@@ -0,0 +1,198 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file CoroutineFramesTest.cpp
+ */
+
+#include "Test.h"
+
+#include "../includes/CoroutineFrames.hpp"
+#include "../includes/LinearAllocator.hpp"
+
+#include <coroutine>
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+using namespace ondraluk;
+
+namespace {
+
+	/**
+	 * Lazy task returning an int, awaiting it runs it to completion
+	 */
+	struct Task {
+		struct promise_type : FramePromise<> {
+			int mValue = 0;
+			std::coroutine_handle<> mContinuation;
+
+			Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+			std::suspend_always initial_suspend() noexcept { return {}; }
+
+			struct FinalAwaiter {
+				bool await_ready() noexcept { return false; }
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+					std::coroutine_handle<> continuation = handle.promise().mContinuation;
+					return continuation ? continuation : std::noop_coroutine();
+				}
+				void await_resume() noexcept {}
+			};
+
+			FinalAwaiter final_suspend() noexcept { return {}; }
+			void return_value(int value) { mValue = value; }
+			void unhandled_exception() { throw; }
+		};
+
+		explicit Task(std::coroutine_handle<promise_type> handle) : mHandle(handle) {}
+		Task(Task&& other) : mHandle(std::exchange(other.mHandle, nullptr)) {}
+		~Task() {
+			if(mHandle) {
+				mHandle.destroy();
+			}
+		}
+
+		bool await_ready() { return false; }
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) {
+			mHandle.promise().mContinuation = continuation;
+			return mHandle;
+		}
+		int await_resume() { return mHandle.promise().mValue; }
+
+		int run() {
+			mHandle.resume();
+			return mHandle.promise().mValue;
+		}
+
+		const void* frame() const { return mHandle.address(); }
+
+		std::coroutine_handle<promise_type> mHandle;
+	};
+
+	Task leaf(int value) {
+		co_return value * 2;
+	}
+
+	Task chain(int depth) {
+		if(depth == 0) {
+			co_return co_await leaf(1);
+		}
+		int below = co_await chain(depth - 1);
+		co_return below + 1;
+	}
+
+	Task viaLeaf(int value) {
+		co_return co_await leaf(value);
+	}
+
+	Task bigFrame(int value) {
+		// the array lives in the frame because it is used across the suspension
+		volatile char buffer[8192];
+		buffer[0] = static_cast<char>(value);
+		int result = co_await leaf(value);
+		co_return result + buffer[0];
+	}
+}
+
+TEST(framesAreRecycled) {
+	FramePool<ThreadFramePool::Manager>& pool = ThreadFramePool::local();
+
+	CHECK(chain(8).run() == 10);
+
+	size_t misses = pool.misses();
+	size_t hits = pool.hits();
+
+	for(int i = 0; i < 100; ++i) {
+		CHECK(chain(8).run() == 10);
+	}
+
+	// every frame of the later runs comes from the cache
+	CHECK(pool.misses() == misses);
+	CHECK(pool.hits() == hits + 100 * 10);
+}
+
+TEST(framesAreAligned) {
+	Task task = leaf(21);
+	CHECK(reinterpret_cast<uintptr_t>(task.frame()) % FramePromise<>::FRAME_ALIGNMENT == 0);
+	CHECK(task.run() == 42);
+}
+
+TEST(largeFramesBypassTheCache) {
+	FramePool<ThreadFramePool::Manager>& pool = ThreadFramePool::local();
+	size_t misses = pool.misses();
+
+	CHECK(bigFrame(3).run() == 9);
+	CHECK(bigFrame(3).run() == 9);
+
+	// the big frame is too large for a bucket, the leaf is cached
+	CHECK(pool.misses() >= misses + 2);
+}
+
+TEST(arenaFrames) {
+	LinearAllocator arena(4096);
+	FramePool<ThreadFramePool::Manager>& pool = ThreadFramePool::local();
+
+	// warm the pool for the leaf
+	CHECK(leaf(1).run() == 2);
+	size_t misses = pool.misses();
+	size_t hits = pool.hits();
+
+	{
+		FrameArenaScope<LinearAllocator> frames(arena);
+
+		Task task = viaLeaf(5);
+		CHECK(arena.owns(task.frame()));
+		CHECK(reinterpret_cast<uintptr_t>(task.frame()) % FramePromise<>::FRAME_ALIGNMENT == 0);
+		// the leaf is created while running inside the scope, its frame is on the arena too
+		CHECK(task.run() == 10);
+	}
+
+	size_t used = arena.used();
+	CHECK(used > 0);
+	CHECK(pool.misses() == misses);
+	CHECK(pool.hits() == hits);
+
+	// outside of the scope the pool is used again
+	Task pooled = viaLeaf(1);
+	CHECK(!arena.owns(pooled.frame()));
+
+	// destroying the frames leaves the arena alone, it is reset per request
+	CHECK(arena.used() == used);
+	arena.free(const_cast<void*>(arena.data()));
+	CHECK(arena.used() == 0);
+
+	// scopes nest, out of arena memory throws
+	LinearAllocator tiny(64);
+	bool thrown = false;
+	{
+		FrameArenaScope<LinearAllocator> outer(arena);
+		{
+			FrameArenaScope<LinearAllocator> inner(tiny);
+			try {
+				viaLeaf(1);
+			} catch(const std::bad_alloc&) {
+				thrown = true;
+			}
+		}
+		Task onOuter = viaLeaf(2);
+		CHECK(arena.owns(onOuter.frame()));
+	}
+	CHECK(thrown);
+}
+
+TEST(framesFreedOnAnotherThread) {
+	Task task = chain(2);
+
+	std::thread other([&task]() {
+		CHECK(task.run() == 4);
+		// the frames go to the pool of this thread, which returns them to the manager when it ends
+		Task done = std::move(task);
+	});
+	other.join();
+
+	CHECK(!task.mHandle);
+}
+
+RUN_TESTS()
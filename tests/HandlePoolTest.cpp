@@ -0,0 +1,166 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file HandlePoolTest.cpp
+ */
+
+#include "Test.h"
+
+#include "../includes/HandlePool.hpp"
+#include "../includes/LinearAllocator.hpp"
+#include "../includes/MallocAllocator.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace ondraluk;
+
+namespace {
+
+	typedef MemoryManager<MallocAllocator, BoundsCheckingPolicy<4, 0xEF> > Manager;
+
+	struct Particle {
+		Particle(int id, const std::string& name) : mId(id), mName(name) { ++alive; }
+		Particle(Particle&& other) : mId(other.mId), mName(std::move(other.mName)) { ++alive; }
+		~Particle() { --alive; }
+
+		int mId;
+		std::string mName;
+
+		static int alive;
+	};
+
+	int Particle::alive = 0;
+}
+
+TEST(handleLayout) {
+	Handle32 small = Handle32::make(5, 3);
+	Handle64 large = Handle64::make(5, 3);
+
+	CHECK(Handle32::INDEX_BITS == 20 && Handle32::GENERATION_BITS == 12);
+	CHECK(Handle64::INDEX_BITS == 32 && Handle64::GENERATION_BITS == 32);
+	CHECK(small.index() == 5 && small.generation() == 3);
+	CHECK(large.index() == 5 && large.generation() == 3);
+	CHECK(Handle32().isNull());
+}
+
+TEST(staleHandlesDoNotResolve) {
+	Manager manager;
+	HandlePool<Particle, Manager> pool(manager, 8);
+
+	HandlePool<Particle, Manager>::Handle first = pool.create(1, "first");
+	CHECK(pool.get(first) != nullptr);
+	CHECK(pool.get(first)->mName == "first");
+
+	CHECK(pool.destroy(first));
+	CHECK(pool.get(first) == nullptr);
+	CHECK(!pool.destroy(first));
+
+	// the slot is reused with a new generation
+	HandlePool<Particle, Manager>::Handle second = pool.create(2, "second");
+	CHECK(second.index() == first.index());
+	CHECK(second != first);
+	CHECK(pool.get(first) == nullptr);
+	CHECK(pool.get(second)->mId == 2);
+}
+
+TEST(fullPoolReturnsNullHandle) {
+	Manager manager;
+	HandlePool<int, Manager, uint64_t> pool(manager, 2);
+
+	CHECK(!pool.create(1).isNull());
+	CHECK(!pool.create(2).isNull());
+	CHECK(pool.create(3).isNull());
+	CHECK(pool.get(HandlePool<int, Manager, uint64_t>::Handle()) == nullptr);
+}
+
+TEST(exhaustedManagerLeavesAnInvalidPool) {
+	typedef MemoryManager<LinearAllocator, BoundsCheckingPolicy<4, 0xEF> > LinearManager;
+
+	// room for the objects, not for the other three arrays
+	LinearManager manager(LinearAllocator(1024));
+	{
+		HandlePool<uint64_t, LinearManager> pool(manager, 100);
+
+		CHECK(!pool.isValid());
+		CHECK(pool.capacity() == 0);
+		CHECK(pool.create(1).isNull());
+		CHECK(pool.get(HandlePool<uint64_t, LinearManager>::Handle()) == nullptr);
+		CHECK(pool.compact(10) == 0);
+	}
+	CHECK(manager.allocator().used() == 0);
+
+	HandlePool<uint64_t, LinearManager> small(manager, 8);
+	CHECK(small.isValid());
+	CHECK(!small.create(1).isNull());
+}
+
+TEST(compactionClosesHolesIncrementally) {
+	Manager manager;
+	{
+		HandlePool<Particle, Manager> pool(manager, 16);
+		std::vector<HandlePool<Particle, Manager>::Handle> handles;
+
+		for(int i = 0; i < 10; ++i) {
+			handles.push_back(pool.create(i, std::to_string(i)));
+		}
+
+		pool.destroy(handles[1]);
+		pool.destroy(handles[3]);
+		pool.destroy(handles[5]);
+
+		CHECK(pool.size() == 7);
+		CHECK(pool.holes() == 3);
+		CHECK(pool.extent() == 10);
+
+		CHECK(pool.compact(2) == 2);
+		CHECK(pool.holes() == 1);
+		CHECK(pool.compact(5) == 1);
+		CHECK(pool.holes() == 0);
+		CHECK(pool.extent() == 7);
+
+		// handles survive the moves
+		for(int i = 0; i < 10; ++i) {
+			Particle* particle = pool.get(handles[i]);
+
+			if(i == 1 || i == 3 || i == 5) {
+				CHECK(particle == nullptr);
+			} else {
+				CHECK(particle != nullptr && particle->mId == i && particle->mName == std::to_string(i));
+			}
+		}
+
+		int sum = 0;
+		pool.forEach([&](Particle& particle) { sum += particle.mId; });
+		CHECK(sum == 45 - 1 - 3 - 5);
+		CHECK(Particle::alive == 7);
+	}
+	CHECK(Particle::alive == 0);
+}
+
+TEST(createFillsLowestHole) {
+	Manager manager;
+	HandlePool<int, Manager> pool(manager, 8);
+
+	HandlePool<int, Manager>::Handle handles[4];
+	for(int i = 0; i < 4; ++i) {
+		handles[i] = pool.create(i);
+	}
+
+	pool.destroy(handles[2]);
+	pool.destroy(handles[0]);
+
+	int* reused = pool.get(pool.create(42));
+	CHECK(reused == pool.get(handles[1]) - 1);
+	CHECK(pool.holes() == 1);
+
+	// destroying the tail trims trailing holes
+	pool.destroy(handles[3]);
+	CHECK(pool.holes() == 0);
+	CHECK(pool.extent() == 2);
+}
+
+RUN_TESTS()
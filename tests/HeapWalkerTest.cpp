@@ -0,0 +1,245 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file HeapWalkerTest.cpp
+ */
+
+#include "Test.h"
+
+#include "../includes/HeapWalker.hpp"
+#include "../includes/LinearAllocator.hpp"
+#include "../includes/PoolAllocator.hpp"
+#include "../includes/SharedMemoryAllocator.hpp"
+#include "../includes/VirtualArenaAllocator.hpp"
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace ondraluk;
+
+namespace {
+
+	std::string segmentName(const char* test) {
+		char name[64];
+		std::snprintf(name, sizeof(name), "/ondraluk_test_%s_%d", test, static_cast<int>(getpid()));
+		return name;
+	}
+}
+
+TEST(reportMergesAndMeasures) {
+	FragmentationReport report;
+	CHECK(report.externalFragmentation() == 0.0);
+
+	report.add(HeapBlock(0, 64, true));
+	report.add(HeapBlock(64, 96, false));
+	report.add(HeapBlock(160, 32, false));
+
+	CHECK(report.usedBytes() == 64);
+	CHECK(report.usedBlocks() == 1);
+	CHECK(report.freeBytes() == 128);
+	CHECK(report.freeBlocks() == 2);
+	CHECK(report.largestFree() == 96);
+	CHECK(report.externalFragmentation() == 0.25);
+	CHECK(report.freeHistogram(6) == 1);
+	CHECK(report.freeHistogram(5) == 1);
+
+	std::ostringstream text;
+	report.write(text);
+	CHECK(text.str().find("largest free 96") != std::string::npos);
+	CHECK(text.str().find("free >= 64: 1") != std::string::npos);
+}
+
+TEST(heapMapCells) {
+	HeapMap map(100, 10);
+	CHECK(map.cellSize() == 10);
+	CHECK(map.cells().size() == 10);
+
+	map.add(HeapBlock(0, 25, true));
+	map.add(HeapBlock(25, 50, false));
+	map.add(HeapBlock(95, 5, true));
+
+	CHECK(map.str() == "##5......5");
+
+	std::ostringstream json;
+	map.writeJson(json);
+	CHECK(json.str() == "{\"heapSize\": 100, \"cellSize\": 10, \"used\": [10, 10, 5, 0, 0, 0, 0, 0, 0, 5]}");
+}
+
+TEST(linearUsedAndFree) {
+	LinearAllocator allocator(1024);
+	allocator.allocate(256);
+
+	FragmentationReport report = analyze(allocator);
+	CHECK(report.usedBytes() == allocator.used());
+	CHECK(report.freeBytes() == 1024 - allocator.used());
+	CHECK(report.freeBlocks() == 1);
+	CHECK(report.externalFragmentation() == 0.0);
+}
+
+TEST(poolRunsAndTail) {
+	PoolAllocator pool(64, 16);
+	std::vector<void*> blocks;
+
+	for(int i = 0; i < 8; ++i) {
+		blocks.push_back(pool.allocate(64));
+	}
+
+	// every other block free: 4 single free slots below the untouched tail
+	for(int i = 1; i < 8; i += 2) {
+		pool.free(blocks[i]);
+	}
+
+	HeapWalker<PoolAllocator> walker(pool, 16);
+	walker.finish();
+
+	CHECK(walker.report().usedBlocks() == 4);
+	CHECK(walker.report().usedBytes() == 4 * 64);
+	// slot 7 merges with the untouched tail
+	CHECK(walker.report().freeBlocks() == 4);
+	CHECK(walker.report().largestFree() == 9 * 64);
+	CHECK(walker.map().str() == "#.#.#.#.........");
+
+	for(int i = 0; i < 8; i += 2) {
+		pool.free(blocks[i]);
+	}
+
+	CHECK(analyze(pool).freeBlocks() == 1);
+	CHECK(analyze(pool).externalFragmentation() == 0.0);
+}
+
+TEST(poolIncrementalRestartsOnChange) {
+	PoolAllocator pool(32, 64);
+	std::vector<void*> blocks;
+
+	for(int i = 0; i < 64; ++i) {
+		blocks.push_back(pool.allocate(32));
+	}
+	for(int i = 0; i < 64; i += 2) {
+		pool.free(blocks[i]);
+	}
+
+	HeapWalker<PoolAllocator> walker(pool);
+	CHECK(!walker.step(4));
+
+	// the free list changed under the walk
+	pool.free(blocks[1]);
+
+	size_t steps = 1;
+	while(!walker.step(4)) {
+		++steps;
+	}
+
+	CHECK(walker.restarts() == 1);
+	CHECK(steps > 8);
+	CHECK(walker.report().usedBlocks() == 31);
+	CHECK(walker.report().freeBytes() == 33 * 32);
+
+	// the same block states as the one shot walk
+	std::vector<bool> used;
+	pool.blockStates(used);
+	CHECK(used.size() == 64);
+	CHECK(!used[0] && !used[1] && used[3]);
+}
+
+TEST(busyPoolWalkCompletes) {
+	PoolAllocator pool(32, 64);
+	std::vector<void*> blocks;
+
+	for(int i = 0; i < 64; ++i) {
+		blocks.push_back(pool.allocate(32));
+	}
+	for(int i = 0; i < 64; i += 2) {
+		pool.free(blocks[i]);
+	}
+
+	// the pool changes between every two steps
+	HeapWalker<PoolAllocator> walker(pool, 64, 3);
+	size_t steps = 0;
+
+	while(!walker.step(2)) {
+		pool.free(pool.allocate(32));
+		++steps;
+		CHECK(steps < 100);
+	}
+
+	// the fourth restart finished in one go
+	CHECK(walker.restarts() == 4);
+	CHECK(steps == 4);
+	CHECK(walker.report().usedBlocks() == 32);
+	CHECK(walker.report().freeBytes() == 32 * 32);
+}
+
+TEST(virtualArenaCommitted) {
+	VirtualArenaConfig config;
+	config.mReserveSize = 64 << 20;
+	config.mCommitSize = 64 << 10;
+
+	VirtualArenaAllocator arena(config);
+	arena.allocate(1000);
+
+	FragmentationReport report = analyze(arena);
+	CHECK(report.usedBytes() == arena.used());
+	CHECK(report.usedBytes() + report.freeBytes() == arena.committed());
+}
+
+TEST(sharedMemoryBlocks) {
+	std::string name = segmentName("walker");
+	SharedMemoryAllocator allocator(name.c_str(), SHMMODE::CREATE, 1 << 16);
+	CHECK(allocator.isOpen());
+
+	void* a = allocator.allocate(100);
+	void* b = allocator.allocate(1000);
+	void* c = allocator.allocate(100);
+	CHECK(a && b && c);
+	allocator.free(b);
+
+	HeapWalker<SharedMemoryAllocator> walker(allocator);
+	walker.finish();
+
+	const FragmentationReport& report = walker.report();
+	CHECK(report.usedBytes() + report.freeBytes() == allocator.size());
+	// segment header, a and c
+	CHECK(report.usedBlocks() == 3);
+	CHECK(report.freeBlocks() == 2);
+	CHECK(report.externalFragmentation() > 0.0 && report.externalFragmentation() < 0.1);
+
+	// one block per step, an allocation in between starts over
+	walker.restart();
+	CHECK(!walker.step(1));
+	void* d = allocator.allocate(16);
+	while(!walker.step(1)) {}
+
+	CHECK(walker.restarts() == 1);
+	CHECK(walker.report().usedBlocks() == 4);
+	CHECK(walker.report().usedBytes() + walker.report().freeBytes() == allocator.size());
+
+	// another process busy allocating: restarts are bounded, the rest is walked under one lock
+	walker.restart();
+	size_t steps = 0;
+	size_t restarts = walker.restarts();
+
+	while(!walker.step(1)) {
+		allocator.free(allocator.allocate(32));
+		++steps;
+		CHECK(steps < 100);
+	}
+
+	CHECK(walker.restarts() - restarts == 5);
+	CHECK(walker.report().usedBlocks() == 4);
+	CHECK(walker.report().usedBytes() + walker.report().freeBytes() == allocator.size());
+
+	allocator.free(a);
+	allocator.free(c);
+	allocator.free(d);
+	CHECK(analyze(allocator).freeBlocks() == 1);
+	CHECK(SharedMemoryAllocator::remove(name.c_str()));
+}
+
+RUN_TESTS()
@@ -0,0 +1,148 @@
+/**
+ *  This file is part of the debuglib project
+ *  Copyright by Christian Ondracek
+ *  Contact: coder[at]paxi.at
+ */
+
+// the MemoryManager probes are compiled into this test regardless of ONDRALUK_INSTRUMENTATION
+#ifndef DEBUGLIB_INSTRUMENTATION
+#define DEBUGLIB_INSTRUMENTATION 1
+#endif
+#define ONDRALUK_TRACKING 0
+
+#include "Test.h"
+
+#include "../includes/Instrumentation.h"
+#include "../includes/MallocAllocator.hpp"
+#include "../includes/MemoryManager.hpp"
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace debuglib::instrument;
+
+namespace {
+
+	void timed(unsigned int probe, int times) {
+		for(int i = 0; i < times; ++i) {
+			ScopedTimer timer(probe);
+		}
+	}
+
+}
+
+TEST(bucketsKeepThreePercent) {
+	for(uint64_t value = 1; value < (static_cast<uint64_t>(1) << 40); value = value * 3 + 1) {
+		unsigned int bucket = LatencyHistogram::bucket(value);
+
+		CHECK(bucket < LatencyHistogram::BUCKETS);
+		CHECK(LatencyHistogram::bucketStart(bucket) <= value);
+		CHECK(value < LatencyHistogram::bucketStart(bucket) + LatencyHistogram::bucketWidth(bucket));
+		CHECK(LatencyHistogram::bucketWidth(bucket) * 32 <= value || value < LatencyHistogram::SUB_BUCKETS);
+	}
+}
+
+TEST(percentilesOfUniformValues) {
+	std::unique_ptr<LatencyHistogram> histogram(new LatencyHistogram());
+
+	for(uint64_t value = 1; value <= 10000; ++value) {
+		histogram->record(value);
+	}
+
+	CHECK(histogram->count() == 10000);
+	CHECK(histogram->min() == 1);
+	CHECK(histogram->max() == 10000);
+
+	uint64_t median = histogram->valueAtPercentile(50.0);
+	uint64_t p99 = histogram->valueAtPercentile(99.0);
+	CHECK(median > 4850 && median < 5150);
+	CHECK(p99 > 9600 && p99 < 10200);
+	CHECK(histogram->valueAtPercentile(100.0) == 10000);
+}
+
+TEST(threadsAreMerged) {
+	reset();
+	unsigned int id = probe("test::threads");
+	CHECK(probe("test::threads") == id);
+
+	std::vector<std::thread> threads;
+	for(int i = 0; i < 4; ++i) {
+		threads.push_back(std::thread(timed, id, 1000));
+	}
+	for(size_t i = 0; i < threads.size(); ++i) {
+		threads[i].join();
+	}
+
+	std::unique_ptr<LatencyHistogram> merged(new LatencyHistogram());
+	CHECK(histogram("test::threads", *merged));
+	CHECK(merged->count() == 4000);
+	CHECK(!histogram("test::unknown", *merged));
+}
+
+TEST(memoryManagerIsInstrumented) {
+	reset();
+	ondraluk::MemoryManager<ondraluk::MallocAllocator, BoundsCheckingPolicy<8, 0xEF> > manager;
+
+	for(int i = 0; i < 10; ++i) {
+		manager.deallocate<int, ondraluk::ARRAY::YES>(manager.allocate<int>(16));
+	}
+
+	const char* probes[] = { "MemoryManager::allocate", "MemoryManager::deallocate", "Allocator::allocate", "Allocator::free",
+							 "BoundsChecker::fill", "BoundsChecker::check" };
+	std::unique_ptr<LatencyHistogram> merged(new LatencyHistogram());
+
+	for(size_t i = 0; i < sizeof(probes) / sizeof(probes[0]); ++i) {
+		CHECK(histogram(probes[i], *merged));
+		CHECK(merged->count() == 10);
+	}
+
+	std::ostringstream text;
+	writeText(text);
+	CHECK(text.str().find("MemoryManager::allocate") != std::string::npos);
+	CHECK(text.str().find("p99.9") != std::string::npos);
+}
+
+TEST(longProbeNamesAreWrittenWhole) {
+	reset();
+	std::string name = "test::" + std::string(300, 'x');
+	timed(probe(name.c_str()), 3);
+
+	std::ostringstream text;
+	writeText(text);
+
+	size_t at = text.str().find(name);
+	CHECK(at != std::string::npos);
+	// the numbers follow the name on the same line
+	size_t end = text.str().find('\n', at);
+	CHECK(end != std::string::npos && end - at > name.size() + 60);
+}
+
+TEST(chromeTraceHoldsTheLastEvents) {
+	reset();
+	setTracing(true, 8);
+	CHECK(isTracing());
+
+	// a new thread gets a ring buffer with the new capacity
+	std::thread worker(timed, probe("test::trace"), 20);
+	worker.join();
+	setTracing(false);
+
+	std::ostringstream json;
+	writeChromeTrace(json);
+	std::string trace = json.str();
+
+	CHECK(trace.compare(0, 15, "{\"traceEvents\":") == 0);
+
+	size_t events = 0;
+	for(size_t at = trace.find("\"name\":\"test::trace\""); at != std::string::npos; at = trace.find("\"name\":\"test::trace\"", at + 1)) {
+		++events;
+	}
+	CHECK(events == 8);
+	CHECK(trace.find("\"ph\":\"X\"") != std::string::npos);
+	CHECK(trace.find("],\"displayTimeUnit\":\"ns\"}") != std::string::npos);
+}
+
+RUN_TESTS()
@@ -0,0 +1,223 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file IntrospectionServerTest.cpp
+ */
+
+#include "Test.h"
+
+#include "../includes/IntrospectionServer.hpp"
+#include "../includes/AllocationStatistics.hpp"
+#include "../includes/LinearAllocator.hpp"
+#include "../includes/Logger.h"
+#include "../includes/MallocAllocator.hpp"
+#include "../includes/MemoryManager.hpp"
+#include "../includes/PoolAllocator.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace ondraluk;
+
+namespace {
+
+	const char* SOCKET_PATH = "introspection_test.sock";
+
+	/**
+	 * Drops everything, holds back a fixed number of bytes
+	 */
+	struct NullOutputter {
+		void out(const char*) const {}
+		void flush() const {}
+		size_t pending() const { return 3; }
+	};
+
+	/**
+	 * Connected client sending one command at a time
+	 */
+	struct Client {
+		explicit Client(const char* path) : mFd(::socket(AF_UNIX, SOCK_STREAM, 0)) {
+			sockaddr_un address;
+			memset(&address, 0, sizeof(address));
+			address.sun_family = AF_UNIX;
+			strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+
+			if(::connect(mFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+				::close(mFd);
+				mFd = -1;
+			}
+		}
+
+		~Client() {
+			if(mFd >= 0) {
+				::close(mFd);
+			}
+		}
+
+		// reads until the empty line ending the answer
+		std::string ask(const std::string& command) {
+			std::string line = command + "\n";
+			if(mFd < 0 || ::send(mFd, line.data(), line.size(), 0) != static_cast<ssize_t>(line.size())) {
+				return "";
+			}
+
+			while(mPending.find("\n\n") == std::string::npos) {
+				char chunk[256];
+				ssize_t received = ::recv(mFd, chunk, sizeof(chunk), 0);
+
+				if(received <= 0) {
+					return "";
+				}
+				mPending.append(chunk, static_cast<size_t>(received));
+			}
+
+			size_t end = mPending.find("\n\n");
+			std::string answer = mPending.substr(0, end + 1);
+			mPending.erase(0, end + 2);
+
+			return answer;
+		}
+
+		int mFd;
+		std::string mPending;
+	};
+
+}
+
+TEST(servesProvidersOverTheSocket) {
+	std::shared_ptr<AllocationStatistics> statistics = std::make_shared<AllocationStatistics>();
+	MemoryManager<MallocAllocator, NoBoundsCheckingPolicy, StatisticsTrackingPolicy> manager((MallocAllocator()),
+		NoBoundsCheckingPolicy(), StatisticsTrackingPolicy(statistics));
+
+	int* values = manager.allocate<int>(4);
+	manager.deallocate<int, ARRAY::NO>(manager.allocate<int>());
+
+	// the arena is single threaded, its owner publishes the description
+	LinearAllocator arena(1024);
+	arena.allocate(100);
+	PublishedText arenaText;
+	arenaText.publish([&arena](std::ostream& out) { describe(out, arena); });
+
+	IntrospectionServer server;
+	server.addProvider("manager", [&statistics](std::ostream& out) { describe(out, *statistics); });
+	server.addProvider("arena", [&arenaText](std::ostream& out) { arenaText.write(out); });
+	CHECK(server.start(SOCKET_PATH));
+
+	Client client(SOCKET_PATH);
+	CHECK(client.mFd >= 0);
+
+	CHECK(client.ask("providers") == "arena\nmanager\n");
+	CHECK(client.ask("show manager").find("allocations 2 deallocations 1 live 1 peak live 2 bytes 20") != std::string::npos);
+	CHECK(client.ask("show arena") == "[arena]\nlinear: used 100 of 1024 (malloc)\n");
+	CHECK(client.ask("show nothing").compare(0, 6, "error:") == 0);
+	CHECK(client.ask("bogus").compare(0, 6, "error:") == 0);
+
+	manager.deallocate<int, ARRAY::YES>(values);
+}
+
+TEST(poolMapShowsOccupancy) {
+	PoolAllocator pool(16, 8);
+	void* blocks[6];
+
+	for(int i = 0; i < 6; ++i) {
+		blocks[i] = pool.allocate(16);
+	}
+	pool.free(blocks[1]);
+
+	std::ostringstream out;
+	describe(out, pool);
+	CHECK(out.str() == "pool: 5 of 8 blocks of 16 used, 6 touched, generation 7 (malloc)\n");
+
+	// the map is published by the owner, the provider only copies the text
+	PublishedText map;
+	IntrospectionServer server;
+	CHECK(server.start(SOCKET_PATH));
+	server.addProvider("pool", [&map](std::ostream& out) { map.write(out); });
+
+	Client client(SOCKET_PATH);
+	CHECK(client.ask("show pool") == "[pool]\n");
+
+	map.publish([&pool](std::ostream& out) { describeMap(out, pool); });
+	CHECK(client.ask("show pool") == "[pool]\n[#.####]\n");
+
+	pool.free(blocks[0]);
+	CHECK(client.ask("show pool") == "[pool]\n[#.####]\n");
+	map.publish([&pool](std::ostream& out) { describeMap(out, pool); });
+	CHECK(client.ask("show pool") == "[pool]\n[..####]\n");
+}
+
+TEST(changesLoggerSettings) {
+	debuglib::logdispatch::LoggerManager& logger = debuglib::logdispatch::LoggerMgr;
+
+	IntrospectionServer server;
+	CHECK(server.start(SOCKET_PATH));
+
+	Client client(SOCKET_PATH);
+
+	CHECK(client.ask("log level 3") == "ok\n");
+	CHECK(logger.level() == 3);
+	CHECK(client.ask("log channel 9 on") == "ok\n");
+	CHECK(logger.isChannelEnabled(9));
+	CHECK(client.ask("log sample 1 10") == "ok\n");
+	CHECK(logger.sampling(1) == 10);
+	CHECK(client.ask("log") == "level 3\nchannels 1 9\nsampling 1 10 1 1 1 1\n");
+	CHECK(client.ask("log channel 300 on").compare(0, 6, "error:") == 0);
+
+	CHECK(client.ask("log level 0") == "ok\n");
+	CHECK(client.ask("log channel 9 off") == "ok\n");
+	CHECK(client.ask("log sample 1 1") == "ok\n");
+	CHECK(client.ask("loggers") == "loggers 0\n");
+}
+
+TEST(loggersWhileLoggersComeAndGo) {
+	using namespace debuglib::logger;
+
+	IntrospectionServer server;
+	CHECK(server.start(SOCKET_PATH));
+	Client client(SOCKET_PATH);
+
+	std::atomic<bool> stop(false);
+	std::thread registering([&stop]() {
+		NullOutputter output;
+		while(!stop.load()) {
+			LoggerImpl<NoFilter, SimpleFormatter, NullOutputter> logger(NoFilter(), SimpleFormatter(), output);
+		}
+	});
+
+	for(int i = 0; i < 200; ++i) {
+		std::string answer = client.ask("loggers");
+		CHECK(answer.compare(0, 8, "loggers ") == 0);
+		// a logger gone between the count and its query reports 0
+		CHECK(answer.find("pending 1") == std::string::npos);
+	}
+
+	stop.store(true);
+	registering.join();
+
+	CHECK(client.ask("loggers") == "loggers 0\n");
+}
+
+TEST(stopRemovesTheSocket) {
+	IntrospectionServer server;
+	CHECK(server.start(SOCKET_PATH));
+	CHECK(!server.start(SOCKET_PATH));
+
+	// a connected but idle client must not block stop
+	Client client(SOCKET_PATH);
+	server.stop();
+
+	CHECK(!server.isRunning());
+	CHECK(::access(SOCKET_PATH, F_OK) != 0);
+}
+
+RUN_TESTS()
@@ -0,0 +1,69 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file LinearAllocatorTest.cpp
+ */
+
+#include "Test.h"
+
+#include "../includes/LinearAllocator.hpp"
+
+#include <utility>
+
+using namespace ondraluk;
+
+TEST(allocationsAreContiguous) {
+	LinearAllocator allocator(256);
+
+	byte* first = static_cast<byte*>(allocator.allocate(16));
+	byte* second = static_cast<byte*>(allocator.allocate(32));
+
+	CHECK(first != nullptr);
+	CHECK(second == first + 16);
+}
+
+TEST(exhaustedArenaReturnsNull) {
+	LinearAllocator allocator(64);
+
+	CHECK(allocator.allocate(48) != nullptr);
+	CHECK(allocator.allocate(32) == nullptr);
+	// a failed allocation does not consume anything
+	CHECK(allocator.allocate(8) != nullptr);
+}
+
+TEST(exactFitSucceeds) {
+	LinearAllocator allocator(64);
+
+	CHECK(allocator.allocate(64) != nullptr);
+	CHECK(allocator.allocate(1) == nullptr);
+}
+
+TEST(freeRewinds) {
+	LinearAllocator allocator(256);
+
+	allocator.allocate(16);
+	void* second = allocator.allocate(16);
+	allocator.allocate(16);
+
+	allocator.free(second);
+
+	CHECK(allocator.allocate(16) == second);
+}
+
+TEST(moveTransfersArena) {
+	LinearAllocator source(128);
+	void* first = source.allocate(16);
+
+	LinearAllocator target(std::move(source));
+
+	CHECK(source.allocate(16) == nullptr);
+	CHECK(target.allocate(16) != nullptr);
+
+	target.free(first);
+	CHECK(target.allocate(16) == first);
+}
+
+RUN_TESTS()
@@ -0,0 +1,192 @@
+/**
+ *  This file is part of the debuglib project
+ *  Copyright by Christian Ondracek
+ *  Contact: coder[at]paxi.at
+ */
+
+#include "Test.h"
+
+#include "../includes/Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+
+using namespace debuglib::logger;
+
+namespace {
+
+	/**
+	 * Collects everything logged into a string
+	 */
+	struct CaptureOutputter {
+		CaptureOutputter() : mText(std::make_shared<std::string>()) {}
+
+		void out(const char* msg) const {
+			mText->append(msg);
+		}
+
+		void flush() const {}
+
+		std::shared_ptr<std::string> mText;
+	};
+
+	bool isDigit(char c) {
+		return c >= '0' && c <= '9';
+	}
+}
+
+TEST(simpleFormatterAppendsNewline) {
+	CaptureOutputter capture;
+	LoggerImpl<NoFilter, SimpleFormatter, CaptureOutputter> logger(NoFilter(), SimpleFormatter(), capture);
+
+	LOG(1, INFO, "value %d and %s", 5, "text");
+
+	CHECK(*capture.mText == "value 5 and text\n");
+}
+
+TEST(longMessagesAreNotTruncated) {
+	CaptureOutputter capture;
+	LoggerImpl<NoFilter, SimpleFormatter, CaptureOutputter> logger(NoFilter(), SimpleFormatter(), capture);
+
+	std::string message(1000, 'x');
+	LOG(1, INFO, "%s", message.c_str());
+
+	CHECK(*capture.mText == message + "\n");
+}
+
+TEST(everyLoggerSeesTheArguments) {
+	CaptureOutputter first;
+	CaptureOutputter second;
+	LoggerImpl<NoFilter, SimpleFormatter, CaptureOutputter> firstLogger(NoFilter(), SimpleFormatter(), first);
+	LoggerImpl<NoFilter, SimpleFormatter, CaptureOutputter> secondLogger(NoFilter(), SimpleFormatter(), second);
+
+	LOG(1, INFO, "%d %d", 1, 2);
+
+	CHECK(*first.mText == "1 2\n");
+	CHECK(*second.mText == "1 2\n");
+}
+
+TEST(filtersDropMessages) {
+	CaptureOutputter capture;
+	LoggerImpl<LogLevelFilter, SimpleFormatter, CaptureOutputter> logger(LogLevelFilter(WARN), SimpleFormatter(), capture);
+
+	LOG(1, INFO, "dropped");
+	LOG(1, ERR, "kept");
+
+	CHECK(*capture.mText == "kept\n");
+}
+
+TEST(timeFormatterPrefixesTimestamp) {
+	CaptureOutputter capture;
+	LoggerImpl<NoFilter, TimeFormatter, CaptureOutputter> logger(NoFilter(), TimeFormatter("%Y-%m-%d %H:%M:%S", TimeFormatter::MICROSECONDS), capture);
+
+	LOG(1, INFO, "message");
+
+	// 2014-05-21 13:37:00.000042 message
+	const std::string& text = *capture.mText;
+	CHECK(text.size() == 26 + 1 + 8);
+	CHECK(isDigit(text[0]) && text[4] == '-' && text[10] == ' ' && text[13] == ':' && text[19] == '.');
+	for(int i = 20; i < 26; ++i) {
+		CHECK(isDigit(text[i]));
+	}
+	CHECK(text.compare(26, std::string::npos, " message\n") == 0);
+}
+
+TEST(timeFormattersWithDifferentFormatsKeepTheirCalendar) {
+	CaptureOutputter dates;
+	CaptureOutputter times;
+	LoggerImpl<NoFilter, TimeFormatter, CaptureOutputter> dateLogger(NoFilter(), TimeFormatter("%Y-%m-%d", TimeFormatter::SECONDS), dates);
+	LoggerImpl<NoFilter, TimeFormatter, CaptureOutputter> timeLogger(NoFilter(), TimeFormatter("%H:%M:%S", TimeFormatter::SECONDS), times);
+
+	// every message goes through both loggers, alternating between the formats
+	size_t refreshes = TimeFormatter::calendarRefreshes();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for(int i = 0; i < 1000; ++i) {
+		LOG(1, INFO, "message");
+	}
+
+	// one strftime per format and second, a slow (sanitized) run may cross a few seconds
+	long long seconds = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start).count();
+	CHECK(TimeFormatter::calendarRefreshes() - refreshes <= static_cast<size_t>(2 * (seconds + 2)));
+
+	CHECK(dates.mText->size() == 1000 * (10 + 9));
+	CHECK(times.mText->size() == 1000 * (8 + 9));
+	CHECK((*dates.mText)[4] == '-' && (*times.mText)[2] == ':');
+}
+
+TEST(eventsAreFormattedAsKeyValue) {
+	CaptureOutputter capture;
+	LoggerImpl<NoFilter, SimpleFormatter, CaptureOutputter> logger(NoFilter(), SimpleFormatter(), capture);
+
+	LOG_EVENT(1, INFO, "alloc", LogField("size", 16u), LogField("count", -2), LogField("kind", "pool"), LogField("ok", true));
+
+	CHECK(*capture.mText == "alloc size=16 count=-2 kind=pool ok=true\n");
+}
+
+TEST(jsonLinesEscapeStrings) {
+	CaptureOutputter capture;
+	LoggerImpl<NoFilter, JsonLinesFormatter, CaptureOutputter> logger(NoFilter(), JsonLinesFormatter(), capture);
+
+	LOG(1, INFO, "quote \" backslash \\ newline \n");
+
+	const std::string& text = *capture.mText;
+	CHECK(text.compare(0, 6, "{\"ts\":") == 0);
+	CHECK(text.find(",\"msg\":\"quote \\\" backslash \\\\ newline \\n\"}\n") != std::string::npos);
+}
+
+TEST(jsonLinesSerializeFields) {
+	CaptureOutputter capture;
+	LoggerImpl<NoFilter, JsonLinesFormatter, CaptureOutputter> logger(NoFilter(), JsonLinesFormatter(), capture);
+
+	LOG_EVENT(1, WARN, "alloc", LogField("size", 16u), LogField("ratio", 0.5), LogField("name", "a\tb"));
+
+	const std::string& text = *capture.mText;
+	CHECK(text.find(",\"level\":3,\"channel\":1,\"event\":\"alloc\",\"size\":16,\"ratio\":0.5,\"name\":\"a\\tb\"}\n") != std::string::npos);
+}
+
+TEST(levelAndChannelsChangeAtRuntime) {
+	CaptureOutputter capture;
+	LoggerImpl<NoFilter, SimpleFormatter, CaptureOutputter> logger(NoFilter(), SimpleFormatter(), capture);
+	debuglib::logdispatch::LoggerManager& manager = debuglib::logdispatch::LoggerMgr;
+
+	manager.setLevel(WARN);
+	LOG(1, INFO, "dropped");
+	LOG(1, WARN, "kept");
+	manager.setLevel(UNDEFINED);
+
+	manager.enableChannel(7);
+	LOG(7, INFO, "channel 7");
+	manager.enableChannel(7, false);
+	LOG(7, INFO, "dropped");
+	CHECK(!manager.isChannelEnabled(7));
+
+	// out of range channels are never enabled
+	manager.enableChannel(debuglib::logdispatch::LoggerManager::MAX_CHANNELS);
+	LOG(debuglib::logdispatch::LoggerManager::MAX_CHANNELS, INFO, "dropped");
+
+	CHECK(*capture.mText == "kept\nchannel 7\n");
+}
+
+TEST(samplingDispatchesEveryNthMessage) {
+	CaptureOutputter capture;
+	LoggerImpl<NoFilter, SimpleFormatter, CaptureOutputter> logger(NoFilter(), SimpleFormatter(), capture);
+	debuglib::logdispatch::LoggerManager& manager = debuglib::logdispatch::LoggerMgr;
+
+	manager.setSampling(DEBUG, 4);
+	for(int i = 0; i < 12; ++i) {
+		LOG(1, DEBUG, "d");
+		LOG(1, ERR, "e");
+	}
+	manager.setSampling(DEBUG, 1);
+
+	std::string& text = *capture.mText;
+	CHECK(std::count(text.begin(), text.end(), 'd') == 3);
+	CHECK(std::count(text.begin(), text.end(), 'e') == 12);
+	CHECK(manager.sampling(DEBUG) == 1);
+}
+
+RUN_TESTS()
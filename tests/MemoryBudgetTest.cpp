@@ -0,0 +1,142 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file MemoryBudgetTest.cpp
+ */
+
+#include "Test.h"
+
+#include "../includes/MemoryBudget.hpp"
+#include "../includes/MallocAllocator.hpp"
+
+#include <thread>
+#include <vector>
+
+using namespace ondraluk;
+
+TEST(usageRollsUpToParents) {
+	MemoryBudget root("process", MemoryBudget::UNLIMITED);
+	MemoryBudget render("render", 1000, &root);
+	MemoryBudget textures("textures", 600, &render);
+
+	CHECK(textures.reserve(500));
+	CHECK(render.reserve(100));
+
+	CHECK(textures.used() == 500);
+	CHECK(render.used() == 600);
+	CHECK(root.used() == 600);
+
+	textures.release(500);
+	CHECK(render.used() == 100);
+	CHECK(root.used() == 100);
+	CHECK(textures.peak() == 500);
+}
+
+TEST(parentLimitRejectsWithoutAccounting) {
+	MemoryBudget root("process", 1000);
+	MemoryBudget audio("audio", MemoryBudget::UNLIMITED, &root);
+
+	CHECK(audio.reserve(800));
+	CHECK(!audio.reserve(300));
+
+	CHECK(audio.used() == 800);
+	CHECK(root.used() == 800);
+	CHECK(root.rejected() == 1);
+	CHECK(audio.rejected() == 0);
+}
+
+TEST(callbackCanTrimAndRetry) {
+	MemoryBudget* cacheBudget = nullptr;
+	int calls = 0;
+
+	MemoryBudget root("process", 1000, nullptr, [&](MemoryBudget& exceeded, size_t requested) {
+		++calls;
+		CHECK(&exceeded != cacheBudget && requested == 400);
+
+		// trim the cache
+		cacheBudget->release(500);
+		return BUDGETACTION::RETRY;
+	});
+
+	MemoryBudget cache("cache", MemoryBudget::UNLIMITED, &root);
+	MemoryBudget physics("physics", MemoryBudget::UNLIMITED, &root);
+	cacheBudget = &cache;
+
+	CHECK(cache.reserve(800));
+	CHECK(physics.reserve(400));
+
+	CHECK(calls == 1);
+	CHECK(cache.used() == 300);
+	CHECK(root.used() == 700);
+}
+
+TEST(callbackCanAllow) {
+	MemoryBudget budget("soft", 100, nullptr, [](MemoryBudget&, size_t) { return BUDGETACTION::ALLOW; });
+
+	CHECK(budget.reserve(150));
+	CHECK(budget.used() == 150);
+	CHECK(budget.peak() == 150);
+}
+
+TEST(snapshotReturnsTree) {
+	MemoryBudget root("process", 4096);
+	MemoryBudget render("render", 2048, &root);
+	{
+		MemoryBudget scratch("scratch", 128, &render);
+		scratch.reserve(64);
+
+		MemoryBudget::Snapshot snapshot = root.snapshot();
+
+		CHECK(snapshot.mName == "process" && snapshot.mUsed == 64 && snapshot.mLimit == 4096);
+		CHECK(snapshot.mChildren.size() == 1);
+		CHECK(snapshot.mChildren[0].mChildren.size() == 1);
+		CHECK(snapshot.mChildren[0].mChildren[0].mName == "scratch");
+	}
+
+	// destroyed children give their usage back
+	CHECK(root.snapshot().mChildren[0].mChildren.empty());
+	CHECK(root.used() == 0);
+}
+
+TEST(budgetedMemoryManager) {
+	MemoryBudget root("process", 256);
+	BudgetedMemoryManager<MallocAllocator> manager((BudgetedAllocator<MallocAllocator>(root)));
+
+	int* values = manager.allocate<int>(16);
+	CHECK(values != nullptr);
+	CHECK(root.used() > 16 * sizeof(int));
+
+	// header, size and payload do not fit anymore
+	CHECK(manager.allocate<int>(64) == nullptr);
+
+	manager.deallocate<int, ARRAY::YES>(values);
+	CHECK(root.used() == 0);
+}
+
+TEST(concurrentAccountingNeverExceedsLimit) {
+	MemoryBudget root("process", 64 * 1000);
+	std::vector<std::thread> threads;
+
+	for(int t = 0; t < 4; ++t) {
+		threads.push_back(std::thread([&root]() {
+			for(int i = 0; i < 10000; ++i) {
+				if(root.reserve(64)) {
+					CHECK(root.used() <= 64 * 1000);
+					root.release(64);
+				}
+			}
+		}));
+	}
+
+	for(size_t t = 0; t < threads.size(); ++t) {
+		threads[t].join();
+	}
+
+	CHECK(root.used() == 0);
+	CHECK(root.peak() <= 64 * 1000);
+}
+
+RUN_TESTS()
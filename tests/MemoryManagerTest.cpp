@@ -0,0 +1,253 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file MemoryManagerTest.cpp
+ */
+
+#include "Test.h"
+
+#include "../includes/MemoryManager.hpp"
+#include "../includes/LinearAllocator.hpp"
+#include "../includes/MallocAllocator.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+using namespace ondraluk;
+
+namespace {
+
+	struct Counted {
+		Counted() : mValue(42) { ++constructed; }
+		~Counted() { ++destructed; }
+
+		int mValue;
+
+		static int constructed;
+		static int destructed;
+	};
+
+	int Counted::constructed = 0;
+	int Counted::destructed = 0;
+
+	/**
+	 * Records the destruction order, throws from the constructor once the budget is used up
+	 */
+	struct Ordered {
+		Ordered() : mIndex(constructed) {
+			if(constructed == throwAt) {
+				throw std::runtime_error("constructor failed");
+			}
+			++constructed;
+		}
+		~Ordered() { destroyed.push_back(mIndex); }
+
+		int mIndex;
+
+		static int constructed;
+		static int throwAt;
+		static std::vector<int> destroyed;
+	};
+
+	int Ordered::constructed = 0;
+	int Ordered::throwAt = -1;
+	std::vector<int> Ordered::destroyed;
+
+	void resetOrdered(int throwAt) {
+		Ordered::constructed = 0;
+		Ordered::throwAt = throwAt;
+		Ordered::destroyed.clear();
+	}
+
+	// trivial default constructor, non trivial destructor
+	struct TrivialConstruction {
+		~TrivialConstruction() { ++destructed; }
+
+		int mValue;
+
+		static int destructed;
+	};
+
+	int TrivialConstruction::destructed = 0;
+
+	// user provided constructor which leaves the member alone
+	struct Uninitialized {
+		Uninitialized() {}
+
+		int mValue;
+	};
+
+	void resetCounters() {
+		Counted::constructed = 0;
+		Counted::destructed = 0;
+	}
+
+	struct CountingTracker {
+		CountingTracker() : mAllocations(new int(0)), mDeallocations(new int(0)), mLastSize(new size_t(0)) {}
+
+		void onAllocate(const void*, size_t size, size_t) const {
+			++*mAllocations;
+			*mLastSize = size;
+		}
+
+		void onDeallocate(const void*) const {
+			++*mDeallocations;
+		}
+
+		std::shared_ptr<int> mAllocations;
+		std::shared_ptr<int> mDeallocations;
+		std::shared_ptr<size_t> mLastSize;
+	};
+}
+
+TEST(podRoundTrip) {
+	MemoryManager<LinearAllocator, BoundsCheckingPolicy<4, 0xEF> > manager(LinearAllocator(1024));
+
+	int* value = manager.allocate<int>();
+	*value = 7;
+	CHECK(*value == 7);
+	manager.deallocate<int, ARRAY::NO>(value);
+
+	char* text = manager.allocate<char>(10);
+	for(int i = 0; i < 10; ++i) {
+		text[i] = 'a';
+	}
+	manager.deallocate<char, ARRAY::YES>(text);
+}
+
+TEST(singleObjectIsConstructedAndDestructed) {
+	resetCounters();
+	MemoryManager<MallocAllocator, NoBoundsCheckingPolicy> manager;
+
+	Counted* counted = manager.allocate<Counted>();
+	CHECK(Counted::constructed == 1);
+	CHECK(counted->mValue == 42);
+
+	manager.deallocate<Counted, ARRAY::NO>(counted);
+	CHECK(Counted::destructed == 1);
+}
+
+TEST(arrayElementsAreConstructed) {
+	resetCounters();
+	MemoryManager<LinearAllocator, BoundsCheckingPolicy<4, 0xEF> > manager(LinearAllocator(2000));
+
+	Counted* counted = manager.allocate<Counted>(10);
+	CHECK(Counted::constructed == 10);
+
+	for(int i = 0; i < 10; ++i) {
+		CHECK(counted[i].mValue == 42);
+	}
+
+	manager.deallocate<Counted, ARRAY::YES>(counted);
+}
+
+TEST(arrayIsDestroyedInReverseOrder) {
+	resetOrdered(-1);
+	MemoryManager<MallocAllocator, BoundsCheckingPolicy<8, 0xEF> > manager;
+
+	Ordered* ordered = manager.allocate<Ordered>(5);
+	manager.deallocate<Ordered, ARRAY::YES>(ordered);
+
+	// element 0 included
+	CHECK(Ordered::destroyed.size() == 5);
+	for(int i = 0; i < 5 && i < static_cast<int>(Ordered::destroyed.size()); ++i) {
+		CHECK(Ordered::destroyed[i] == 4 - i);
+	}
+}
+
+TEST(throwingConstructorUnwinds) {
+	resetOrdered(3);
+	MemoryManager<LinearAllocator, BoundsCheckingPolicy<8, 0xEF> > manager(LinearAllocator(1024));
+
+	char* before = manager.allocate<char>(8);
+	manager.deallocate<char, ARRAY::YES>(before);
+
+	bool thrown = false;
+	try {
+		manager.allocate<Ordered>(10);
+	} catch(const std::runtime_error&) {
+		thrown = true;
+	}
+
+	CHECK(thrown);
+	CHECK(Ordered::destroyed.size() == 3);
+	CHECK(Ordered::destroyed.size() == 3 && Ordered::destroyed[0] == 2 && Ordered::destroyed[2] == 0);
+
+	// the memory went back to the allocator
+	CHECK(manager.allocate<char>(8) == before);
+}
+
+TEST(trivialTypesSkipTheLoops) {
+	TrivialConstruction::destructed = 0;
+	MemoryManager<MallocAllocator, NoBoundsCheckingPolicy> manager;
+
+	TrivialConstruction* values = manager.allocate<TrivialConstruction>(4);
+	manager.deallocate<TrivialConstruction, ARRAY::YES>(values);
+
+	CHECK(TrivialConstruction::destructed == 4);
+	CHECK(has_allocate_zeroed<MallocAllocator>::value);
+	CHECK(!has_allocate_zeroed<LinearAllocator>::value);
+}
+
+TEST(zeroFill) {
+	MemoryManager<LinearAllocator, BoundsCheckingPolicy<4, 0xEF> > arena(LinearAllocator(1024));
+
+	// dirty the arena first
+	int* dirty = arena.allocate<int>(64);
+	for(int i = 0; i < 64; ++i) {
+		dirty[i] = -1;
+	}
+	arena.deallocate<int, ARRAY::YES>(dirty);
+
+	int* zeroed = arena.allocate<int>(64, INIT::ZERO);
+	CHECK(zeroed == dirty);
+
+	bool allZero = true;
+	for(int i = 0; i < 64; ++i) {
+		allZero = allZero && zeroed[i] == 0;
+	}
+	CHECK(allZero);
+	arena.deallocate<int, ARRAY::YES>(zeroed);
+
+	// through calloc, the constructor runs on zeroed memory
+	MemoryManager<MallocAllocator, BoundsCheckingPolicy<8, 0xEF> > heap;
+	Uninitialized* objects = heap.allocate<Uninitialized>(1000, INIT::ZERO);
+
+	allZero = true;
+	for(int i = 0; i < 1000; ++i) {
+		allZero = allZero && objects[i].mValue == 0;
+	}
+	CHECK(allZero);
+	heap.deallocate<Uninitialized, ARRAY::YES>(objects);
+}
+
+TEST(deallocationRewindsLinearAllocator) {
+	MemoryManager<LinearAllocator, BoundsCheckingPolicy<4, 0xEF> > manager(LinearAllocator(256));
+
+	char* first = manager.allocate<char>(16);
+	manager.deallocate<char, ARRAY::YES>(first);
+
+	CHECK(manager.allocate<char>(16) == first);
+}
+
+TEST(trackerSeesEveryAllocation) {
+	CountingTracker tracker;
+	MemoryManager<MallocAllocator, NoBoundsCheckingPolicy, CountingTracker> manager(MallocAllocator(), NoBoundsCheckingPolicy(), tracker);
+
+	double* value = manager.allocate<double>();
+	CHECK(*tracker.mLastSize == sizeof(double));
+
+	char* text = manager.allocate<char>(10);
+	CHECK(*tracker.mLastSize == 10);
+
+	manager.deallocate<char, ARRAY::YES>(text);
+	manager.deallocate<double, ARRAY::NO>(value);
+
+	CHECK(*tracker.mAllocations == 2);
+	CHECK(*tracker.mDeallocations == 2);
+}
+
+RUN_TESTS()
@@ -0,0 +1,171 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file NumaAllocatorTest.cpp
+ */
+
+#include "Test.h"
+
+#include "../includes/NumaAllocator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace ondraluk;
+
+namespace {
+
+	unsigned int fakeCpu = 0;
+
+	unsigned int fakeCpuSource() {
+		return fakeCpu;
+	}
+}
+
+TEST(simulatedTopology) {
+	NumaTopology topology = NumaTopology::simulated(2, 4);
+
+	CHECK(topology.isSimulated());
+	CHECK(topology.nodeCount() == 2);
+	CHECK(topology.cpuCount() == 8);
+	CHECK(topology.nodeOfCpu(3) == 0);
+	CHECK(topology.nodeOfCpu(4) == 1);
+	CHECK(topology.nodeOfCpu(100) == 0);
+	CHECK(topology.cpusOfNode(1).size() == 4);
+}
+
+TEST(detectedTopologyHasAtLeastOneNode) {
+	NumaTopology topology = NumaTopology::detect();
+
+	CHECK(!topology.isSimulated());
+	CHECK(topology.nodeCount() >= 1);
+	CHECK(topology.nodeOfCpu(currentCpu()) < topology.nodeCount());
+}
+
+TEST(realArenaIsPlaced) {
+	NumaTopology topology = NumaTopology::detect();
+	NumaArena arena(1 << 20, 0, topology);
+
+	CHECK(arena.allocate((1 << 20) - NumaArena::OVERHEAD) != nullptr);
+	CHECK(arena.allocate(1) == nullptr);
+
+	static const char* BINDINGS[] = { "none", "mbind", "first touch" };
+	std::printf("node 0 arena: %s, %s\n", BINDINGS[arena.binding()], PageSource::name(arena.backend()));
+}
+
+TEST(allocatesFromNodeOfCurrentCpu) {
+	NumaAllocator allocator(1 << 16, NumaTopology::simulated(2, 2), fakeCpuSource);
+
+	fakeCpu = 1;
+	void* first = allocator.allocate(64);
+	fakeCpu = 2;
+	void* second = allocator.allocate(64);
+
+	CHECK(allocator.arena(0).owns(first));
+	CHECK(allocator.arena(1).owns(second));
+	CHECK(allocator.arena(0).binding() == NUMABINDING::NONE);
+	CHECK(allocator.currentNode() == 1);
+
+	// freed into the owning arena regardless of the current node
+	allocator.free(first);
+	fakeCpu = 0;
+	CHECK(allocator.allocate(64) == first);
+}
+
+TEST(memoryManagerFrontEnd) {
+	NumaMemoryManager<> manager(NumaAllocator(1 << 16, NumaTopology::simulated(2, 1), fakeCpuSource));
+	const NumaAllocator& allocator = manager.allocator();
+
+	fakeCpu = 1;
+	int* value = manager.allocate<int>(1);
+	CHECK(value != nullptr);
+	*value = 42;
+
+	// placed on the node of cpu 1
+	CHECK(allocator.arena(1).owns(value));
+	CHECK(!allocator.arena(0).owns(value));
+
+	// freed from cpu 0 into the arena of node 1: the next allocation on node 1 reuses it, node 0 does not
+	fakeCpu = 0;
+	manager.deallocate<int, ARRAY::NO>(value);
+
+	int* other = manager.allocate<int>(1);
+	CHECK(allocator.arena(0).owns(other));
+	CHECK(other != value);
+
+	fakeCpu = 1;
+	CHECK(manager.allocate<int>(1) == value);
+}
+
+TEST(freesInAnyOrderFromTwoThreads) {
+	NumaAllocator allocator(1 << 20, NumaTopology::simulated(2, 1), fakeCpuSource);
+	fakeCpu = 1;
+
+	struct Live {
+		unsigned char* mMem;
+		size_t mSize;
+		unsigned char mFill;
+	};
+
+	std::vector<Live> live[2];
+	std::atomic<bool> exhausted(false);
+
+	std::thread threads[2];
+	for(int t = 0; t < 2; ++t) {
+		threads[t] = std::thread([&allocator, &live, &exhausted, t]() {
+			std::vector<Live>& mine = live[t];
+
+			for(int round = 0; round < 200; ++round) {
+				for(int i = 0; i < 8; ++i) {
+					size_t size = static_cast<size_t>(16 + (round * 37 + i * 11 + t * 5) % 300);
+					Live block = { static_cast<unsigned char*>(allocator.allocate(size)), size, static_cast<unsigned char>(t * 100 + i) };
+
+					if(block.mMem == nullptr) {
+						exhausted = true;
+						return;
+					}
+					memset(block.mMem, block.mFill, size);
+					mine.push_back(block);
+				}
+
+				// the oldest and some in the middle, never the newest first
+				for(size_t i = 0; i < mine.size(); i += 3) {
+					allocator.free(mine[i].mMem);
+					mine[i] = mine.back();
+					mine.pop_back();
+				}
+			}
+		});
+	}
+	threads[0].join();
+	threads[1].join();
+
+	CHECK(!exhausted);
+
+	std::vector<Live> all(live[0]);
+	all.insert(all.end(), live[1].begin(), live[1].end());
+	std::sort(all.begin(), all.end(), [](const Live& a, const Live& b) { return a.mMem < b.mMem; });
+
+	for(size_t i = 0; i < all.size(); ++i) {
+		CHECK(allocator.arena(1).owns(all[i].mMem));
+		if(i + 1 < all.size()) {
+			CHECK(all[i].mMem + all[i].mSize <= all[i + 1].mMem);
+		}
+
+		// nothing allocated later wrote into a live block
+		CHECK(std::count(all[i].mMem, all[i].mMem + all[i].mSize, all[i].mFill) == static_cast<std::ptrdiff_t>(all[i].mSize));
+	}
+
+	for(size_t i = 0; i < all.size(); ++i) {
+		allocator.free(all[i].mMem);
+	}
+}
+
+RUN_TESTS()
@@ -0,0 +1,247 @@
+/**
+ *  This file is part of the debuglib project
+ *  Copyright by Christian Ondracek
+ *  Contact: coder[at]paxi.at
+ */
+
+#include "Test.h"
+
+#include "../includes/Logger.h"
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/resource.h>
+
+using namespace debuglib::logger;
+
+namespace {
+
+	std::string readFile(const char* fname) {
+		std::ifstream stream(fname, std::ios::binary);
+		std::stringstream content;
+		content << stream.rdbuf();
+		return content.str();
+	}
+
+	size_t countLines(const std::string& text) {
+		size_t lines = 0;
+		for(size_t i = 0; i < text.size(); ++i) {
+			lines += text[i] == '\n';
+		}
+		return lines;
+	}
+
+	struct CaptureOutputter {
+		CaptureOutputter() : mLines(std::make_shared<std::vector<std::string> >()) {}
+
+		void out(const char* msg) const {
+			mLines->push_back(msg);
+		}
+
+		void flush() const {}
+
+		std::shared_ptr<std::vector<std::string> > mLines;
+	};
+}
+
+TEST(bufferedFileKeepsMessagesUntilFlush) {
+	BufferedFileOutputterConfig config;
+	config.mFlushIntervalMs = 0;
+
+	BufferedFileOutputter outputter("OutputterTest.buffered", config);
+	outputter.out("first\n");
+	outputter.out("second\n");
+
+	CHECK(readFile("OutputterTest.buffered").empty());
+
+	outputter.flush();
+	CHECK(readFile("OutputterTest.buffered") == "first\nsecond\n");
+}
+
+TEST(bufferedFileWritesMessagesLargerThanBuffer) {
+	BufferedFileOutputterConfig config;
+	config.mBufferSize = 8;
+	config.mFlushIntervalMs = 0;
+
+	{
+		BufferedFileOutputter outputter("OutputterTest.small", config);
+		outputter.out("abc");
+		outputter.out("a message larger than the buffer\n");
+		outputter.out("end\n");
+	}
+
+	CHECK(readFile("OutputterTest.small") == "abca message larger than the buffer\nend\n");
+}
+
+TEST(bufferedFileRotatesBySize) {
+	std::remove("OutputterTest.rotated.1");
+	std::remove("OutputterTest.rotated.2");
+
+	std::shared_ptr<std::vector<std::string> > rotated = std::make_shared<std::vector<std::string> >();
+	std::shared_ptr<std::mutex> mutex = std::make_shared<std::mutex>();
+
+	BufferedFileOutputterConfig config;
+	config.mBufferSize = 16;
+	config.mFlushIntervalMs = 0;
+	config.mRotateSize = 20;
+	config.mCompressionHook = [rotated, mutex](const char* fname) {
+		std::lock_guard<std::mutex> lock(*mutex);
+		rotated->push_back(fname);
+	};
+
+	{
+		BufferedFileOutputter outputter("OutputterTest.rotated", config);
+		for(int i = 0; i < 5; ++i) {
+			outputter.out("0123456789\n");
+		}
+	}
+
+	CHECK(readFile("OutputterTest.rotated.1") == "0123456789\n");
+	CHECK(readFile("OutputterTest.rotated.2") == "0123456789\n");
+	CHECK(readFile("OutputterTest.rotated") == "0123456789\n");
+	CHECK(rotated->size() == 4);
+	CHECK(!rotated->empty() && (*rotated)[0] == "OutputterTest.rotated.1");
+}
+
+TEST(mmapFileSurvivesSegmentSwitches) {
+	const int threads = 4;
+	const int messages = 2000;
+
+	{
+		MmapFileOutputter outputter("OutputterTest.mmap", 4096);
+		std::vector<std::thread> producers;
+
+		for(int t = 0; t < threads; ++t) {
+			producers.push_back(std::thread([&outputter] {
+				for(int i = 0; i < messages; ++i) {
+					outputter.out("a message of some length\n");
+				}
+			}));
+		}
+
+		for(size_t t = 0; t < producers.size(); ++t) {
+			producers[t].join();
+		}
+	}
+
+	std::string text = readFile("OutputterTest.mmap");
+	std::string withoutPadding;
+	for(size_t i = 0; i < text.size(); ++i) {
+		if(text[i] != '\0') {
+			withoutPadding += text[i];
+		}
+	}
+
+	CHECK(countLines(withoutPadding) == threads * messages);
+	CHECK(withoutPadding.size() == threads * messages * strlen("a message of some length\n"));
+}
+
+TEST(mmapFileKeepsTheLogWhenTheDiskIsFull) {
+	const char* message = "a message of some length\n";
+
+	// the file may grow to three segments, mapping the fourth fails
+	rlimit previous;
+	getrlimit(RLIMIT_FSIZE, &previous);
+	rlimit limit = previous;
+	limit.rlim_cur = 3 * 4096;
+	signal(SIGXFSZ, SIG_IGN);
+	CHECK(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+
+	{
+		MmapFileOutputter outputter("OutputterTest.full.mmap", 4096);
+
+		for(int i = 0; i < 1000; ++i) {
+			outputter.out(message);
+		}
+	}
+
+	setrlimit(RLIMIT_FSIZE, &previous);
+	signal(SIGXFSZ, SIG_DFL);
+
+	std::string text = readFile("OutputterTest.full.mmap");
+	CHECK(text.size() == 3 * 4096);
+	// every full segment holds as many messages as fit
+	CHECK(countLines(text) == 3 * (4096 / strlen(message)));
+	CHECK(text.compare(0, strlen(message), message) == 0);
+}
+
+TEST(perThreadOutputterMergesByTimestamp) {
+	const int threads = 4;
+	const int messages = 1000;
+
+	CaptureOutputter capture;
+	PerThreadOutputter<CaptureOutputter> outputter(capture, 1024);
+
+	std::vector<std::thread> producers;
+	for(int t = 0; t < threads; ++t) {
+		producers.push_back(std::thread([&outputter, t] {
+			char msg[32];
+			for(int i = 0; i < messages; ++i) {
+				snprintf(msg, sizeof(msg), "%d %d\n", t, i);
+				outputter.out(msg);
+			}
+		}));
+	}
+
+	for(size_t t = 0; t < producers.size(); ++t) {
+		producers[t].join();
+	}
+
+	outputter.flush();
+	CHECK(outputter.pending() == 0);
+	CHECK(capture.mLines->size() == threads * messages);
+
+	// the producers ended, their buffers were drained and freed
+	CHECK(outputter.buffers() == 0);
+
+	// the merge keeps the order of every single thread
+	int next[threads] = { 0 };
+	for(size_t i = 0; i < capture.mLines->size(); ++i) {
+		int thread = -1;
+		int index = -1;
+		sscanf((*capture.mLines)[i].c_str(), "%d %d", &thread, &index);
+
+		CHECK(thread >= 0 && thread < threads);
+		if(thread >= 0 && thread < threads) {
+			CHECK(index == next[thread]);
+			next[thread] = index + 1;
+		}
+	}
+}
+
+TEST(perThreadOutputterRetiresBuffersOfEndedThreads) {
+	CaptureOutputter capture;
+	PerThreadOutputter<CaptureOutputter> outputter(capture, 1024);
+
+	outputter.out("main\n");
+
+	// short lived threads, each leaves its last message in its buffer
+	for(int t = 0; t < 16; ++t) {
+		std::thread([&outputter] {
+			outputter.out("worker\n");
+		}).join();
+	}
+
+	CHECK(outputter.buffers() == 17);
+	CHECK(capture.mLines->empty());
+
+	outputter.flush();
+	CHECK(capture.mLines->size() == 17);
+	CHECK(outputter.buffers() == 1);
+
+	// the main thread keeps its buffer
+	outputter.out("main\n");
+	outputter.flush();
+	CHECK(capture.mLines->size() == 18);
+	CHECK(outputter.buffers() == 1);
+}
+
+RUN_TESTS()
@@ -0,0 +1,106 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file PageSourceTest.cpp
+ */
+
+#include "Test.h"
+
+#include "../includes/PageSource.hpp"
+#include "../includes/LinearAllocator.hpp"
+#include "../includes/PoolAllocator.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <set>
+
+using namespace ondraluk;
+
+namespace {
+
+	bool writable(const PageRegion& region) {
+		memset(region.mMem, 0xAB, region.mSize);
+		return static_cast<unsigned char*>(region.mMem)[region.mSize - 1] == 0xAB;
+	}
+}
+
+TEST(mallocBackend) {
+	PageRegion region = PageSource::acquire(1000, PAGEBACKEND::MALLOC);
+
+	CHECK(region.mMem != nullptr);
+	CHECK(region.mBackend == PAGEBACKEND::MALLOC);
+	CHECK(region.mSize >= 1000);
+	CHECK(writable(region));
+
+	PageSource::release(region);
+}
+
+TEST(mmapRoundsToPages) {
+	PageRegion region = PageSource::acquire(1000, PAGEBACKEND::MMAP);
+
+	CHECK(region.mMem != nullptr);
+#ifndef _WIN32
+	CHECK(region.mBackend == PAGEBACKEND::MMAP);
+	CHECK(region.mSize % PageSource::pageSize() == 0);
+#endif
+	CHECK(writable(region));
+
+	PageSource::release(region);
+}
+
+TEST(hugeBackendsFallBack) {
+	PAGEBACKEND::ENUM backends[] = { PAGEBACKEND::MMAP_TRANSPARENT_HUGE, PAGEBACKEND::MMAP_HUGETLB };
+
+	for(size_t i = 0; i < 2; ++i) {
+		PageRegion region = PageSource::acquire(3 * 1024 * 1024, backends[i]);
+
+		// whatever is available on this machine, never more than requested
+		CHECK(region.mMem != nullptr);
+		CHECK(region.mBackend <= backends[i]);
+		CHECK(region.mSize >= 3 * 1024 * 1024);
+		CHECK(writable(region));
+
+		if(region.mBackend >= PAGEBACKEND::MMAP_TRANSPARENT_HUGE) {
+			CHECK(reinterpret_cast<uintptr_t>(region.mMem) % PageSource::hugePageSize() == 0);
+			CHECK(region.mSize % PageSource::hugePageSize() == 0);
+		}
+
+		PageSource::release(region);
+	}
+}
+
+TEST(linearAllocatorReportsBackend) {
+	LinearAllocator allocator(4 * 1024 * 1024, PAGEBACKEND::MMAP_TRANSPARENT_HUGE);
+
+	CHECK(allocator.backend() <= PAGEBACKEND::MMAP_TRANSPARENT_HUGE);
+	CHECK(allocator.allocate(4 * 1024 * 1024) != nullptr);
+	CHECK(allocator.allocate(1) == nullptr);
+}
+
+TEST(poolHandsOutDistinctBlocks) {
+	PoolAllocator pool(24, 16, PAGEBACKEND::MMAP);
+	std::set<void*> blocks;
+
+	CHECK(pool.blockSize() % sizeof(void*) == 0);
+	CHECK(pool.allocate(pool.blockSize() + 1) == nullptr);
+
+	for(size_t i = 0; i < 16; ++i) {
+		void* block = pool.allocate(24);
+		CHECK(block != nullptr);
+		blocks.insert(block);
+	}
+
+	CHECK(blocks.size() == 16);
+	CHECK(pool.allocate(24) == nullptr);
+
+	void* reused = *blocks.begin();
+	pool.free(reused);
+
+	CHECK(pool.allocate(8) == reused);
+	CHECK(pool.allocate(8) == nullptr);
+}
+
+RUN_TESTS()
@@ -0,0 +1,177 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file PoisoningAllocatorTest.cpp
+ */
+
+#include "Test.h"
+
+#include "../includes/PoisoningAllocator.hpp"
+#include "../includes/PoolAllocator.hpp"
+#include "../includes/LinearAllocator.hpp"
+#include "../includes/MallocAllocator.hpp"
+#include "../includes/MemoryManager.hpp"
+
+#include <cstring>
+#include <vector>
+
+using namespace ondraluk;
+
+TEST(patternHelpersFindFirstMismatch) {
+	std::vector<unsigned char> buffer(100);
+
+	fillPattern(buffer.data(), buffer.size(), 0xDD);
+	CHECK(findPatternMismatch(buffer.data(), buffer.size(), 0xDD) == buffer.size());
+
+	buffer[37] = 0;
+	CHECK(findPatternMismatch(buffer.data(), buffer.size(), 0xDD) == 37);
+
+	buffer[37] = 0xDD;
+	buffer[99] = 0;
+	CHECK(findPatternMismatch(buffer.data(), buffer.size(), 0xDD) == 99);
+	CHECK(findPatternMismatch(buffer.data(), 0, 0xDD) == 0);
+}
+
+TEST(freedBlocksStayInQuarantine) {
+	PoisoningAllocator<PoolAllocator, 4> allocator(PoolAllocator(64, 16));
+
+	void* first = allocator.allocate(32);
+	allocator.free(first);
+	CHECK(allocator.quarantined() == 1);
+
+	// the pool would hand the same block out again without the quarantine
+	void* second = allocator.allocate(32);
+	CHECK(second != first);
+
+	allocator.free(second);
+	allocator.flush();
+	CHECK(allocator.quarantined() == 0);
+	CHECK(allocator.corruptions() == 0);
+}
+
+TEST(quarantineIsFifo) {
+	PoisoningAllocator<PoolAllocator, 2> allocator(PoolAllocator(64, 16));
+
+	void* a = allocator.allocate(16);
+	void* b = allocator.allocate(16);
+	void* c = allocator.allocate(16);
+
+	allocator.free(a);
+	allocator.free(b);
+	// evicts a
+	allocator.free(c);
+	CHECK(allocator.quarantined() == 2);
+
+	CHECK(allocator.allocate(16) == a);
+	CHECK(allocator.corruptions() == 0);
+}
+
+#if ONDRALUK_ASAN
+
+TEST(quarantinedBlocksArePoisoned) {
+	PoisoningAllocator<MallocAllocator, 4> allocator;
+
+	unsigned char* mem = static_cast<unsigned char*>(allocator.allocate(48));
+	CHECK(__asan_address_is_poisoned(mem) == 0);
+
+	allocator.free(mem);
+	CHECK(__asan_address_is_poisoned(mem) != 0);
+	CHECK(__asan_address_is_poisoned(mem + 47) != 0);
+}
+
+TEST(poolAndLinearAnnotations) {
+	PoolAllocator pool(32, 4);
+
+	void* block = pool.allocate(32);
+	CHECK(__asan_address_is_poisoned(block) == 0);
+	pool.free(block);
+	CHECK(__asan_address_is_poisoned(block) != 0);
+
+	LinearAllocator linear(256);
+
+	unsigned char* mem = static_cast<unsigned char*>(linear.allocate(64));
+	CHECK(__asan_address_is_poisoned(mem + 63) == 0);
+	CHECK(__asan_address_is_poisoned(mem + 64) != 0);
+
+	linear.free(mem);
+	CHECK(__asan_address_is_poisoned(mem) != 0);
+}
+
+#else
+
+namespace {
+
+	struct Reported {
+		Reported() : mCount(0), mOffset(0) {}
+
+		size_t mCount;
+		size_t mOffset;
+	};
+
+	UseAfterFreeHandler recordTo(Reported& reported) {
+		return [&reported](const void*, size_t offset) {
+			++reported.mCount;
+			reported.mOffset = offset;
+		};
+	}
+
+}
+
+TEST(writeAfterFreeIsReportedOnEviction) {
+	Reported reported;
+	PoisoningAllocator<MallocAllocator, 2> allocator(MallocAllocator(), recordTo(reported));
+
+	unsigned char* mem = static_cast<unsigned char*>(allocator.allocate(40));
+	memset(mem, 0, 40);
+	allocator.free(mem);
+
+	// the pattern reads back through the stale pointer
+	CHECK(mem[0] == 0xDD && mem[39] == 0xDD);
+
+	mem[21] = 1;
+	CHECK(reported.mCount == 0);
+
+	allocator.free(allocator.allocate(8));
+	allocator.free(allocator.allocate(8));
+
+	CHECK(reported.mCount == 1);
+	CHECK(reported.mOffset == 21);
+	CHECK(allocator.corruptions() == 1);
+}
+
+TEST(flushVerifiesRemainingBlocks) {
+	Reported reported;
+
+	{
+		PoisoningAllocator<MallocAllocator, 8> allocator(MallocAllocator(), recordTo(reported));
+
+		unsigned char* mem = static_cast<unsigned char*>(allocator.allocate(16));
+		allocator.free(mem);
+		mem[15] = 0;
+	}
+
+	CHECK(reported.mCount == 1);
+	CHECK(reported.mOffset == 15);
+}
+
+#endif
+
+TEST(worksBelowTheMemoryManager) {
+	typedef PoisoningAllocator<PoolAllocator, 8> Allocator;
+	MemoryManager<Allocator, BoundsCheckingPolicy<8, 0xEF> > manager(Allocator(PoolAllocator(128, 32)));
+
+	double* values = manager.allocate<double>(8);
+	for(int i = 0; i < 8; ++i) {
+		values[i] = i;
+	}
+	manager.deallocate<double, ARRAY::YES>(values);
+
+	double* other = manager.allocate<double>(8);
+	CHECK(other != values);
+	manager.deallocate<double, ARRAY::YES>(other);
+}
+
+RUN_TESTS()
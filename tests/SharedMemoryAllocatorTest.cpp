@@ -0,0 +1,290 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file SharedMemoryAllocatorTest.cpp
+ */
+
+#include "Test.h"
+
+#include "../includes/SharedMemoryAllocator.hpp"
+#include "../includes/StdAllocator.hpp"
+#include "../includes/MemoryManager.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace ondraluk;
+
+namespace {
+
+	std::string segmentName(const char* test) {
+		char name[64];
+		std::snprintf(name, sizeof(name), "/ondraluk_test_%s_%d", test, static_cast<int>(getpid()));
+		return name;
+	}
+
+	struct Node {
+		int mValue;
+		OffsetPtr<Node> mNext;
+	};
+}
+
+TEST(createAndOpen) {
+	std::string name = segmentName("open");
+
+	SharedMemoryAllocator producer(name.c_str(), SHMMODE::CREATE, 1 << 16);
+	CHECK(producer.isOpen());
+	CHECK(producer.size() == 1 << 16);
+
+	// the name is taken
+	CHECK(!SharedMemoryAllocator(name.c_str(), SHMMODE::CREATE, 1 << 16).isOpen());
+
+	SharedMemoryAllocator consumer(name.c_str(), SHMMODE::OPEN);
+	CHECK(consumer.isOpen());
+	CHECK(consumer.size() == producer.size());
+
+	CHECK(SharedMemoryAllocator::remove(name.c_str()));
+	CHECK(!SharedMemoryAllocator("/ondraluk_test_missing", SHMMODE::OPEN).isOpen());
+}
+
+TEST(freeCoalesces) {
+	std::string name = segmentName("coalesce");
+	SharedMemoryAllocator allocator(name.c_str(), SHMMODE::CREATE, 1 << 16);
+	SharedMemoryAllocator::remove(name.c_str());
+
+	std::vector<void*> blocks;
+	void* block;
+
+	while((block = allocator.allocate(1000)) != nullptr) {
+		CHECK(reinterpret_cast<uintptr_t>(block) % 16 == 0);
+		blocks.push_back(block);
+	}
+
+	CHECK(blocks.size() > 50);
+	CHECK(allocator.allocate(1 << 15) == nullptr);
+
+	// free in an order that needs merging with both neighbours
+	for(size_t i = 0; i < blocks.size(); i += 2) {
+		allocator.free(blocks[i]);
+	}
+	for(size_t i = 1; i < blocks.size(); i += 2) {
+		allocator.free(blocks[i]);
+	}
+
+	CHECK(allocator.used() == 0);
+	CHECK(allocator.allocate(1 << 15) != nullptr);
+}
+
+TEST(offsetPointersWorkAtAnyMappingAddress) {
+	std::string name = segmentName("offset");
+	SharedMemoryAllocator producer(name.c_str(), SHMMODE::CREATE, 1 << 16);
+	SharedMemoryAllocator consumer(name.c_str(), SHMMODE::OPEN);
+	SharedMemoryAllocator::remove(name.c_str());
+
+	CHECK(consumer.at(1) != producer.at(1));
+
+	// build a list in place
+	Node* head = nullptr;
+	for(int i = 0; i < 10; ++i) {
+		Node* node = new (producer.allocate(sizeof(Node))) Node();
+		node->mValue = i;
+		node->mNext = head;
+		head = node;
+	}
+	producer.setRoot(head);
+
+	int sum = 0;
+	int count = 0;
+	for(Node* node = static_cast<Node*>(consumer.root()); node != nullptr; node = node->mNext.get()) {
+		CHECK(consumer.owns(node));
+		sum += node->mValue;
+		++count;
+	}
+
+	CHECK(count == 10);
+	CHECK(sum == 45);
+	CHECK(consumer.offsetOf(consumer.root()) == producer.offsetOf(head));
+}
+
+TEST(containersWorkAtAnyMappingAddress) {
+	typedef StdAllocator<int, SharedMemoryAllocator> IntAllocator;
+	typedef std::vector<int, IntAllocator> SharedVector;
+
+	std::string name = segmentName("container");
+	SharedMemoryAllocator producer(name.c_str(), SHMMODE::CREATE, 1 << 16);
+	SharedMemoryAllocator consumer(name.c_str(), SHMMODE::OPEN);
+	SharedMemoryAllocator::remove(name.c_str());
+
+	CHECK(consumer.at(1) != producer.at(1));
+
+	// built in place, growing moves the elements within the segment
+	SharedVector* values = new (producer.allocate(sizeof(SharedVector))) SharedVector((IntAllocator(producer)));
+	for(int i = 0; i < 100; ++i) {
+		values->push_back(i);
+	}
+	producer.setRoot(values);
+
+	const SharedVector& seen = *static_cast<const SharedVector*>(consumer.root());
+	CHECK(seen.size() == 100);
+	CHECK(consumer.owns(seen.data()));
+	CHECK(seen.data() != values->data());
+
+	int sum = 0;
+	for(SharedVector::const_iterator it = seen.begin(); it != seen.end(); ++it) {
+		sum += *it;
+	}
+	CHECK(sum == 4950);
+	CHECK(seen[99] == 99);
+
+	values->~SharedVector();
+	producer.free(values);
+	CHECK(producer.used() == 0);
+}
+
+TEST(processesShareTheHeap) {
+	std::string name = segmentName("processes");
+	SharedMemoryAllocator parent(name.c_str(), SHMMODE::CREATE, 1 << 20);
+
+	pid_t child = fork();
+
+	if(child == 0) {
+		SharedMemoryAllocator allocator(name.c_str(), SHMMODE::OPEN);
+
+		for(int i = 0; i < 20000; ++i) {
+			void* mem = allocator.allocate(static_cast<size_t>(i % 512) + 1);
+			if(mem == nullptr) {
+				_exit(1);
+			}
+			memset(mem, 0xCD, static_cast<size_t>(i % 512) + 1);
+			allocator.free(mem);
+		}
+
+		_exit(0);
+	}
+
+	for(int i = 0; i < 20000; ++i) {
+		void* mem = parent.allocate(static_cast<size_t>(i % 300) + 1);
+		CHECK(mem != nullptr);
+		memset(mem, 0xAB, static_cast<size_t>(i % 300) + 1);
+		parent.free(mem);
+	}
+
+	int status = 0;
+	waitpid(child, &status, 0);
+	SharedMemoryAllocator::remove(name.c_str());
+
+	CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	CHECK(parent.used() == 0);
+}
+
+TEST(ownerDeathOutsideOfAChangeRecovers) {
+	std::string name = segmentName("ownerdeath");
+	SharedMemoryAllocator parent(name.c_str(), SHMMODE::CREATE, 1 << 16);
+	void* kept = parent.allocate(100);
+
+	pid_t child = fork();
+
+	if(child == 0) {
+		SharedMemoryAllocator allocator(name.c_str(), SHMMODE::OPEN);
+		SharedHeapCursor cursor;
+		bool restarted;
+
+		// dies holding the segment lock
+		allocator.walk(cursor, [](uint64_t, uint64_t, bool) { _exit(0); }, 1, restarted);
+		_exit(1);
+	}
+
+	int status = 0;
+	waitpid(child, &status, 0);
+	CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+	CHECK(!parent.poisoned());
+	void* mem = parent.allocate(200);
+	CHECK(mem != nullptr);
+	parent.free(mem);
+	parent.free(kept);
+	CHECK(parent.used() == 0);
+
+	SharedMemoryAllocator::remove(name.c_str());
+}
+
+TEST(ownerDeathWithinAChangePoisons) {
+	std::string name = segmentName("killed");
+	SharedMemoryAllocator parent(name.c_str(), SHMMODE::CREATE, 1 << 20);
+
+	pid_t child = fork();
+
+	if(child == 0) {
+		SharedMemoryAllocator allocator(name.c_str(), SHMMODE::OPEN);
+		std::vector<void*> blocks;
+
+		for(int i = 0; ; ++i) {
+			blocks.push_back(allocator.allocate(static_cast<size_t>(i % 512) + 1));
+			if(blocks.size() == 64) {
+				for(size_t j = 0; j < blocks.size(); ++j) {
+					allocator.free(blocks[j]);
+				}
+				blocks.clear();
+			}
+		}
+	}
+
+	usleep(20000);
+	kill(child, SIGKILL);
+	waitpid(child, nullptr, 0);
+
+	// killed within allocate / free: poisoned, otherwise the list is whole
+	SharedHeapCursor cursor;
+	bool restarted;
+	uint64_t covered = 0;
+	bool done = parent.walk(cursor, [&covered](uint64_t, uint64_t size, bool) { covered += size; }, 1 << 20, restarted);
+
+	CHECK(done);
+	if(parent.poisoned()) {
+		CHECK(covered == 0);
+		CHECK(parent.allocate(16) == nullptr);
+	} else {
+		CHECK(covered == parent.size());
+		void* mem = parent.allocate(16);
+		CHECK(mem != nullptr);
+		parent.free(mem);
+	}
+
+	SharedMemoryAllocator::remove(name.c_str());
+}
+
+TEST(memoryManagerAndStdAllocator) {
+	std::string name = segmentName("adapters");
+	SharedMemoryAllocator segment(name.c_str(), SHMMODE::CREATE, 1 << 20);
+	SharedMemoryAllocator::remove(name.c_str());
+
+	{
+		std::vector<int, StdAllocator<int, SharedMemoryAllocator> > values((StdAllocator<int, SharedMemoryAllocator>(segment)));
+
+		for(int i = 0; i < 1000; ++i) {
+			values.push_back(i);
+		}
+
+		CHECK(segment.owns(values.data()));
+		CHECK(values[999] == 999);
+	}
+	CHECK(segment.used() == 0);
+
+	MemoryManager<SharedMemoryAllocator, BoundsCheckingPolicy<8, 0xEF> > manager(std::move(segment));
+
+	double* numbers = manager.allocate<double>(100);
+	CHECK(numbers != nullptr);
+	numbers[99] = 1.0;
+	manager.deallocate<double, ARRAY::YES>(numbers);
+}
+
+RUN_TESTS()
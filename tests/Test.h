@@ -0,0 +1,73 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file Test.h
+ *
+ * Minimal test harness: every test file is an executable of TEST functions ending with RUN_TESTS().
+ */
+
+#ifndef ONDRALUK_TEST_H
+#define ONDRALUK_TEST_H
+
+#include <cstdio>
+#include <vector>
+
+namespace testing {
+
+	typedef void (*TestFunction)();
+
+	struct TestCase {
+		const char* mName;
+		TestFunction mFunction;
+	};
+
+	inline std::vector<TestCase>& tests() {
+		static std::vector<TestCase> registered;
+		return registered;
+	}
+
+	inline int& failures() {
+		static int count = 0;
+		return count;
+	}
+
+	struct Registrar {
+		Registrar(const char* name, TestFunction function) {
+			TestCase test = { name, function };
+			tests().push_back(test);
+		}
+	};
+
+	inline int run() {
+		for(size_t i = 0; i < tests().size(); ++i) {
+			int before = failures();
+			tests()[i].mFunction();
+			std::printf("[%s] %s\n", failures() == before ? "PASS" : "FAIL", tests()[i].mName);
+		}
+
+		return failures() == 0 ? 0 : 1;
+	}
+}
+
+#define TEST(name) \
+	static void name(); \
+	static testing::Registrar name##Registrar(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { \
+		if(!(expression)) { \
+			std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expression); \
+			++testing::failures(); \
+		} \
+	} while(0)
+
+#define RUN_TESTS() \
+	int main() { \
+		return testing::run(); \
+	}
+
+#endif
@@ -0,0 +1,161 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file ThreadOwnedAllocatorTest.cpp
+ */
+
+#include "Test.h"
+
+#include "../includes/ThreadOwnedAllocator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace ondraluk;
+
+TEST(localFreeIsReused) {
+	ThreadOwnedAllocator allocator;
+
+	void* first = allocator.allocate(100);
+	CHECK(first != nullptr);
+	CHECK(allocator.owns(first));
+
+	allocator.free(first);
+	CHECK(allocator.allocate(100) == first);
+	CHECK(allocator.remoteFrees() == 0);
+	CHECK(allocator.heapCount() == 1);
+}
+
+TEST(sizeClassesDoNotMix) {
+	ThreadOwnedAllocator allocator;
+
+	void* small = allocator.allocate(16);
+	allocator.free(small);
+
+	void* larger = allocator.allocate(17);
+	CHECK(larger != small);
+
+	memset(larger, 0xAB, 17);
+	CHECK(allocator.allocate(10) == small);
+}
+
+TEST(largeBlocksBypassTheHeaps) {
+	ThreadOwnedAllocator allocator;
+
+	void* large = allocator.allocate(ThreadOwnedAllocator::MAX_SMALL_SIZE + 1);
+	CHECK(large != nullptr);
+	CHECK(!allocator.owns(large));
+
+	std::thread other([&]() { allocator.free(large); });
+	other.join();
+
+	CHECK(allocator.remoteFrees() == 0);
+}
+
+TEST(remoteFreesReturnToTheOwner) {
+	ThreadOwnedAllocator allocator;
+	std::vector<void*> blocks;
+
+	for(int i = 0; i < 64; ++i) {
+		blocks.push_back(allocator.allocate(48));
+	}
+
+	std::thread worker([&]() {
+		for(size_t i = 0; i < blocks.size(); ++i) {
+			allocator.free(blocks[i]);
+		}
+	});
+	worker.join();
+
+	CHECK(allocator.remoteFrees() == 64);
+	CHECK(allocator.drainedFrees() == 0);
+
+	// the next allocate takes the whole batch back
+	void* reused = allocator.allocate(48);
+	CHECK(allocator.drainedFrees() == 64);
+	CHECK(std::find(blocks.begin(), blocks.end(), reused) != blocks.end());
+
+	for(int i = 1; i < 64; ++i) {
+		void* mem = allocator.allocate(48);
+		CHECK(std::find(blocks.begin(), blocks.end(), mem) != blocks.end());
+	}
+}
+
+TEST(exitedThreadsHeapIsAdopted) {
+	ThreadOwnedAllocator allocator;
+	void* leftover = nullptr;
+
+	std::thread first([&]() {
+		leftover = allocator.allocate(64);
+		allocator.free(allocator.allocate(64));
+	});
+	first.join();
+
+	CHECK(allocator.heapCount() == 1);
+	CHECK(allocator.abandonedHeaps() == 1);
+
+	// freed into the abandoned heap
+	allocator.free(leftover);
+
+	std::thread second([&]() {
+		CHECK(allocator.allocate(64) != nullptr);
+		CHECK(allocator.allocate(64) != nullptr);
+	});
+	second.join();
+
+	CHECK(allocator.heapCount() == 1);
+	CHECK(allocator.drainedFrees() == 1);
+}
+
+TEST(producerConsumerThroughTheMemoryManager) {
+	ThreadOwnedAllocator allocator;
+	ThreadOwnedMemoryManager<BoundsCheckingPolicy<8, 0xEF> > manager(allocator);
+
+	const int COUNT = 20000;
+	std::deque<uint64_t*> queue;
+	std::mutex lock;
+	std::condition_variable ready;
+	std::atomic<bool> corrupted(false);
+
+	std::thread consumer([&]() {
+		for(int i = 0; i < COUNT; ++i) {
+			uint64_t* value;
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				ready.wait(guard, [&]() { return !queue.empty(); });
+				value = queue.front();
+				queue.pop_front();
+			}
+
+			if(*value != static_cast<uint64_t>(i)) {
+				corrupted = true;
+			}
+			manager.deallocate<uint64_t, ARRAY::NO>(value);
+		}
+	});
+
+	for(int i = 0; i < COUNT; ++i) {
+		uint64_t* value = manager.allocate<uint64_t>();
+		*value = i;
+
+		std::lock_guard<std::mutex> guard(lock);
+		queue.push_back(value);
+		ready.notify_one();
+	}
+
+	consumer.join();
+
+	CHECK(!corrupted);
+	CHECK(allocator.remoteFrees() == COUNT);
+}
+
+RUN_TESTS()
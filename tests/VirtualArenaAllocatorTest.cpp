@@ -0,0 +1,110 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file VirtualArenaAllocatorTest.cpp
+ */
+
+#include "Test.h"
+
+#include "../includes/VirtualArenaAllocator.hpp"
+#include "../includes/PageSource.hpp"
+
+#include <cstring>
+#include <utility>
+
+using namespace ondraluk;
+
+namespace {
+
+	VirtualArenaConfig smallConfig(DECOMMIT::ENUM decommit) {
+		VirtualArenaConfig config;
+		config.mReserveSize = 64 << 20;
+		config.mCommitSize = 64 << 10;
+		config.mRetainSize = 128 << 10;
+		config.mDecommit = decommit;
+		return config;
+	}
+}
+
+TEST(reservesWithoutCommitting) {
+	VirtualArenaAllocator arena;
+
+	CHECK(arena.reserved() == static_cast<size_t>(64) << 30);
+	CHECK(arena.committed() == 0);
+	CHECK(arena.used() == 0);
+}
+
+TEST(commitsLazilyInSteps) {
+	VirtualArenaAllocator arena(smallConfig(DECOMMIT::DONTNEED));
+
+	unsigned char* first = static_cast<unsigned char*>(arena.allocate(100));
+	CHECK(first != nullptr);
+	CHECK(arena.committed() == 64 << 10);
+
+	unsigned char* second = static_cast<unsigned char*>(arena.allocate(1 << 20));
+	CHECK(second == first + 100);
+	CHECK(arena.committed() >= 100 + (1 << 20));
+	CHECK(arena.committed() % (64 << 10) == 0);
+
+	// the whole committed range is writable
+	memset(first, 1, arena.used());
+	CHECK(arena.peak() == arena.used());
+}
+
+TEST(exhaustedReservationReturnsNull) {
+	VirtualArenaAllocator arena(smallConfig(DECOMMIT::DONTNEED));
+
+	CHECK(arena.allocate(64 << 20) != nullptr);
+	CHECK(arena.allocate(1) == nullptr);
+	CHECK(arena.used() == static_cast<size_t>(64 << 20));
+}
+
+TEST(resetDecommitsAboveRetainMark) {
+	VirtualArenaAllocator arena(smallConfig(DECOMMIT::DONTNEED));
+
+	unsigned char* mem = static_cast<unsigned char*>(arena.allocate(8 << 20));
+	memset(mem, 0xAB, 8 << 20);
+
+	arena.reset();
+
+	CHECK(arena.used() == 0);
+	CHECK(arena.committed() == 128 << 10);
+	CHECK(arena.peak() == static_cast<size_t>(8 << 20));
+
+	// same addresses again, the decommitted pages come back zeroed
+	CHECK(arena.allocate(8 << 20) == mem);
+	CHECK(mem[0] == 0xAB);
+	CHECK(mem[(8 << 20) - 1] == 0);
+}
+
+TEST(madvFreeKeepsPagesAccessible) {
+	VirtualArenaAllocator arena(smallConfig(DECOMMIT::FREE));
+
+	unsigned char* mem = static_cast<unsigned char*>(arena.allocate(4 << 20));
+	memset(mem, 0xAB, 4 << 20);
+
+	arena.reset();
+
+	CHECK(arena.used() == 0);
+	CHECK(arena.allocate(4 << 20) == mem);
+	mem[(4 << 20) - 1] = 1;
+}
+
+TEST(freeRewindsAndMoveTransfersRange) {
+	VirtualArenaAllocator source(smallConfig(DECOMMIT::DONTNEED));
+
+	source.allocate(16);
+	void* second = source.allocate(16);
+	source.free(second);
+
+	VirtualArenaAllocator target(std::move(source));
+
+	CHECK(source.allocate(16) == nullptr);
+	CHECK(target.allocate(16) == second);
+	CHECK(target.reserved() == static_cast<size_t>(64 << 20));
+}
+
+RUN_TESTS()
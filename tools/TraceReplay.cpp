@@ -0,0 +1,318 @@
+/**
+ * This file is part of the Ondraluk memory managing library
+ *
+ * @author Christian Ondracek & Lukas Oberbichler
+ * @date May 2014
+ *
+ * @file TraceReplay.cpp
+ *
+ * Replays an allocation trace recorded with the TraceRecordingPolicy against allocator policies and
+ * reports time, peak RSS and fragmentation per policy.
+ *
+ * usage: TraceReplay <trace> [policy ...]
+ * 	policies: malloc, mm-malloc, mm-malloc-bounds, mm-linear, mm-linear-bounds (default: all)
+ *
+ * Every policy runs in a forked child so the RSS numbers do not influence each other.
+ * Events of all threads are replayed in recording order on a single thread.
+ * Fragmentation is reported as 1 - peak live bytes / peak RSS growth.
+ */
+
+// measure the allocators, not the logger
+#define ONDRALUK_TRACKING 0
+
+#include "../includes/AllocationTrace.hpp"
+#include "../includes/MemoryManager.hpp"
+#include "../includes/LinearAllocator.hpp"
+#include "../includes/MallocAllocator.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace ondraluk;
+
+namespace {
+
+	/**
+	 * The trace in memory, decoded before any measurement
+	 */
+	struct Trace {
+		Trace() : mMaxId(0), mTotalBytes(0) {}
+
+		std::vector<AllocationEvent> mEvents;
+		uint64_t mMaxId;
+		uint64_t mTotalBytes;
+	};
+
+	struct Result {
+		Result() : mNanoseconds(0), mPeakLive(0), mRssGrowth(0), mPeakRss(0), mFailed(0) {}
+
+		uint64_t mNanoseconds;
+		uint64_t mPeakLive;
+		uint64_t mRssGrowth;
+		uint64_t mPeakRss;
+		uint64_t mFailed;
+	};
+
+	struct MallocCandidate {
+		explicit MallocCandidate(const Trace&) {}
+
+		void* allocate(size_t size, size_t alignment) {
+			if(alignment > alignof(std::max_align_t)) {
+				void* mem = nullptr;
+				return posix_memalign(&mem, alignment, size) == 0 ? mem : nullptr;
+			}
+			return ::malloc(size);
+		}
+
+		void free(void* mem) { ::free(mem); }
+	};
+
+	inline MallocAllocator createAllocator(const Trace&, MallocAllocator*) {
+		return MallocAllocator();
+	}
+
+	// the arena must hold every allocation of the trace, a LinearAllocator only reuses memory freed in LIFO order
+	inline LinearAllocator createAllocator(const Trace& trace, LinearAllocator*) {
+		return LinearAllocator(static_cast<size_t>(trace.mTotalBytes + 64 * trace.mMaxId + 1));
+	}
+
+	/**
+	 * The MemoryManager does not align beyond what the allocator returns, the alignment is ignored
+	 */
+	template <class Allocator, class BoundsChecker>
+	struct ManagerCandidate {
+		explicit ManagerCandidate(const Trace& trace) : mManager(createAllocator(trace, static_cast<Allocator*>(nullptr))) {}
+
+		void* allocate(size_t size, size_t) {
+			return mManager.template allocate<unsigned char>(size);
+		}
+
+		void free(void* mem) {
+			mManager.template deallocate<unsigned char, ARRAY::YES>(static_cast<unsigned char*>(mem));
+		}
+
+		MemoryManager<Allocator, BoundsChecker> mManager;
+	};
+
+	/**
+	 * Freeing into a LinearAllocator rewinds it, which would hand out live blocks again for any trace that does not
+	 * free in LIFO order. Arenas therefore drop the frees and release everything at once at the end.
+	 */
+	template <class BoundsChecker>
+	struct ManagerCandidate<LinearAllocator, BoundsChecker> {
+		explicit ManagerCandidate(const Trace& trace) : mManager(createAllocator(trace, static_cast<LinearAllocator*>(nullptr))) {}
+
+		void* allocate(size_t size, size_t) {
+			return mManager.template allocate<unsigned char>(size);
+		}
+
+		void free(void*) {
+		}
+
+		MemoryManager<LinearAllocator, BoundsChecker> mManager;
+	};
+
+	uint64_t currentRss() {
+		long pages = 0;
+		long resident = 0;
+		std::FILE* statm = std::fopen("/proc/self/statm", "r");
+
+		if(statm != nullptr) {
+			if(std::fscanf(statm, "%ld %ld", &pages, &resident) != 2) {
+				resident = 0;
+			}
+			std::fclose(statm);
+		}
+
+		return static_cast<uint64_t>(resident) * sysconf(_SC_PAGESIZE);
+	}
+
+	uint64_t peakRss() {
+		rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+	}
+
+	template <class Candidate>
+	Result replay(const Trace& trace) {
+		Result result;
+		std::vector<void*> blocks(trace.mMaxId + 1, nullptr);
+		std::vector<uint64_t> sizes(trace.mMaxId + 1, 0);
+		size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+		uint64_t rssBefore = currentRss();
+		uint64_t live = 0;
+
+		Candidate candidate(trace);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for(size_t i = 0; i < trace.mEvents.size(); ++i) {
+			const AllocationEvent& event = trace.mEvents[i];
+
+			if(event.mType == AllocationEvent::ALLOCATE) {
+				unsigned char* mem = static_cast<unsigned char*>(candidate.allocate(static_cast<size_t>(event.mSize), static_cast<size_t>(event.mAlignment)));
+
+				if(mem == nullptr) {
+					++result.mFailed;
+					continue;
+				}
+
+				// touch every page like the application would
+				for(size_t offset = 0; offset < event.mSize; offset += page) {
+					mem[offset] = 1;
+				}
+
+				blocks[event.mId] = mem;
+				sizes[event.mId] = event.mSize;
+
+				live += event.mSize;
+				if(live > result.mPeakLive) {
+					result.mPeakLive = live;
+				}
+			} else if(blocks[event.mId] != nullptr) {
+				candidate.free(blocks[event.mId]);
+				blocks[event.mId] = nullptr;
+				live -= sizes[event.mId];
+			}
+		}
+
+		result.mNanoseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+		result.mPeakRss = peakRss();
+		result.mRssGrowth = result.mPeakRss > rssBefore ? result.mPeakRss - rssBefore : 0;
+
+		return result;
+	}
+
+	Result replay(const Trace& trace, const char* policy, bool& known) {
+		known = true;
+
+		if(strcmp(policy, "malloc") == 0) {
+			return replay<MallocCandidate>(trace);
+		} else if(strcmp(policy, "mm-malloc") == 0) {
+			return replay<ManagerCandidate<MallocAllocator, NoBoundsCheckingPolicy> >(trace);
+		} else if(strcmp(policy, "mm-malloc-bounds") == 0) {
+			return replay<ManagerCandidate<MallocAllocator, BoundsCheckingPolicy<4, 0xEF> > >(trace);
+		} else if(strcmp(policy, "mm-linear") == 0) {
+			return replay<ManagerCandidate<LinearAllocator, NoBoundsCheckingPolicy> >(trace);
+		} else if(strcmp(policy, "mm-linear-bounds") == 0) {
+			return replay<ManagerCandidate<LinearAllocator, BoundsCheckingPolicy<4, 0xEF> > >(trace);
+		}
+
+		known = false;
+		return Result();
+	}
+
+	bool load(const char* fname, Trace& trace) {
+		AllocationTraceReader reader(fname);
+
+		if(!reader.isOpen()) {
+			return false;
+		}
+
+		AllocationEvent event;
+		while(reader.next(event)) {
+			trace.mEvents.push_back(event);
+
+			if(event.mId > trace.mMaxId) {
+				trace.mMaxId = event.mId;
+			}
+
+			trace.mTotalBytes += event.mSize;
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char** argv) {
+	static const char* ALL_POLICIES[] = { "malloc", "mm-malloc", "mm-malloc-bounds", "mm-linear", "mm-linear-bounds" };
+
+	if(argc < 2) {
+		std::fprintf(stderr, "usage: %s <trace> [policy ...]\n", argv[0]);
+		return 1;
+	}
+
+	Trace trace;
+
+	if(!load(argv[1], trace)) {
+		std::fprintf(stderr, "%s: not an allocation trace\n", argv[1]);
+		return 1;
+	}
+
+	std::vector<const char*> policies;
+	if(argc > 2) {
+		policies.assign(argv + 2, argv + argc);
+	} else {
+		policies.assign(ALL_POLICIES, ALL_POLICIES + sizeof(ALL_POLICIES) / sizeof(ALL_POLICIES[0]));
+	}
+
+	std::printf("%llu events, %llu allocations\n", static_cast<unsigned long long>(trace.mEvents.size()), static_cast<unsigned long long>(trace.mMaxId));
+	std::printf("%-18s %12s %10s %12s %12s %12s %8s\n", "policy", "time ms", "ns/event", "peak live", "rss growth", "peak rss", "frag");
+	std::fflush(stdout);
+
+	int status = 0;
+
+	for(size_t i = 0; i < policies.size(); ++i) {
+		int pipeFds[2];
+		if(pipe(pipeFds) != 0) {
+			return 1;
+		}
+
+		pid_t child = fork();
+
+		if(child == 0) {
+			close(pipeFds[0]);
+
+			bool known;
+			Result result = replay(trace, policies[i], known);
+
+			if(known && write(pipeFds[1], &result, sizeof(result)) != sizeof(result)) {
+				_exit(1);
+			}
+			_exit(known ? 0 : 2);
+		}
+
+		close(pipeFds[1]);
+
+		Result result;
+		bool received = child > 0 && read(pipeFds[0], &result, sizeof(result)) == sizeof(result);
+		close(pipeFds[0]);
+
+		int childStatus = 0;
+		if(child > 0) {
+			waitpid(child, &childStatus, 0);
+		}
+
+		if(!received) {
+			std::printf("%-18s %s\n", policies[i], WIFEXITED(childStatus) && WEXITSTATUS(childStatus) == 2 ? "unknown policy" : "failed");
+			status = 1;
+			continue;
+		}
+
+		double fragmentation = result.mRssGrowth > 0 ? 1.0 - static_cast<double>(result.mPeakLive) / result.mRssGrowth : 0.0;
+		if(fragmentation < 0.0) {
+			fragmentation = 0.0;
+		}
+
+		std::printf("%-18s %12.3f %10.1f %12llu %12llu %12llu %7.1f%%%s\n", policies[i],
+			result.mNanoseconds / 1e6,
+			trace.mEvents.empty() ? 0.0 : static_cast<double>(result.mNanoseconds) / trace.mEvents.size(),
+			static_cast<unsigned long long>(result.mPeakLive),
+			static_cast<unsigned long long>(result.mRssGrowth),
+			static_cast<unsigned long long>(result.mPeakRss),
+			fragmentation * 100.0,
+			result.mFailed ? " (allocations failed)" : "");
+	}
+
+	return status;
+}